@@ -3,32 +3,563 @@
 #include <sstream>
 #include <cctype>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <limits>
 #include <complex>
+#include <utility>
+
+#include "plot_buffer.hpp"
+
+namespace {
+
+/*********************************************************************** 
+Extended precision helpers shared by number scanning and formatting,
+after Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+with Integers" (2010) and the double-conversion library.
+**********************************************************************/
+
+// a floating point number f * 2^e with a 64 bit significand
+struct DiyFp {
+  std::uint64_t f;
+  int e;
+};
+
+DiyFp diy_sub(DiyFp x, DiyFp y){
+  return {x.f - y.f, x.e};
+}
+
+DiyFp diy_mul(DiyFp x, DiyFp y){
+
+  // 64x64 bit multiplication, keeping the rounded upper half
+  const std::uint64_t mask = 0xFFFFFFFFu;
+  std::uint64_t a = x.f >> 32, b = x.f & mask;
+  std::uint64_t c = y.f >> 32, d = y.f & mask;
+  std::uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+  std::uint64_t tmp = (bd >> 32) + (ad & mask) + (bc & mask);
+  tmp += std::uint64_t(1) << 31;
+  return {ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64};
+}
+
+DiyFp diy_normalize(DiyFp x){
+  while((x.f >> 63) == 0){
+    x.f <<= 1;
+    --x.e;
+  }
+  return x;
+}
+
+struct CachedPower {
+  std::uint64_t f;
+  int e;
+  int k;
+};
+
+// normalized approximations of 10^k for k = -300, -292, ..., 340,
+// rounded to nearest
+const CachedPower cached_powers[] = {
+    {0xAB70FE17C79AC6CA, -1060, -300},
+    {0xFF77B1FCBEBCDC4F, -1034, -292},
+    {0xBE5691EF416BD60C, -1007, -284},
+    {0x8DD01FAD907FFC3C,  -980, -276},
+    {0xD3515C2831559A83,  -954, -268},
+    {0x9D71AC8FADA6C9B5,  -927, -260},
+    {0xEA9C227723EE8BCB,  -901, -252},
+    {0xAECC49914078536D,  -874, -244},
+    {0x823C12795DB6CE57,  -847, -236},
+    {0xC21094364DFB5637,  -821, -228},
+    {0x9096EA6F3848984F,  -794, -220},
+    {0xD77485CB25823AC7,  -768, -212},
+    {0xA086CFCD97BF97F4,  -741, -204},
+    {0xEF340A98172AACE5,  -715, -196},
+    {0xB23867FB2A35B28E,  -688, -188},
+    {0x84C8D4DFD2C63F3B,  -661, -180},
+    {0xC5DD44271AD3CDBA,  -635, -172},
+    {0x936B9FCEBB25C996,  -608, -164},
+    {0xDBAC6C247D62A584,  -582, -156},
+    {0xA3AB66580D5FDAF6,  -555, -148},
+    {0xF3E2F893DEC3F126,  -529, -140},
+    {0xB5B5ADA8AAFF80B8,  -502, -132},
+    {0x87625F056C7C4A8B,  -475, -124},
+    {0xC9BCFF6034C13053,  -449, -116},
+    {0x964E858C91BA2655,  -422, -108},
+    {0xDFF9772470297EBD,  -396, -100},
+    {0xA6DFBD9FB8E5B88F,  -369,  -92},
+    {0xF8A95FCF88747D94,  -343,  -84},
+    {0xB94470938FA89BCF,  -316,  -76},
+    {0x8A08F0F8BF0F156B,  -289,  -68},
+    {0xCDB02555653131B6,  -263,  -60},
+    {0x993FE2C6D07B7FAC,  -236,  -52},
+    {0xE45C10C42A2B3B06,  -210,  -44},
+    {0xAA242499697392D3,  -183,  -36},
+    {0xFD87B5F28300CA0E,  -157,  -28},
+    {0xBCE5086492111AEB,  -130,  -20},
+    {0x8CBCCC096F5088CC,  -103,  -12},
+    {0xD1B71758E219652C,   -77,   -4},
+    {0x9C40000000000000,   -50,    4},
+    {0xE8D4A51000000000,   -24,   12},
+    {0xAD78EBC5AC620000,     3,   20},
+    {0x813F3978F8940984,    30,   28},
+    {0xC097CE7BC90715B3,    56,   36},
+    {0x8F7E32CE7BEA5C70,    83,   44},
+    {0xD5D238A4ABE98068,   109,   52},
+    {0x9F4F2726179A2245,   136,   60},
+    {0xED63A231D4C4FB27,   162,   68},
+    {0xB0DE65388CC8ADA8,   189,   76},
+    {0x83C7088E1AAB65DB,   216,   84},
+    {0xC45D1DF942711D9A,   242,   92},
+    {0x924D692CA61BE758,   269,  100},
+    {0xDA01EE641A708DEA,   295,  108},
+    {0xA26DA3999AEF774A,   322,  116},
+    {0xF209787BB47D6B85,   348,  124},
+    {0xB454E4A179DD1877,   375,  132},
+    {0x865B86925B9BC5C2,   402,  140},
+    {0xC83553C5C8965D3D,   428,  148},
+    {0x952AB45CFA97A0B3,   455,  156},
+    {0xDE469FBD99A05FE3,   481,  164},
+    {0xA59BC234DB398C25,   508,  172},
+    {0xF6C69A72A3989F5C,   534,  180},
+    {0xB7DCBF5354E9BECE,   561,  188},
+    {0x88FCF317F22241E2,   588,  196},
+    {0xCC20CE9BD35C78A5,   614,  204},
+    {0x98165AF37B2153DF,   641,  212},
+    {0xE2A0B5DC971F303A,   667,  220},
+    {0xA8D9D1535CE3B396,   694,  228},
+    {0xFB9B7CD9A4A7443C,   720,  236},
+    {0xBB764C4CA7A44410,   747,  244},
+    {0x8BAB8EEFB6409C1A,   774,  252},
+    {0xD01FEF10A657842C,   800,  260},
+    {0x9B10A4E5E9913129,   827,  268},
+    {0xE7109BFBA19C0C9D,   853,  276},
+    {0xAC2820D9623BF429,   880,  284},
+    {0x80444B5E7AA7CF85,   907,  292},
+    {0xBF21E44003ACDD2D,   933,  300},
+    {0x8E679C2F5E44FF8F,   960,  308},
+    {0xD433179D9C8CB841,   986,  316},
+    {0x9E19DB92B4E31BA9,  1013,  324},
+    {0xEB96BF6EBADF77D9,  1039,  332},
+    {0xAF87023B9BF0EE6B,  1066,  340}
+};
+
+const int cached_powers_min_exp = -300;
+const int cached_powers_max_exp = 340;
+const int cached_powers_step = 8;
+
+// exact 10^1 ... 10^7, to step between cached powers
+const DiyFp adjustment_powers[] = {
+  {0xA000000000000000u, -60}, {0xC800000000000000u, -57},
+  {0xFA00000000000000u, -54}, {0x9C40000000000000u, -50},
+  {0xC350000000000000u, -47}, {0xF424000000000000u, -44},
+  {0x9896800000000000u, -40}};
+
+/*********************************************************************** 
+Numeric literals.
+
+scan_number accepts exactly what reading a double from a std::istream does
+in the classic locale: an optional sign, digits with at most one decimal
+point, and an optional exponent, stopping at the first character that
+cannot continue the number. The decimal point is always '.', regardless of
+the global locale. The result is correctly rounded.
+**********************************************************************/
+
+enum ScanResult {ScanFailed, ScanPartial, ScanComplete};
+
+const std::uint64_t max_exact_mantissa = std::uint64_t(1) << 53;
+
+const double exact_powers_of_ten[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Convert mantissa * 10^exponent, where mantissa holds the first (at most
+// 19) of num_digits significant digits, rounded. Returns false if the
+// accumulated error leaves the rounding direction undecided or the result
+// is not a normal double.
+bool diy_convert(std::uint64_t mantissa, int num_digits, long exponent, double & value){
+
+  const int denominator_log = 3;
+  const std::uint64_t denominator = 1 << denominator_log;
+
+  // error in units of 1/denominator of the last place
+  std::uint64_t error = (num_digits > 19) ? denominator / 2 : 0;
+  if(num_digits > 19) exponent += num_digits - 19;
+
+  if(exponent < cached_powers_min_exp || exponent > cached_powers_max_exp) return false;
+
+  DiyFp input = {mantissa, 0};
+  int old_e = input.e;
+  input = diy_normalize(input);
+  error <<= old_e - input.e;
+
+  int index = static_cast<int>((exponent - cached_powers_min_exp) / cached_powers_step);
+  const CachedPower & cached = cached_powers[index];
+
+  int adjustment = static_cast<int>(exponent) - cached.k;
+  if(adjustment > 0){
+    input = diy_mul(input, adjustment_powers[adjustment - 1]);
+    // exact if the product still fits into 19 digits
+    if(num_digits + adjustment > 19) error += denominator / 2;
+  }
+
+  input = diy_mul(input, DiyFp{cached.f, cached.e});
+  error += denominator / 2 + (error == 0 ? 0 : 1) + denominator / 2;
+
+  old_e = input.e;
+  input = diy_normalize(input);
+  error <<= old_e - input.e;
+
+  // the value is in [2^(order - 1), 2^order)
+  int order = 64 + input.e;
+  if(order < -1020 || order > 1023) return false;
+
+  const int precision_digits = 64 - 53;
+  std::uint64_t precision_bits = (input.f & ((std::uint64_t(1) << precision_digits) - 1)) * denominator;
+  std::uint64_t half_way = (std::uint64_t(1) << (precision_digits - 1)) * denominator;
+
+  if(half_way - error < precision_bits && precision_bits < half_way + error) return false;
+
+  std::uint64_t f = input.f >> precision_digits;
+  if(precision_bits >= half_way + error) ++f;
+  value = std::ldexp(static_cast<double>(f), input.e + precision_digits);
+  return true;
+}
+
+ScanResult scan_number(const char * c, const char * end, double & value){
+
+  // leading whitespace is skipped by the stream extractor
+  while(c != end && std::isspace(static_cast<unsigned char>(*c))) ++c;
+
+  bool negative = false;
+  if(c != end && (*c == '+' || *c == '-')){
+    negative = (*c == '-');
+    ++c;
+  }
+
+  // the first 19 significant digits, rounded by the 20th, and the power of
+  // ten that scales all significant digits to the value
+  const char * first_digit = nullptr;
+  std::uint64_t mantissa = 0;
+  int num_digits = 0;
+  long exponent = 0;
+  bool found_mantissa = false;
+  bool found_dec = false;
+
+  for(; c != end; ++c){
+    if(*c >= '0' && *c <= '9'){
+      found_mantissa = true;
+      if(num_digits == 0 && *c == '0'){
+        if(found_dec) --exponent;
+        continue;
+      }
+      if(num_digits == 0) first_digit = c;
+      if(num_digits < 19) mantissa = mantissa * 10 + (*c - '0');
+      else if(num_digits == 19 && *c >= '5') ++mantissa;
+      ++num_digits;
+      if(found_dec) --exponent;
+    }
+    else if(*c == '.' && !found_dec){
+      found_dec = true;
+    }
+    else{
+      break;
+    }
+  }
+
+  if(!found_mantissa) return ScanFailed;
+
+  if(c != end && (*c == 'e' || *c == 'E')){
+    ++c;
+    bool negative_exp = false;
+    if(c != end && (*c == '+' || *c == '-')){
+      negative_exp = (*c == '-');
+      ++c;
+    }
+    if(c == end || *c < '0' || *c > '9') return ScanFailed;
+
+    long e = 0;
+    for(; c != end && *c >= '0' && *c <= '9'; ++c){
+      // anything this large is already an overflow or underflow
+      if(e < 100000) e = e * 10 + (*c - '0');
+    }
+    exponent += negative_exp ? -e : e;
+  }
+
+  ScanResult result = (c == end) ? ScanComplete : ScanPartial;
+
+  double v;
+  if(num_digits == 0){
+    v = 0;
+  }
+  else if(num_digits <= 19 && mantissa <= max_exact_mantissa &&
+          exponent >= -22 && exponent <= 22){
+    // both the mantissa and the power of ten are exact doubles, so a
+    // single multiplication or division is correctly rounded
+    v = static_cast<double>(mantissa);
+    if(exponent < 0) v /= exact_powers_of_ten[-exponent];
+    else v *= exact_powers_of_ten[exponent];
+  }
+  else if(!diy_convert(mantissa, num_digits, exponent, v)){
+    // hand the digits to strtod, written without a decimal point so that
+    // the conversion does not depend on the locale
+    std::string digits;
+    digits.reserve(num_digits + 24);
+    for(const char * d = first_digit; digits.size() < std::size_t(num_digits); ++d){
+      if(*d != '.') digits += *d;
+    }
+    digits += "e";
+    digits += std::to_string(exponent);
+
+    v = std::strtod(digits.c_str(), nullptr);
+    if(std::isinf(v)) return ScanFailed; // out of range, as the extractor reports
+  }
+
+  value = negative ? -v : v;
+  return result;
+}
+
+/*********************************************************************** 
+Number formatting.
+
+format_number writes the shortest decimal representation that reads back
+as the same double. Grisu3 finds it for almost all doubles and detects
+the few cases it cannot decide, which fall back to trying increasing
+precisions.
+**********************************************************************/
+
+// digit generation needs the scaled value's binary exponent in this range
+const int alpha = -60;
+
+// the cached power c such that w * c has exponent in [alpha, alpha + 28]
+CachedPower cached_power_for(int e){
+  int f = alpha - e - 1;
+  int k = (f * 78913) / (1 << 18) + (f > 0);
+  int index = (-cached_powers_min_exp + k + (cached_powers_step - 1)) / cached_powers_step;
+  return cached_powers[index];
+}
+
+// move the last digit towards w while staying safely inside the interval;
+// returns false if the result might not be the closest shortest one
+bool round_weed(char * buffer, int length, std::uint64_t distance_too_high_w,
+                std::uint64_t unsafe_interval, std::uint64_t rest,
+                std::uint64_t ten_kappa, std::uint64_t unit){
+
+  std::uint64_t small_distance = distance_too_high_w - unit;
+  std::uint64_t big_distance = distance_too_high_w + unit;
+
+  while(rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < small_distance ||
+         small_distance - rest >= rest + ten_kappa - small_distance)){
+    --buffer[length - 1];
+    rest += ten_kappa;
+  }
+
+  if(rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+     (rest + ten_kappa < big_distance ||
+      big_distance - rest > rest + ten_kappa - big_distance)){
+    return false;
+  }
+
+  return (2 * unit <= rest) && (rest <= unsafe_interval - 4 * unit);
+}
+
+bool digit_gen(DiyFp low, DiyFp w, DiyFp high, char * buffer, int & length, int & kappa){
+
+  std::uint64_t unit = 1;
+  DiyFp too_low = {low.f - unit, low.e};
+  DiyFp too_high = {high.f + unit, high.e};
+  std::uint64_t unsafe_interval = diy_sub(too_high, too_low).f;
+
+  const DiyFp one = {std::uint64_t(1) << -w.e, w.e};
+  std::uint32_t integrals = static_cast<std::uint32_t>(too_high.f >> -one.e);
+  std::uint64_t fractionals = too_high.f & (one.f - 1);
+
+  std::uint32_t divisor = 1;
+  kappa = 1;
+  while(kappa < 10 && integrals / 10 >= divisor){
+    divisor *= 10;
+    ++kappa;
+  }
+
+  length = 0;
+  while(kappa > 0){
+    buffer[length++] = static_cast<char>('0' + integrals / divisor);
+    integrals %= divisor;
+    --kappa;
+
+    std::uint64_t rest = (std::uint64_t(integrals) << -one.e) + fractionals;
+    if(rest < unsafe_interval){
+      return round_weed(buffer, length, diy_sub(too_high, w).f, unsafe_interval,
+                        rest, std::uint64_t(divisor) << -one.e, unit);
+    }
+    divisor /= 10;
+  }
+
+  for(;;){
+    fractionals *= 10;
+    unit *= 10;
+    unsafe_interval *= 10;
+    buffer[length++] = static_cast<char>('0' + (fractionals >> -one.e));
+    fractionals &= one.f - 1;
+    --kappa;
+
+    if(fractionals < unsafe_interval){
+      return round_weed(buffer, length, diy_sub(too_high, w).f * unit, unsafe_interval,
+                        fractionals, one.f, unit);
+    }
+  }
+}
+
+// shortest digits of a finite v > 0, such that v = digits * 10^decimal_exponent
+bool grisu3(double v, char * buffer, int & length, int & decimal_exponent){
+
+  std::uint64_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+
+  const std::uint64_t hidden_bit = std::uint64_t(1) << 52;
+  const int bias = 1023 + 52;
+  std::uint64_t F = bits & (hidden_bit - 1);
+  int E = static_cast<int>(bits >> 52);
+
+  DiyFp w = (E == 0) ? DiyFp{F, 1 - bias} : DiyFp{F + hidden_bit, E - bias};
+
+  // boundaries of the interval of reals that round to v
+  bool lower_closer = (F == 0 && E > 1);
+  DiyFp m_plus = diy_normalize(DiyFp{2 * w.f + 1, w.e - 1});
+  DiyFp m_minus = lower_closer ? DiyFp{4 * w.f - 1, w.e - 2} : DiyFp{2 * w.f - 1, w.e - 1};
+  m_minus.f <<= (m_minus.e - m_plus.e);
+  m_minus.e = m_plus.e;
+  w = diy_normalize(w);
+
+  CachedPower cached = cached_power_for(w.e);
+  DiyFp c = {cached.f, cached.e};
+
+  int kappa;
+  bool ok = digit_gen(diy_mul(m_minus, c), diy_mul(w, c), diy_mul(m_plus, c),
+                      buffer, length, kappa);
+  decimal_exponent = kappa - cached.k;
+  return ok;
+}
+
+// slow path: the first precision whose correctly rounded digits read back
+void shortest_by_search(double v, char * buffer, int & length, int & decimal_exponent){
+
+  for(int precision = 1; precision <= 17; ++precision){
+    char text[40];
+    std::snprintf(text, sizeof(text), "%.*e", precision - 1, v);
+
+    // collect the digits, skipping the (locale dependent) decimal point
+    length = 0;
+    const char * t = text;
+    for(; *t != 'e'; ++t){
+      if(*t >= '0' && *t <= '9') buffer[length++] = *t;
+    }
+    int exponent = std::atoi(t + 1);
+    decimal_exponent = exponent - (length - 1);
+
+    std::string check(buffer, length);
+    check += "e" + std::to_string(decimal_exponent);
+    if(std::strtod(check.c_str(), nullptr) == v) return;
+  }
+}
+
+// write v into buffer (at least 32 chars), returning the length. Uses fixed
+// notation unless the exponent is below -4 or the number would need
+// trailing zeros beyond the sixth digit, as %g does.
+int format_number(double v, char * buffer){
+
+  char * out = buffer;
+
+  if(std::signbit(v)){
+    *out++ = '-';
+    v = -v;
+  }
+
+  if(std::isnan(v)){
+    std::memcpy(out, "nan", 3);
+    return static_cast<int>(out - buffer) + 3;
+  }
+  if(std::isinf(v)){
+    std::memcpy(out, "inf", 3);
+    return static_cast<int>(out - buffer) + 3;
+  }
+  if(v == 0){
+    *out++ = '0';
+    return static_cast<int>(out - buffer);
+  }
+
+  char digits[20];
+  int k;
+  int decimal_exponent;
+  if(!grisu3(v, digits, k, decimal_exponent)){
+    shortest_by_search(v, digits, k, decimal_exponent);
+  }
+
+  // exponent of the leading digit
+  int x = k + decimal_exponent - 1;
+
+  if(x < -4 || x >= (k > 6 ? k : 6)){
+    *out++ = digits[0];
+    if(k > 1){
+      *out++ = '.';
+      std::memcpy(out, digits + 1, k - 1);
+      out += k - 1;
+    }
+    *out++ = 'e';
+    *out++ = (x < 0) ? '-' : '+';
+    int ax = (x < 0) ? -x : x;
+    if(ax >= 100) *out++ = static_cast<char>('0' + ax / 100);
+    *out++ = static_cast<char>('0' + (ax / 10) % 10);
+    *out++ = static_cast<char>('0' + ax % 10);
+  }
+  else if(x >= 0){
+    if(k <= x + 1){
+      std::memcpy(out, digits, k);
+      out += k;
+      for(int i = k; i <= x; ++i) *out++ = '0';
+    }
+    else{
+      std::memcpy(out, digits, x + 1);
+      out += x + 1;
+      *out++ = '.';
+      std::memcpy(out, digits + x + 1, k - x - 1);
+      out += k - x - 1;
+    }
+  }
+  else{
+    *out++ = '0';
+    *out++ = '.';
+    for(int i = -1; i > x; --i) *out++ = '0';
+    std::memcpy(out, digits, k);
+    out += k;
+  }
+
+  return static_cast<int>(out - buffer);
+}
+
+} // namespace
 
 Atom::Atom(): m_type(NoneKind) {}
 
-Atom::Atom(double value){
+Atom::Atom(double value): Atom() {
 
   setNumber(value);
 }
 
 Atom::Atom(const Token & token): Atom(){
   
-  // is token a number?
-  double temp;
-  std::istringstream iss(token.asString());
-  if(iss >> temp){
-    // check for trailing characters if >> succeeds
-    if(iss.rdbuf()->in_avail() == 0){
-      setNumber(temp);
-    }
+  const std::string text = token.asString();
+  setToken(text.data(), text.size());
+}
+
+Atom::Atom(const TokenSlice & token): Atom(){
+
+  if(token.type == Token::STRING){
+    setToken(token.data, token.size);
   }
-  else{ // else assume symbol
-    // make sure does not start with number
-    if(!std::isdigit(token.asString()[0])){
-      setSymbol(token.asString());
-    }
+  else{
+    const std::string text = token.asString();
+    setToken(text.data(), text.size());
   }
 }
 
@@ -42,6 +573,11 @@ Atom::Atom(std::complex<double> value): Atom() {
   setComplex(value);
 }
 
+Atom::Atom(std::shared_ptr<const PlotBuffer> value): Atom() {
+
+  setPlot(value);
+}
+
 Atom::Atom(const Atom & x): Atom(){
   if(x.isNumber()){
     setNumber(x.numberValue);
@@ -49,6 +585,9 @@ Atom::Atom(const Atom & x): Atom(){
   else if(x.isSymbol()){
     setSymbol(x.stringValue);
   }
+  else if(x.isPlot()){
+    setPlot(x.plotValue);
+  }
   //else if(x.isComplex()) {
 	//setComplex(x.complexValue);
   //}
@@ -58,7 +597,7 @@ Atom & Atom::operator=(const Atom & x){
 
   if(this != &x){
     if(x.m_type == NoneKind){
-      m_type = NoneKind;
+      release();
     }
     else if(x.m_type == NumberKind){
       setNumber(x.numberValue);
@@ -69,16 +608,63 @@ Atom & Atom::operator=(const Atom & x){
 	else if (x.m_type == ComplexKind) {
 	  setComplex(x.complexValue);
 	}
+    else if(x.m_type == PlotKind){
+      setPlot(x.plotValue);
+    }
   }
   return *this;
 }
   
-Atom::~Atom(){
+Atom::Atom(Atom && x) noexcept: Atom(){
+  *this = std::move(x);
+}
 
-  // we need to ensure the destructor of the symbol string is called
-  if(m_type == SymbolKind){
-    stringValue.~basic_string();
+Atom & Atom::operator=(Atom && x) noexcept{
+
+  if(this != &x){
+    if(x.m_type == SymbolKind){
+      // steal the symbol string
+      if(m_type == SymbolKind){
+        stringValue = std::move(x.stringValue);
+      }
+      else{
+        release();
+        new (&stringValue) std::string(std::move(x.stringValue));
+        m_type = SymbolKind;
+      }
+      x.stringValue.~basic_string();
+    }
+    else if(x.m_type == PlotKind){
+      // steal the plot reference
+      if(m_type == PlotKind){
+        plotValue = std::move(x.plotValue);
+      }
+      else{
+        release();
+        new (&plotValue) PlotPointer(std::move(x.plotValue));
+        m_type = PlotKind;
+      }
+      x.plotValue.~PlotPointer();
+    }
+    else{
+      release();
+      m_type = x.m_type;
+      if(x.m_type == NumberKind){
+        numberValue = x.numberValue;
+      }
+      else if(x.m_type == ComplexKind){
+        complexValue = x.complexValue;
+      }
+    }
+    x.m_type = NoneKind;
   }
+  return *this;
+}
+
+Atom::~Atom(){
+
+  // we need to ensure the destructor of the symbol string or plot is called
+  release();
 }
 
 bool Atom::isNone() const noexcept{
@@ -97,9 +683,25 @@ bool Atom::isComplex() const noexcept{
   return m_type == ComplexKind;
 }  
 
+bool Atom::isPlot() const noexcept{
+  return m_type == PlotKind;
+}
+
+
+void Atom::release() noexcept{
+
+  if(m_type == SymbolKind){
+    stringValue.~basic_string();
+  }
+  else if(m_type == PlotKind){
+    plotValue.~PlotPointer();
+  }
+  m_type = NoneKind;
+}
 
 void Atom::setNumber(double value){
 
+  release();
   m_type = NumberKind;
   numberValue = value;
 }
@@ -107,9 +709,7 @@ void Atom::setNumber(double value){
 void Atom::setSymbol(const std::string & value){
 
   // we need to ensure the destructor of the symbol string is called
-  if(m_type == SymbolKind){
-    stringValue.~basic_string();
-  }
+  release();
     
   m_type = SymbolKind;
 
@@ -117,12 +717,43 @@ void Atom::setSymbol(const std::string & value){
   new (&stringValue) std::string(value);
 }
 
+void Atom::setToken(const char * data, std::size_t size){
+
+  // is token a number?
+  double temp;
+  ScanResult result = scan_number(data, data + size, temp);
+  if(result != ScanFailed){
+    // a number followed by trailing characters is invalid
+    if(result == ScanComplete){
+      setNumber(temp);
+    }
+  }
+  else{ // else assume symbol
+    // make sure does not start with number
+    if(size == 0 || !std::isdigit(data[0])){
+      release();
+      m_type = SymbolKind;
+      new (&stringValue) std::string(data, size);
+    }
+  }
+}
+
 void Atom::setComplex(std::complex<double> value){
 
+  release();
   m_type = ComplexKind;
   complexValue = value;
 }
 
+void Atom::setPlot(const PlotPointer & value){
+
+  // copy first, value may be our own plot
+  PlotPointer plot = value;
+  release();
+  m_type = PlotKind;
+  new (&plotValue) PlotPointer(std::move(plot));
+}
+
 double Atom::asNumber() const noexcept{
 
   return (m_type == NumberKind) ? numberValue : 0.0;  
@@ -146,6 +777,11 @@ std::complex<double> Atom::asComplex() const noexcept{
   return (m_type == ComplexKind) ? complexValue : (0);
 }
 
+std::shared_ptr<const PlotBuffer> Atom::asPlot() const noexcept{
+
+  return (m_type == PlotKind) ? plotValue : nullptr;
+}
+
 bool Atom::operator==(const Atom & right) const noexcept{
   
   if(m_type != right.m_type) return false;
@@ -178,6 +814,8 @@ bool Atom::operator==(const Atom & right) const noexcept{
       return complexValue == right.complexValue;
     }
     break;
+  case PlotKind:
+    return (plotValue == right.plotValue) || (*plotValue == *right.plotValue);
   default:
     return false;
   }
@@ -194,7 +832,14 @@ bool operator!=(const Atom & left, const Atom & right) noexcept{
 std::ostream & operator<<(std::ostream & out, const Atom & a){
 
   if(a.isNumber()){
-    out << a.asNumber();
+    // honor an explicitly requested fixed or scientific format
+    if(out.flags() & std::ios_base::floatfield){
+      out << a.asNumber();
+    }
+    else{
+      char buffer[32];
+      out << std::string(buffer, format_number(a.asNumber(), buffer));
+    }
   }
   if(a.isSymbol()){
     out << a.asSymbol();
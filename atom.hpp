@@ -7,9 +7,13 @@ Defines the Atom type and associated functions.
 #include "token.hpp"
 
 #include <complex>
+#include <memory>
+
+// forward declare PlotBuffer
+struct PlotBuffer;
 
 /*! \class Atom
-\brief A variant type that may be a Number or Symbol or the default type None.
+\brief A variant type that may be a Number, Symbol, Complex or Plot or the default type None.
 
 This class provides value semantics.
 */
@@ -28,15 +32,27 @@ public:
   /// Construct an Atom of type Complex named value
   Atom(std::complex<double> value);
 
+  /// Construct an Atom of type Plot sharing value
+  Atom(std::shared_ptr<const PlotBuffer> value);
+
   /// Construct an Atom directly from a Token
   Atom(const Token & token);
 
+  /// Construct an Atom directly from a TokenSlice, without copying a number
+  Atom(const TokenSlice & token);
+
   /// Copy-construct an Atom
   Atom(const Atom & x);
 
+  /// Move-construct an Atom, leaving x a None Atom
+  Atom(Atom && x) noexcept;
+
   /// Assign an Atom
   Atom & operator=(const Atom & x);
 
+  /// Move-assign an Atom, leaving x a None Atom
+  Atom & operator=(Atom && x) noexcept;
+
   /// Atom destructor
   ~Atom();
 
@@ -52,6 +68,9 @@ public:
   /// predicate to determine if an Atom is of type Complex
   bool isComplex() const noexcept;
 
+  /// predicate to determine if an Atom is of type Plot
+  bool isPlot() const noexcept;
+
   /// value of Atom as a number, return 0 if not a Number
   double asNumber() const noexcept;
 
@@ -61,13 +80,18 @@ public:
   /// value of Atom as a complex, return 0, 0 if not a complex
   std::complex<double> asComplex() const noexcept;
 
+  /// value of Atom as a plot, returns nullptr if not a Plot
+  std::shared_ptr<const PlotBuffer> asPlot() const noexcept;
+
   /// equality comparison based on type and value
   bool operator==(const Atom & right) const noexcept;
 
 private:
 
   // internal enum of known types
-  enum Type {NoneKind, NumberKind, SymbolKind, ComplexKind};
+  enum Type {NoneKind, NumberKind, SymbolKind, ComplexKind, PlotKind};
+
+  typedef std::shared_ptr<const PlotBuffer> PlotPointer;
 
   // track the type
   Type m_type;
@@ -78,6 +102,7 @@ private:
     double numberValue;
     std::string stringValue;
 	std::complex<double> complexValue;
+    PlotPointer plotValue;
   };
 
   // helper to set type and value of Number
@@ -88,6 +113,15 @@ private:
   
   // helper to set type and value of Complex
   void setComplex(std::complex<double> value);
+
+  // helper to set type and value of Plot
+  void setPlot(const PlotPointer & value);
+
+  // helper to set type and value from the text of a STRING token
+  void setToken(const char * data, std::size_t size);
+
+  // helper to destroy a Symbol or Plot value, leaving type None
+  void release() noexcept;
 };
 
 /// inequality comparison for Atom
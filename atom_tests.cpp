@@ -1,6 +1,7 @@
 #include "catch.hpp"
 
 #include "atom.hpp"
+#include "plot_buffer.hpp"
 
 TEST_CASE( "Test constructors", "[atom]" ) {
 
@@ -230,3 +231,136 @@ TEST_CASE( "test comparison", "[atom]" ) {
 
 
 
+
+TEST_CASE( "Test number literals", "[atom]" ) {
+
+  struct { const char * text; double value; } numbers[] = {
+    {"0", 0}, {"42", 42}, {"-1", -1}, {"+5", 5}, {"1.5", 1.5}, {".5", 0.5},
+    {"1.", 1}, {"-1.25e-3", -1.25e-3}, {"1E5", 1e5}, {"007", 7},
+    {"0.1", 0.1}, {"123.45678901234567", 123.45678901234567},
+    {"2.2250738585072014e-308", 2.2250738585072014e-308},
+    {"1.7976931348623157e308", 1.7976931348623157e308},
+    {"9007199254740993", 9007199254740992.0},
+    {"0.30000000000000000000000001", 0.3},
+    {"1e-400", 0}};
+
+  for(auto & n : numbers){
+    INFO(n.text);
+    Atom a{Token(n.text)};
+    REQUIRE(a.isNumber());
+    REQUIRE(a.asNumber() == n.value);
+  }
+
+  // not numbers, but valid symbols
+  for(auto text : {"-", "+", ".", "-abc", "-1e", "e5", "-1e400", "nan", "inf"}){
+    INFO(text);
+    Atom a{Token(text)};
+    REQUIRE(a.isSymbol());
+    REQUIRE(a.asSymbol() == text);
+  }
+
+  // invalid
+  for(auto text : {"1abc", "1.2.3", "1e", "1e+", "0x10", "1e400", "-1.5x"}){
+    INFO(text);
+    Atom a{Token(text)};
+    REQUIRE(a.isNone());
+  }
+}
+
+TEST_CASE( "Test number output", "[atom]" ) {
+
+  struct { double value; const char * text; } numbers[] = {
+    {0, "0"}, {-0.0, "-0"}, {1, "1"}, {-2.5, "-2.5"}, {100, "100"},
+    {0.1, "0.1"}, {0.3, "0.3"}, {1e6, "1e+06"}, {1.5e-7, "1.5e-07"},
+    {0.0001, "0.0001"}, {1234567, "1234567"}, {1e100, "1e+100"},
+    {3.141592653589793, "3.141592653589793"},
+    {5e-324, "5e-324"},
+    {1.7976931348623157e308, "1.7976931348623157e+308"}};
+
+  for(auto & n : numbers){
+    std::ostringstream os;
+    os << Atom(n.value);
+    REQUIRE(os.str() == n.text);
+  }
+
+  // printed numbers read back unchanged
+  for(double v : {0.1, 2.0/3.0, 1e23, 123.456e-150, -9.5367431640625e-07}){
+    std::ostringstream os;
+    os << Atom(v);
+    Atom a{Token(os.str())};
+    REQUIRE(a.asNumber() == v);
+  }
+
+  // an explicitly requested format is honored
+  std::ostringstream os;
+  os << std::fixed << Atom(1.5);
+  REQUIRE(os.str() == "1.500000");
+}
+
+TEST_CASE( "Test moving atoms", "[atom]" ) {
+
+  Atom a("hi");
+  Atom b(std::move(a));
+  REQUIRE(b.asSymbol() == "hi");
+  REQUIRE(a.isNone());
+
+  Atom c(std::complex<double>(1, 2));
+  c = std::move(b);
+  REQUIRE(c.asSymbol() == "hi");
+  REQUIRE(b.isNone());
+
+  Atom d(std::complex<double>(1, 2));
+  c = std::move(d);
+  REQUIRE(c.asComplex() == std::complex<double>(1, 2));
+  REQUIRE(d.isNone());
+
+  c = std::move(c);
+  REQUIRE(c.isComplex());
+}
+
+TEST_CASE( "Test plot atoms", "[atom]" ) {
+
+  std::shared_ptr<PlotBuffer> buffer = std::make_shared<PlotBuffer>();
+  buffer->add_point(1, 2, 0.5);
+  buffer->add_line(0, 0, 1, 1, 0);
+
+  std::shared_ptr<const PlotBuffer> shared = buffer;
+  Atom a(shared);
+  REQUIRE(a.isPlot());
+  REQUIRE(!a.isNone());
+  REQUIRE(!a.isNumber());
+  REQUIRE(!a.isSymbol());
+  REQUIRE(!a.isComplex());
+  REQUIRE(a.asPlot() == buffer);
+  REQUIRE(a.asSymbol() == "");
+  REQUIRE(Atom(1.).asPlot() == nullptr);
+
+  // copies share the plot, equality compares the primitives
+  Atom b(a);
+  REQUIRE(b.asPlot() == buffer);
+  REQUIRE(b == a);
+  std::shared_ptr<PlotBuffer> other = std::make_shared<PlotBuffer>(*buffer);
+  REQUIRE(Atom(std::shared_ptr<const PlotBuffer>(other)) == a);
+  other->add_text(0, 0, "\"t\"", 1, 0);
+  REQUIRE(Atom(std::shared_ptr<const PlotBuffer>(other)) != a);
+  REQUIRE(a != Atom("plot"));
+
+  // assigning over and from every kind releases the plot
+  Atom c("symbol");
+  c = a;
+  REQUIRE(c.asPlot() == buffer);
+  c = Atom(2.);
+  REQUIRE(c.isNumber());
+  c = std::move(b);
+  REQUIRE(c.asPlot() == buffer);
+  REQUIRE(b.isNone());
+  c = Atom("s");
+  REQUIRE(c.asSymbol() == "s");
+  c = a;
+  c = c;
+  c = std::move(c);
+  REQUIRE(c.isPlot());
+  REQUIRE(buffer.use_count() == 4);
+  c = Atom();
+  REQUIRE(buffer.use_count() == 3);
+}
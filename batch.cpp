@@ -0,0 +1,120 @@
+#include "batch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "interpreter.hpp"
+#include "script_file.hpp"
+#include "semantic_error.hpp"
+
+namespace {
+
+// parse a program into interp, as the command line does
+bool parse_file(Interpreter & interp, const ScriptFile & file, ScriptCache & cache){
+
+  if(is_compiled(file.data(), file.size())){
+    SourceDigest source;
+    return interp.parseCompiled(file.data(), file.size(), source);
+  }
+  return cache.parse(interp, file.data(), file.size());
+}
+
+// evaluate the result for file, leaving ok, output and milliseconds
+void evaluate_into(BatchResult & result, ScriptCache & cache){
+
+  result.ok = false;
+
+  ScriptFile file;
+  if(!file.open(result.file)){
+    result.output = "Error: Could not open file for reading.";
+    return;
+  }
+
+  Interpreter interp;
+  try{
+    // a startup file that fails to load leaves the default environment,
+    // as it does for a single program
+    interp.startup();
+  }
+  catch(const SemanticError &){
+  }
+
+  if(!parse_file(interp, file, cache)){
+    result.output = "Error: Invalid Program. Could not parse.";
+    return;
+  }
+
+  try{
+    std::ostringstream out;
+    out << interp.evaluate();
+    result.output = out.str();
+    result.ok = true;
+  }
+  catch(const SemanticError & ex){
+    result.output = ex.what();
+  }
+}
+
+} // namespace
+
+BatchResult evaluate_file(const std::string & file, ScriptCache & cache){
+
+  BatchResult result;
+  result.file = file;
+
+  auto start = std::chrono::steady_clock::now();
+  evaluate_into(result, cache);
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  result.milliseconds = elapsed.count();
+
+  return result;
+}
+
+std::vector<BatchResult> run_batch(const std::vector<std::string> & files, std::size_t workers, ScriptCache & cache){
+
+  std::vector<BatchResult> results(files.size());
+
+  // workers claim the next file in order, so long programs do not hold
+  // up a fixed share of the batch
+  std::atomic<std::size_t> next(0);
+  auto work = [&](){
+    for(std::size_t i = next++; i < files.size(); i = next++){
+      results[i] = evaluate_file(files[i], cache);
+    }
+  };
+
+  if(workers > files.size()) workers = files.size();
+
+  std::vector<std::thread> threads;
+  for(std::size_t i = 1; i < workers; ++i){
+    threads.emplace_back(work);
+  }
+  work();
+  for(auto & thread : threads){
+    thread.join();
+  }
+
+  return results;
+}
+
+bool read_manifest(const std::string & manifest, std::vector<std::string> & files){
+
+  std::ifstream in(manifest);
+  if(!in){
+    return false;
+  }
+
+  std::string line;
+  while(std::getline(in, line)){
+    std::size_t first = line.find_first_not_of(" \t\r");
+    if(first == std::string::npos || line[first] == ';'){
+      continue;
+    }
+    std::size_t last = line.find_last_not_of(" \t\r");
+    files.push_back(line.substr(first, last - first + 1));
+  }
+  return true;
+}
@@ -0,0 +1,55 @@
+/*! \file batch.hpp
+Defines batch evaluation, which runs many independent programs
+concurrently on a pool of worker threads.
+
+Every program is evaluated in its own Interpreter, starting from the
+startup environment, so programs cannot see each other's definitions.
+ */
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "script_cache.hpp"
+
+/*! \struct BatchResult
+\brief The outcome of evaluating one program of a batch
+*/
+struct BatchResult {
+  /// the file the program was read from
+  std::string file;
+
+  /// false if the program could not be read, parsed or evaluated
+  bool ok;
+
+  /// the printed result, or the error message
+  std::string output;
+
+  /// wall time to read, parse and evaluate the program
+  double milliseconds;
+};
+
+/*! \fn BatchResult evaluate_file(const std::string & file, ScriptCache & cache)
+\brief Read, parse and evaluate the program in a file in a fresh Interpreter
+*/
+BatchResult evaluate_file(const std::string & file, ScriptCache & cache);
+
+/*! \fn std::vector<BatchResult> run_batch(const std::vector<std::string> & files, std::size_t workers, ScriptCache & cache)
+\brief Evaluate the programs in files on workers threads
+\return a result for each file, in the order of files
+*/
+std::vector<BatchResult> run_batch(const std::vector<std::string> & files, std::size_t workers, ScriptCache & cache);
+
+/*! \fn bool read_manifest(const std::string & manifest, std::vector<std::string> & files)
+\brief Append the files listed in a manifest to files
+
+A manifest lists one file per line. Blank lines and lines starting
+with ; are ignored.
+
+\return false if the manifest cannot be read
+*/
+bool read_manifest(const std::string & manifest, std::vector<std::string> & files);
+
+#endif
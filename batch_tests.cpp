@@ -0,0 +1,75 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "batch.hpp"
+
+void write_file(const std::string & file, const std::string & text){
+
+  std::ofstream(file) << text;
+}
+
+TEST_CASE( "Test evaluating a batch of programs", "[batch]" ) {
+
+  write_file("batch_test_1.pls", "(begin (define a 3) (+ a 1))");
+  write_file("batch_test_2.pls", "(+ a 1)");
+  write_file("batch_test_3.pls", "(+ 1 2");
+  write_file("batch_test_4.pls", "(begin (define a 10) (* a pi))");
+
+  std::vector<std::string> files = {"batch_test_1.pls", "batch_test_2.pls",
+				    "batch_test_3.pls", "batch_test_missing.pls",
+				    "batch_test_4.pls"};
+
+  ScriptCache cache("");
+
+  for(std::size_t workers : {1, 2, 8}){
+    INFO("with " << workers << " workers");
+
+    std::vector<BatchResult> results = run_batch(files, workers, cache);
+    REQUIRE(results.size() == files.size());
+
+    for(std::size_t i = 0; i < files.size(); ++i){
+      REQUIRE(results[i].file == files[i]);
+      REQUIRE(results[i].milliseconds >= 0);
+    }
+
+    REQUIRE(results[0].ok);
+    REQUIRE(results[0].output == "(4)");
+
+    // programs do not see each other's definitions
+    REQUIRE(!results[1].ok);
+    REQUIRE(results[1].output.find("Error") == 0);
+
+    REQUIRE(!results[2].ok);
+    REQUIRE(results[2].output == "Error: Invalid Program. Could not parse.");
+
+    REQUIRE(!results[3].ok);
+    REQUIRE(results[3].output == "Error: Could not open file for reading.");
+
+    REQUIRE(results[4].ok);
+    REQUIRE(results[4].output == "(31.41592653589793)");
+  }
+
+  REQUIRE(run_batch({}, 4, cache).empty());
+
+  for(const std::string & file : files){
+    std::remove(file.c_str());
+  }
+}
+
+TEST_CASE( "Test reading a batch manifest", "[batch]" ) {
+
+  write_file("batch_test_manifest", "; nightly reports\n\nfirst.pls\n  second.pls \r\n;third.pls\n");
+
+  std::vector<std::string> files = {"zeroth.pls"};
+  REQUIRE(read_manifest("batch_test_manifest", files));
+  REQUIRE(files == std::vector<std::string>({"zeroth.pls", "first.pls", "second.pls"}));
+
+  REQUIRE(!read_manifest("batch_test_missing_manifest", files));
+  REQUIRE(files.size() == 3);
+
+  std::remove("batch_test_manifest");
+}
@@ -1,9 +1,94 @@
 #include "consumer.hpp"
 
-Consumer::Consumer(inputQueue *inQ, outputQueue *outQ, Interpreter *interpreter) {
+#include <cstdlib>
+
+Consumer::Consumer(inputQueue *inQ, outputQueue *outQ, Interpreter *interpreter,
+		   std::function<void()> notified,
+		   const std::atomic<std::uint64_t> *interrupted_through) {
 	
   inq = inQ;
   outq = outQ;
   interp = interpreter;
+  notify = notified;
+  interrupted = interrupted_through;
+}
+
+
+bool wait_for_result(outputQueue & outQ, std::uint64_t id, Expression & result,
+		     std::chrono::milliseconds timeout) {
+
+  typedef std::chrono::steady_clock clock;
+  clock::time_point deadline = clock::now() + timeout;
+
+  KernelResult popped;
+  while (outQ.wait_for_and_pop(popped, deadline - clock::now())) {
+    if (popped.id == id) {
+      result = std::move(popped.exp);
+      return true;
+    }
+  }
+  return false;
 }
 
+
+std::string format_stats(const std::string & name, const QueueStats & stats) {
+
+  std::ostringstream out;
+  out << name << " queue: depth " << stats.depth;
+  if (stats.capacity > 0) {
+    out << "/" << stats.capacity;
+  }
+  out << ", high water " << stats.high_water
+      << ", pushed " << stats.pushed
+      << ", rejected " << stats.rejected
+      << ", dropped " << stats.dropped;
+  return out.str();
+}
+
+
+bool parse_overflow_policy(const std::string & name, OverflowPolicy & policy) {
+
+  if (name == "block") {
+    policy = BLOCK_PRODUCER;
+  }
+  else if (name == "reject") {
+    policy = REJECT_NEWEST;
+  }
+  else if (name == "drop-oldest") {
+    policy = DROP_OLDEST;
+  }
+  else {
+    return false;
+  }
+  return true;
+}
+
+
+bool parse_queue_capacity(const std::string & text, std::size_t & capacity) {
+
+  if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  std::size_t value = std::strtoul(text.c_str(), nullptr, 10);
+  if (value == 0) {
+    return false;
+  }
+  capacity = value;
+  return true;
+}
+
+
+bool kernel_queue_options_from_env(KernelQueueOptions & options, std::string & message) {
+
+  const char * capacity = std::getenv("PLOTSCRIPT_QUEUE_CAPACITY");
+  if (capacity != nullptr && !parse_queue_capacity(capacity, options.capacity)) {
+    message = "PLOTSCRIPT_QUEUE_CAPACITY must be a positive number";
+    return false;
+  }
+  const char * policy = std::getenv("PLOTSCRIPT_QUEUE_POLICY");
+  if (policy != nullptr && !parse_overflow_policy(policy, options.policy)) {
+    message = "PLOTSCRIPT_QUEUE_POLICY must be block, reject or drop-oldest";
+    return false;
+  }
+  return true;
+}
@@ -1,60 +1,200 @@
 #ifndef CONSUMER_HPP
 #define CONSUMER_HPP
 
+#include <atomic>
 #include <string>
 #include <sstream>
 #include <iostream>
 #include <fstream>
 #include <thread>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
 
 #include "interpreter.hpp"
+#include "parse.hpp"
 #include "semantic_error.hpp"
 #include "message_queue.hpp"
+#include "spsc_queue.hpp"
 
-typedef message_queue<std::string> inputQueue;
-typedef message_queue<Expression> outputQueue;
+/// a line sent to the kernel, id is 0 for kernel commands (%stop, ...)
+struct KernelRequest {
+	std::uint64_t id;
+	std::string line;
+};
+
+/// the result of the request with the same id
+struct KernelResult {
+	std::uint64_t id;
+	Expression exp;
+};
+
+// the queues between the front end and the kernel each have one producer
+// and one consumer thread, configure with -DSPSC_QUEUES=OFF to use locking
+// queues instead
+#ifdef PLOTSCRIPT_SPSC_QUEUES
+typedef spsc_queue<KernelRequest> inputQueue;
+typedef spsc_queue<KernelResult> outputQueue;
+#else
+typedef message_queue<KernelRequest> inputQueue;
+typedef message_queue<KernelResult> outputQueue;
+#endif
+
+/// the default bound on requests waiting for the kernel used by the front
+/// ends; the parser stage holds up to PARSE_AHEAD more
+const std::size_t KERNEL_INPUT_CAPACITY = 1024;
+
+/// the bound and overflow policy of a front end's kernel input queue
+struct KernelQueueOptions {
+	std::size_t capacity = KERNEL_INPUT_CAPACITY;
+	OverflowPolicy policy = BLOCK_PRODUCER;
+};
+
+/*! Parse the name of an overflow policy
+  \param name "block", "reject" or "drop-oldest"
+  \param policy set to the policy named
+  \return false if name is not a policy
+ */
+bool parse_overflow_policy(const std::string & name, OverflowPolicy & policy);
+
+/*! Parse the capacity of a kernel input queue
+  \param text a positive decimal number
+  \param capacity set to the number
+  \return false if text is not a positive number
+ */
+bool parse_queue_capacity(const std::string & text, std::size_t & capacity);
+
+/*! Read the kernel input queue options from the PLOTSCRIPT_QUEUE_CAPACITY
+  and PLOTSCRIPT_QUEUE_POLICY environment variables, keeping the defaults
+  for those that are not set
+  \param options set to the options read
+  \param message set to an error message for a variable that is not valid
+  \return false if a variable is not valid
+ */
+bool kernel_queue_options_from_env(KernelQueueOptions & options, std::string & message);
+
+/*! Describe the statistics of a kernel queue, for %stats
+  \param name the name of the queue
+  \param stats its statistics
+  \return a line such as "input queue: depth 0/1024, high water 3, pushed 10, rejected 0, dropped 0"
+ */
+std::string format_stats(const std::string & name, const QueueStats & stats);
+
+/*! Wait for the result of request id, discarding the results of earlier
+  requests (whose front end stopped waiting, e.g. on an interrupt).
+  \param outQ the kernel output queue
+  \param id the request to wait for
+  \param result set to the result
+  \param timeout how long to wait
+  \return false if the result did not arrive in time
+ */
+bool wait_for_result(outputQueue & outQ, std::uint64_t id, Expression & result,
+		     std::chrono::milliseconds timeout);
+
+/// a request after the parser stage of the kernel, command is set for
+/// %stop, %reset and %exit, which end the kernel
+struct ParsedRequest {
+	std::uint64_t id;
+	bool command;
+	Expression ast;
+};
+
+/// the most requests the parser stage runs ahead of evaluation
+const std::size_t PARSE_AHEAD = 64;
+
+/*! \class Consumer
+\brief The interpreter kernel, evaluates the requests in an input queue
+
+The kernel is a pipeline of two threads. The parser stage pops requests
+and parses them into a bounded queue of ASTs, so parsing later requests
+overlaps evaluating earlier ones; the evaluator stage (the thread calling
+operator()) evaluates them in order and delivers each result, or the
+parse or semantic error, to the output queue.
 
+A front end interrupts every request up to an id by storing it in the
+interrupted counter given to the kernel: the request being evaluated stops
+at its next evaluation step, and later ones up to the id are not started,
+each with the result "Error: interpreter kernel interrupted".
+*/
 class Consumer {
 public:
-	Consumer(inputQueue *inQ, outputQueue *outQ, Interpreter *interpreter);
+	/// notified is called on the kernel thread after each result is pushed,
+	/// e.g. to wake a front end event loop; interrupted, if given, is the
+	/// id of the last request to interrupt (see above)
+	Consumer(inputQueue *inQ, outputQueue *outQ, Interpreter *interpreter,
+		 std::function<void()> notified = std::function<void()>(),
+		 const std::atomic<std::uint64_t> *interrupted = nullptr);
 
 	void operator()() const {
-		std::string line;
+		spsc_queue<ParsedRequest> parsed(PARSE_AHEAD);
+		std::thread parser(&Consumer::parse_requests, this, std::ref(parsed));
+
+		ParsedRequest request;
 		while (true) {
-			inq->wait_and_pop(line);
-			if (line == "%stop" || line == "%reset" || line == "%exit") {
+			parsed.wait_and_pop(request);
+			if (request.command) {
 				break;
 			}
-			else if (line == "%start") {}
-			else {
-				std::istringstream expression(line);
 
-				Expression exp;
+			Expression exp;
 
-				if (!interp->parseStream(expression)) {
-					exp = (Atom("Error: Invalid Expression. Could not parse."));
-					outq->push(exp);
+			if (interrupted && request.id <= interrupted->load()) {
+				exp = (Atom("Error: interpreter kernel interrupted"));
+				deliver(request.id, exp);
+			}
+			else if (!interp->parseExpression(std::move(request.ast))) {
+				exp = (Atom("Error: Invalid Expression. Could not parse."));
+				deliver(request.id, exp);
+			}
+			else {
+				try {
+					InterruptScope scope(interrupted, request.id);
+					exp = interp->evaluate();
+					deliver(request.id, exp);
 				}
-				else {
-					try {
-						exp = interp->evaluate();
-						outq->push(exp);
-					}
-					catch (const SemanticError & ex) {
-						std::string error(ex.what());
-						exp = (Atom(error));
-						outq->push(exp);
-					}
+				catch (const SemanticError & ex) {
+					std::string error(ex.what());
+					exp = (Atom(error));
+					deliver(request.id, exp);
 				}
 			}
-		}		
+		}
+		parser.join();
 	}
 
 private:
 	inputQueue *inq;
 	outputQueue *outq;
 	Interpreter *interp;
+	std::function<void()> notify;
+	const std::atomic<std::uint64_t> *interrupted;
+
+	// the parser stage, runs until it passes on a command that ends the
+	// kernel, so later requests stay in the input queue for the next one
+	void parse_requests(spsc_queue<ParsedRequest> & parsed) const {
+		KernelRequest request;
+		while (true) {
+			inq->wait_and_pop(request);
+			const std::string & line = request.line;
+			if (line == "%stop" || line == "%reset" || line == "%exit") {
+				parsed.push({request.id, true, Expression()});
+				return;
+			}
+			else if (line == "%start") {}
+			else {
+				// the None Expression if it could not be parsed
+				parsed.push({request.id, false, parse(line.data(), line.size())});
+			}
+		}
+	}
+
+	// move the result into the output queue, large plots are not copied
+	void deliver(std::uint64_t id, Expression & exp) const {
+		outq->push({id, std::move(exp)});
+		if (notify) notify();
+	}
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "decimate.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+std::vector<std::size_t> decimate_min_max(const std::vector<double> & xs, const std::vector<double> & ys, std::size_t count){
+
+  std::size_t n = xs.size();
+  std::vector<std::size_t> kept;
+  if(n <= count){
+    for(std::size_t i = 0; i < n; ++i) kept.push_back(i);
+    return kept;
+  }
+
+  std::size_t columns = std::max<std::size_t>(count / 2, 1);
+  auto range = std::minmax_element(xs.begin(), xs.end());
+  double lower = *range.first;
+  double width = *range.second - lower;
+
+  // the index of the lowest and highest point of each column, n if empty
+  std::vector<std::size_t> low(columns, n), high(columns, n);
+  for(std::size_t i = 0; i < n; ++i){
+    std::size_t c = (width > 0) ? static_cast<std::size_t>((xs[i] - lower) / width * columns) : 0;
+    if(c >= columns) c = columns - 1;
+    if(low[c] == n || ys[i] < ys[low[c]]) low[c] = i;
+    if(high[c] == n || ys[i] > ys[high[c]]) high[c] = i;
+  }
+
+  for(std::size_t c = 0; c < columns; ++c){
+    if(low[c] == n) continue;
+    kept.push_back(low[c]);
+    if(high[c] != low[c]) kept.push_back(high[c]);
+  }
+  std::sort(kept.begin(), kept.end());
+  return kept;
+}
+
+std::vector<std::size_t> decimate_lttb(const std::vector<double> & xs, const std::vector<double> & ys, std::size_t count){
+
+  std::size_t n = xs.size();
+  std::vector<std::size_t> order(n);
+  for(std::size_t i = 0; i < n; ++i) order[i] = i;
+  if(!std::is_sorted(xs.begin(), xs.end())){
+    std::stable_sort(order.begin(), order.end(), [&xs](std::size_t a, std::size_t b){ return xs[a] < xs[b]; });
+  }
+
+  count = std::max<std::size_t>(count, 3);
+  if(n <= count){
+    return order;
+  }
+
+  std::vector<std::size_t> kept;
+  kept.reserve(count);
+  kept.push_back(order[0]);
+
+  // the points between the first and last fill count - 2 buckets
+  double size = static_cast<double>(n - 2) / (count - 2);
+  std::size_t a = order[0];
+  for(std::size_t b = 0; b + 2 < count; ++b){
+
+    std::size_t first = static_cast<std::size_t>(std::floor(b * size)) + 1;
+    std::size_t last = std::min(static_cast<std::size_t>(std::floor((b + 1) * size)) + 1, n - 1);
+
+    // the average of the next bucket, which is the last point after the last bucket
+    std::size_t next_last = std::min(static_cast<std::size_t>(std::floor((b + 2) * size)) + 1, n);
+    next_last = std::max(next_last, last + 1);
+    double cx = 0, cy = 0;
+    for(std::size_t j = last; j < next_last; ++j){
+      cx += xs[order[j]];
+      cy += ys[order[j]];
+    }
+    cx /= (next_last - last);
+    cy /= (next_last - last);
+
+    std::size_t best = order[first];
+    double largest = -1;
+    for(std::size_t j = first; j < last; ++j){
+      std::size_t p = order[j];
+      double area = std::fabs((xs[a] - cx) * (ys[p] - ys[a]) - (xs[a] - xs[p]) * (cy - ys[a]));
+      if(area > largest){
+	largest = area;
+	best = p;
+      }
+    }
+    kept.push_back(best);
+    a = best;
+  }
+
+  kept.push_back(order[n - 1]);
+  return kept;
+}
@@ -0,0 +1,51 @@
+/*! \file decimate.hpp
+Defines the decimation used by discrete-plot to draw long series.
+
+Both methods choose which points of a series to keep, by index, without
+moving any of them. Min-max keeps the lowest and highest point of each
+column of the abscissa range, so every extreme survives. Largest triangle
+three buckets keeps one point per bucket of consecutive points, the one
+making the largest triangle with its neighbours, so the shape survives.
+ */
+#ifndef DECIMATE_HPP
+#define DECIMATE_HPP
+
+#include <cstddef>
+#include <vector>
+
+/// how discrete-plot thins a long series
+enum DecimationMethod {
+  NO_DECIMATION,     ///< plot every point
+  MIN_MAX_DECIMATION, ///< keep the extremes of each column
+  LTTB_DECIMATION    ///< keep the largest triangle of each bucket
+};
+
+/// the most points discrete-plot draws before decimating
+const std::size_t DECIMATION_THRESHOLD = 4000;
+
+/*! \fn std::vector<std::size_t> decimate_min_max(const std::vector<double> & xs, const std::vector<double> & ys, std::size_t count)
+\brief Keep the lowest and highest point of count / 2 columns
+
+The columns split [min xs, max xs] evenly. Points need not be in order.
+
+\param xs the abscissas
+\param ys the ordinates, the same size as xs
+\param count the most points to keep, at least 2
+\return the indices of the kept points, in increasing order
+*/
+std::vector<std::size_t> decimate_min_max(const std::vector<double> & xs, const std::vector<double> & ys, std::size_t count);
+
+/*! \fn std::vector<std::size_t> decimate_lttb(const std::vector<double> & xs, const std::vector<double> & ys, std::size_t count)
+\brief Keep count points by largest triangle three buckets
+
+The points are taken in order of abscissa. The first and last are always
+kept.
+
+\param xs the abscissas
+\param ys the ordinates, the same size as xs
+\param count the points to keep, at least 3
+\return the indices of the kept points, in order of abscissa
+*/
+std::vector<std::size_t> decimate_lttb(const std::vector<double> & xs, const std::vector<double> & ys, std::size_t count);
+
+#endif
@@ -0,0 +1,123 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "decimate.hpp"
+
+// a noisy series with a spike and a dip
+void series(std::size_t n, std::vector<double> & xs, std::vector<double> & ys){
+
+  xs.resize(n);
+  ys.resize(n);
+  for(std::size_t i = 0; i < n; ++i){
+    xs[i] = static_cast<double>(i) / 10;
+    ys[i] = std::sin(xs[i]) + 0.1 * std::sin(37 * xs[i]);
+  }
+  ys[n / 3] = 50;
+  ys[2 * n / 3] = -50;
+}
+
+bool contains(const std::vector<std::size_t> & kept, std::size_t i){
+  return std::find(kept.begin(), kept.end(), i) != kept.end();
+}
+
+TEST_CASE( "Test min-max decimation", "[decimate]" ) {
+
+  std::vector<double> xs, ys;
+  series(100000, xs, ys);
+
+  {
+    INFO("short series are kept whole");
+    std::vector<std::size_t> kept = decimate_min_max(xs, ys, xs.size());
+    REQUIRE(kept.size() == xs.size());
+  }
+
+  std::vector<std::size_t> kept = decimate_min_max(xs, ys, 1000);
+  REQUIRE(kept.size() <= 1000);
+  REQUIRE(kept.size() > 900);
+  REQUIRE(std::is_sorted(kept.begin(), kept.end()));
+  REQUIRE(std::adjacent_find(kept.begin(), kept.end()) == kept.end());
+
+  // the extremes survive
+  REQUIRE(contains(kept, xs.size() / 3));
+  REQUIRE(contains(kept, 2 * xs.size() / 3));
+
+  {
+    INFO("each column keeps its lowest and highest point");
+    std::size_t columns = 500;
+    double width = xs.back() - xs.front();
+    for(std::size_t c = 0; c < columns; c += 97){
+      double low = 1e9, high = -1e9;
+      for(std::size_t i = 0; i < xs.size(); ++i){
+        std::size_t column = std::min(static_cast<std::size_t>((xs[i] - xs.front()) / width * columns), columns - 1);
+        if(column == c){
+          low = std::min(low, ys[i]);
+          high = std::max(high, ys[i]);
+        }
+      }
+      bool found_low = false, found_high = false;
+      for(std::size_t k : kept){
+        found_low = found_low || ys[k] == low;
+        found_high = found_high || ys[k] == high;
+      }
+      REQUIRE(found_low);
+      REQUIRE(found_high);
+    }
+  }
+
+  {
+    INFO("points out of order and all at one abscissa");
+    std::vector<double> same(10, 2), values = {3, 1, 4, 1, 5, 9, 2, 6, 5, 3};
+    std::vector<std::size_t> one = decimate_min_max(same, values, 4);
+    REQUIRE(one == std::vector<std::size_t>({1, 5}));
+  }
+}
+
+TEST_CASE( "Test largest triangle three buckets decimation", "[decimate]" ) {
+
+  std::vector<double> xs, ys;
+  series(100000, xs, ys);
+
+  std::vector<std::size_t> kept = decimate_lttb(xs, ys, 1000);
+  REQUIRE(kept.size() == 1000);
+  REQUIRE(kept.front() == 0);
+  REQUIRE(kept.back() == xs.size() - 1);
+  REQUIRE(std::is_sorted(kept.begin(), kept.end()));
+  REQUIRE(std::adjacent_find(kept.begin(), kept.end()) == kept.end());
+
+  // a spike makes the largest triangle in its bucket
+  REQUIRE(contains(kept, xs.size() / 3));
+  REQUIRE(contains(kept, 2 * xs.size() / 3));
+
+  {
+    INFO("short series are kept whole");
+    std::vector<std::size_t> all = decimate_lttb(xs, ys, xs.size() + 1);
+    REQUIRE(all.size() == xs.size());
+  }
+
+  {
+    INFO("points are taken in order of abscissa");
+    std::vector<double> rx(xs.rbegin(), xs.rend()), ry(ys.rbegin(), ys.rend());
+    std::vector<std::size_t> reversed = decimate_lttb(rx, ry, 1000);
+    REQUIRE(reversed.size() == 1000);
+    for(std::size_t i = 0; i < reversed.size(); ++i){
+      REQUIRE(reversed[i] == xs.size() - 1 - kept[i]);
+    }
+  }
+
+  {
+    INFO("every size just over the count");
+    for(std::size_t n = 4; n < 40; ++n){
+      std::vector<double> sx, sy;
+      series(n, sx, sy);
+      for(std::size_t count = 3; count < n; ++count){
+        std::vector<std::size_t> few = decimate_lttb(sx, sy, count);
+        REQUIRE(few.size() == count);
+        REQUIRE(std::is_sorted(few.begin(), few.end()));
+        REQUIRE(std::adjacent_find(few.begin(), few.end()) == few.end());
+      }
+    }
+  }
+}
@@ -18,6 +18,21 @@ bool nargs_equal(const std::vector<Expression> & args, unsigned nargs){
   return args.size() == nargs;
 }
 
+Expression call_procedure(Procedure proc, const std::vector<Expression> & args){
+
+  for(auto & arg : args){
+    if(arg.isHeadPlot()){
+      std::vector<Expression> expanded;
+      expanded.reserve(args.size());
+      for(auto & a : args){
+        expanded.push_back(a.expanded());
+      }
+      return proc(expanded);
+    }
+  }
+  return proc(args);
+}
+
 /*********************************************************************** 
 Each of the functions below have the signature that corresponds to the
 typedef'd Procedure function pointer.
@@ -622,7 +637,7 @@ Expression apply(const std::vector<Expression> & args, Environment & env) {
 				Procedure proc = env.get_proc(args[0].head());
 
 				// call proc with args
-				return proc(listResults);
+				return call_procedure(proc, listResults);
 			}
 			else {
 				throw SemanticError("Error in call to apply: second argument must be a list.");
@@ -727,7 +742,7 @@ Expression map(const std::vector<Expression> & args, Environment & env) {
 				int listSize = listResults.size();
 				for (int i = 0; i < listSize; i++) {
 					arguments.push_back(listResults[i]);
-					result.push_back(proc(arguments));
+					result.push_back(call_procedure(proc, arguments));
 					arguments.clear();
 				}			
 			}
@@ -891,28 +906,177 @@ Expression map(const std::vector<Expression> & args, Environment & env) {
 	return Expression(result);
 }
 
-const double PI = std::atan2(0, -1);
-const double negPI = -(std::atan2(0, -1));
-const double EXP = std::exp(1);
-const std::complex<double> I(0,1);
-const std::complex<double> negI(0,-1);
+/***********************************************************************
+The built-in symbols, in a table indexed by a perfect hash of their
+names. Environments consult the table before their own map, so creating
+or resetting an environment does not construct any built-in.
+**********************************************************************/
+
+namespace {
+
+enum BuiltinKind {NoBuiltin, NumberBuiltin, ComplexBuiltin, ProcedureBuiltin, SpecialBuiltin};
+
+struct Builtin {
+  const char * name;
+  BuiltinKind kind;
+  double re; // value of a NumberBuiltin, real part of a ComplexBuiltin
+  double im; // imaginary part of a ComplexBuiltin
+  Procedure proc;
+  SpecialProc spec;
+};
+
+const std::size_t BUILTIN_SLOTS = 64;
+
+// perfect on the names below, checked by the static_assert
+constexpr std::size_t builtin_hash(const char * name, std::size_t n){
+  return (n + 12u * static_cast<unsigned char>(name[0]) +
+          18u * static_cast<unsigned char>(name[n - 1])) & (BUILTIN_SLOTS - 1);
+}
+
+constexpr Builtin BUILTINS[BUILTIN_SLOTS] = {
+  {"-I", ComplexBuiltin, 0, -1, nullptr, nullptr},
+  {"-pi", NumberBuiltin, -3.14159265358979323846, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"/", ProcedureBuiltin, 0, 0, div, nullptr},
+  {"rest", ProcedureBuiltin, 0, 0, rest, nullptr},
+  {"^", ProcedureBuiltin, 0, 0, expo, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"-", ProcedureBuiltin, 0, 0, subneg, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"+", ProcedureBuiltin, 0, 0, add, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"arg", ProcedureBuiltin, 0, 0, arg, nullptr},
+  {"ln", ProcedureBuiltin, 0, 0, ln, nullptr},
+  {"I", ComplexBuiltin, 0, 1, nullptr, nullptr},
+  {"sqrt", ProcedureBuiltin, 0, 0, sqrt, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"apply", SpecialBuiltin, 0, 0, nullptr, apply},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"e", NumberBuiltin, 2.71828182845904523536, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"append", ProcedureBuiltin, 0, 0, append, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"conj", ProcedureBuiltin, 0, 0, conj, nullptr},
+  {"mag", ProcedureBuiltin, 0, 0, mag, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"sin", ProcedureBuiltin, 0, 0, sin, nullptr},
+  {"pi", NumberBuiltin, 3.14159265358979323846, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"length", ProcedureBuiltin, 0, 0, length, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"lambda", SpecialBuiltin, 0, 0, nullptr, lambda},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"*", ProcedureBuiltin, 0, 0, mul, nullptr},
+  {"imag", ProcedureBuiltin, 0, 0, imag, nullptr},
+  {"tan", ProcedureBuiltin, 0, 0, tan, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"real", ProcedureBuiltin, 0, 0, real, nullptr},
+  {"first", ProcedureBuiltin, 0, 0, first, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"range", ProcedureBuiltin, 0, 0, range, nullptr},
+  {"join", ProcedureBuiltin, 0, 0, join, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"list", ProcedureBuiltin, 0, 0, list, nullptr},
+  {"cos", ProcedureBuiltin, 0, 0, cos, nullptr},
+  {"", NoBuiltin, 0, 0, nullptr, nullptr},
+  {"map", SpecialBuiltin, 0, 0, nullptr, map},
+};
 
-Environment::Environment(){
+constexpr std::size_t name_length(const char * name){
+  return (*name == '\0') ? 0 : 1 + name_length(name + 1);
+}
 
-  reset();
+constexpr bool slots_from(std::size_t i){
+  return (i == BUILTIN_SLOTS) ||
+    (((BUILTINS[i].kind == NoBuiltin) ||
+      (builtin_hash(BUILTINS[i].name, name_length(BUILTINS[i].name)) == i)) &&
+     slots_from(i + 1));
+}
+
+static_assert(slots_from(0), "every built-in must be in the slot of its hash");
+
+// return the slot of the built-in name, or -1
+int find_builtin(const std::string & name){
+
+  if(name.empty()) return -1;
+
+  std::size_t slot = builtin_hash(name.data(), name.size());
+  const Builtin & b = BUILTINS[slot];
+  return ((b.kind != NoBuiltin) && (name == b.name)) ? static_cast<int>(slot) : -1;
+}
+
+Expression builtin_exp(int slot){
+
+  const Builtin & b = BUILTINS[slot];
+  if(b.kind == NumberBuiltin){
+    return Expression(b.re);
+  }
+  if(b.kind == ComplexBuiltin){
+    return Expression(std::complex<double>(b.re, b.im));
+  }
+  return Expression();
+}
+
+bool is_builtin_exp(int slot){
+  return (BUILTINS[slot].kind == NumberBuiltin) || (BUILTINS[slot].kind == ComplexBuiltin);
+}
+
+} // namespace
+
+Environment::Environment(): hidden(0), parent(nullptr) {}
+
+Environment::Environment(const Environment * parent): hidden(parent->hidden), parent(parent) {}
+
+int Environment::builtin(const Atom & sym) const{
+
+  if(!sym.isSymbol()) return -1;
+
+  int slot = find_builtin(sym.asSymbol());
+  if((slot < 0) || (hidden & (std::uint64_t(1) << slot))) return -1;
+  return slot;
+}
+
+const Environment::EnvResult * Environment::find(const std::string & name) const{
+
+  for(const Environment * frame = this; frame; frame = frame->parent){
+    auto result = frame->envmap.find(name);
+    if(result != frame->envmap.end()) return &result->second;
+  }
+  return nullptr;
 }
 
 bool Environment::is_known(const Atom & sym) const{
   if(!sym.isSymbol()) return false;
   
-  return envmap.find(sym.asSymbol()) != envmap.end();
+  return (builtin(sym) >= 0) || find(sym.asSymbol());
 }
 
 bool Environment::is_exp(const Atom & sym) const{
   if(!sym.isSymbol()) return false;
+
+  int slot = builtin(sym);
+  if(slot >= 0) return is_builtin_exp(slot);
   
-  auto result = envmap.find(sym.asSymbol());
-  return (result != envmap.end()) && (result->second.type == ExpressionType);
+  const EnvResult * result = find(sym.asSymbol());
+  return result && (result->type == ExpressionType);
 }
 
 Expression Environment::get_exp(const Atom & sym) const{
@@ -920,9 +1084,14 @@ Expression Environment::get_exp(const Atom & sym) const{
   Expression exp;
   
   if(sym.isSymbol()){
-    auto result = envmap.find(sym.asSymbol());
-    if((result != envmap.end()) && (result->second.type == ExpressionType)){
-      exp = result->second.exp;
+    int slot = builtin(sym);
+    if(slot >= 0){
+      return builtin_exp(slot);
+    }
+    
+    const EnvResult * result = find(sym.asSymbol());
+    if(result && (result->type == ExpressionType)){
+      exp = result->exp;
     }
   }
 
@@ -936,33 +1105,56 @@ void Environment::add_exp(const Atom & sym, const Expression & exp){
   }
     
   // error if overwriting symbol map
-  if(envmap.find(sym.asSymbol()) != envmap.end()){
+  if((builtin(sym) >= 0) || (envmap.find(sym.asSymbol()) != envmap.end())){
     throw SemanticError("Attempt to overwrite symbol in environemnt");
   }
 
+  // restoring a removed built-in value shows the built-in again
+  int slot = find_builtin(sym.asSymbol());
+  if((slot >= 0) && is_builtin_exp(slot) && (exp == builtin_exp(slot))){
+    hidden &= ~(std::uint64_t(1) << slot);
+    return;
+  }
+
   envmap.emplace(sym.asSymbol(), EnvResult(ExpressionType, exp)); 
 }
 
 void Environment::rm_exp(const Atom & sym) {
 
+	int slot = builtin(sym);
+	if (slot >= 0) {
+		hidden |= std::uint64_t(1) << slot;
+		return;
+	}
+
 	auto result = envmap.find(sym.asSymbol());
-	envmap.erase(result);
+	if (result != envmap.end()) {
+		envmap.erase(result);
+	}
 }
 
 bool Environment::is_proc(const Atom & sym) const{
 	
   if(!sym.isSymbol()) return false;
+
+  int slot = builtin(sym);
+  if(slot >= 0) return BUILTINS[slot].kind == ProcedureBuiltin;
   
-  auto result = envmap.find(sym.asSymbol());
-  return (result != envmap.end()) && (result->second.type == ProcedureType);
+  const EnvResult * result = find(sym.asSymbol());
+  return result && (result->type == ProcedureType);
 }
 
 Procedure Environment::get_proc(const Atom & sym) const{
 
   if(sym.isSymbol()){
-    auto result = envmap.find(sym.asSymbol());
-    if((result != envmap.end()) && (result->second.type == ProcedureType)){
-      return result->second.proc;
+    int slot = builtin(sym);
+    if((slot >= 0) && (BUILTINS[slot].kind == ProcedureBuiltin)){
+      return BUILTINS[slot].proc;
+    }
+    
+    const EnvResult * result = find(sym.asSymbol());
+    if(result && (result->type == ProcedureType)){
+      return result->proc;
     }
   }
 
@@ -971,26 +1163,33 @@ Procedure Environment::get_proc(const Atom & sym) const{
 
 SpecialProc Environment::get_spec(const Atom & sym) const {
 
-	auto result = envmap.find(sym.asSymbol());
-	return result->second.spec;
+	int slot = builtin(sym);
+	if ((slot >= 0) && (BUILTINS[slot].kind == SpecialBuiltin)) {
+		return BUILTINS[slot].spec;
+	}
+
+	const EnvResult * result = find(sym.asSymbol());
+	return result ? result->spec : nullptr;
 }
 
 bool Environment::is_lamb(const Atom & sym) const
 {
 	if (!sym.isSymbol()) return false;
 
-	auto result = envmap.find(sym.asSymbol());
-	return (result != envmap.end()) && (result->second.type == LambdaType);
+	if (builtin(sym) >= 0) return false;
+
+	const EnvResult * result = find(sym.asSymbol());
+	return result && (result->type == LambdaType);
 }
 
 Expression Environment::get_lamb(const Atom & sym) const {
 
 	Expression exp;
 
-	if (sym.isSymbol()) {
-		auto result = envmap.find(sym.asSymbol());
-		if ((result != envmap.end()) && (result->second.type == LambdaType)) {
-			exp = result->second.exp;
+	if (sym.isSymbol() && (builtin(sym) < 0)) {
+		const EnvResult * result = find(sym.asSymbol());
+		if (result && (result->type == LambdaType)) {
+			exp = result->exp;
 		}
 	}
 
@@ -1004,7 +1203,7 @@ void Environment::add_lamb(const Atom & sym, const Expression & exp) {
 	}
 
 	// error if overwriting symbol map
-	if (envmap.find(sym.asSymbol()) != envmap.end()) {
+	if ((builtin(sym) >= 0) || (envmap.find(sym.asSymbol()) != envmap.end())) {
 		throw SemanticError("Attempt to overwrite symbol in environemnt");
 	}
 
@@ -1012,100 +1211,11 @@ void Environment::add_lamb(const Atom & sym, const Expression & exp) {
 }
 
 /*
-Reset the environment to the default state. First remove all entries and
-then re-add the default ones.
+Reset the environment to the default state: remove all definitions and
+show every built-in again.
  */
 void Environment::reset(){
 
   envmap.clear();
-  
-  // Built-In value of pi
-  envmap.emplace("pi", EnvResult(ExpressionType, Expression(PI)));
-  
-  // Built-In value of pi
-  envmap.emplace("-pi", EnvResult(ExpressionType, Expression(negPI)));
-  
-  // Built-In value of e
-  envmap.emplace("e", EnvResult(ExpressionType, Expression(EXP)));
-  
-  // Built-In value of I
-  envmap.emplace("I", EnvResult(ExpressionType, Expression(I)));
-
-  // Built-In value of I
-  envmap.emplace("-I", EnvResult(ExpressionType, Expression(negI)));
-
-  // Procedure: add;
-  envmap.emplace("+", EnvResult(ProcedureType, add)); 
-
-  // Procedure: subneg;
-  envmap.emplace("-", EnvResult(ProcedureType, subneg)); 
-
-  // Procedure: mul;
-  envmap.emplace("*", EnvResult(ProcedureType, mul)); 
-
-  // Procedure: div;
-  envmap.emplace("/", EnvResult(ProcedureType, div)); 
-  
-  // Procedure: sqrt;
-  envmap.emplace("sqrt", EnvResult(ProcedureType, sqrt)); 
-  
-  // Procedure: expo;
-  envmap.emplace("^", EnvResult(ProcedureType, expo));
-  
-  // Procedure: ln;
-  envmap.emplace("ln", EnvResult(ProcedureType, ln));
-  
-  // Procedure: sin;
-  envmap.emplace("sin", EnvResult(ProcedureType, sin));
-  
-  // Procedure: cos;
-  envmap.emplace("cos", EnvResult(ProcedureType, cos));
-  
-  // Procedure: tan;
-  envmap.emplace("tan", EnvResult(ProcedureType, tan));
-  
-  // Procedure: real;
-  envmap.emplace("real", EnvResult(ProcedureType, real));
-  
-  // Procedure: imag;
-  envmap.emplace("imag", EnvResult(ProcedureType, imag));
-  
-  // Procedure: mag;
-  envmap.emplace("mag", EnvResult(ProcedureType, mag));
-  
-  // Procedure: arg;
-  envmap.emplace("arg", EnvResult(ProcedureType, arg));
-  
-  // Procedure: conj;
-  envmap.emplace("conj", EnvResult(ProcedureType, conj));
-
-  // Procedure: list;
-  envmap.emplace("list", EnvResult(ProcedureType, list));
-
-  // Procedure: first;
-  envmap.emplace("first", EnvResult(ProcedureType, first));
-
-  // Procedure: rest;
-  envmap.emplace("rest", EnvResult(ProcedureType, rest));
-
-  // Procedure: length;
-  envmap.emplace("length", EnvResult(ProcedureType, length));
-
-  // Procedure: append;
-  envmap.emplace("append", EnvResult(ProcedureType, append));
-
-  // Procedure: join;
-  envmap.emplace("join", EnvResult(ProcedureType, join));
-
-  // Procedure: range;
-  envmap.emplace("range", EnvResult(ProcedureType, range));
-
-  // Procedure: lambda;
-  envmap.emplace("lambda", EnvResult(SpecialType, lambda));
-
-  //Procedure: apply
-  envmap.emplace("apply", EnvResult(SpecialType, apply));
-  
-  //Procedure: map
-  envmap.emplace("map", EnvResult(SpecialType, map));
+  hidden = parent ? parent->hidden : 0;
 }
@@ -11,6 +11,7 @@ needed.
 #define ENVIRONMENT_HPP
 
 // system includes
+#include <cstdint>
 #include <map>
 
 // module includes
@@ -23,6 +24,12 @@ needed.
 */
 typedef Expression (*Procedure)(const std::vector<Expression> & args);
 
+/*! \fn Expression call_procedure(Procedure proc, const std::vector<Expression> & args)
+\brief Call proc with args, passing any plot among them as its list of
+graphic primitives, so procedures see plots as lists however they are called
+*/
+Expression call_procedure(Procedure proc, const std::vector<Expression> & args);
+
 /*! \typedef SpecialProc
 \brief A Procedure is a C++ function pointer taking a vector of
 Expressions as arguments and returning an Expression.
@@ -42,6 +49,10 @@ return you can obtain
 the mapped-to value using get_exp or get_proc.
 
 To add an symbol to expression mapping use the add_exp member function.
+
+An environment may be a frame over a parent, whose definitions it sees
+without copying them. Definitions and removals in a frame stay in the frame,
+and the parent must outlive it and not change while it is used.
  */
 class Environment {
 public:
@@ -49,6 +60,11 @@ public:
    * definitions. */
   Environment();
 
+  /*! Construct an empty frame over parent, seeing its definitions.
+    \param parent the environment to look up what the frame does not define
+   */
+  explicit Environment(const Environment * parent);
+
   /*! Determine if a symbol is known to the environment.
     \param sym the sumbol to lookup
     \return true if the symbol has been defined in the environment
@@ -119,7 +135,7 @@ public:
   */
   void add_lamb(const Atom & sym, const Expression & exp);  
 
-  /*! Reset the environment to its default state. */
+  /*! Reset the environment to its default state, a frame keeps its parent. */
   void reset();
 
 private:
@@ -140,8 +156,20 @@ private:
 	EnvResult(EnvResultType t, SpecialProc s) : type(t), spec(s) {};
   };
 
-  // the environment map
+  // the environment map, consulted after the built-in table
   std::map<std::string, EnvResult> envmap;
+
+  // bit per built-in table slot, set when the built-in has been removed
+  std::uint64_t hidden;
+
+  // the environment a frame looks up what it does not define, or nullptr
+  const Environment * parent;
+
+  // return the table slot of sym if it is a visible built-in, else -1
+  int builtin(const Atom & sym) const;
+
+  // return the definition of name in this frame or its parents, or nullptr
+  const EnvResult * find(const std::string & name) const;
 };
 
 #endif
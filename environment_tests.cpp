@@ -117,3 +117,74 @@ TEST_CASE( "Test semeantic errors", "[environment]" ) {
   }
 }
 
+
+TEST_CASE( "Test built-in constants", "[environment]" ) {
+  Environment env;
+
+  // the table holds exactly the values computed by the library
+  REQUIRE(env.get_exp(Atom("pi")).head().asNumber() == std::atan2(0, -1));
+  REQUIRE(env.get_exp(Atom("-pi")).head().asNumber() == -std::atan2(0, -1));
+  REQUIRE(env.get_exp(Atom("e")).head().asNumber() == std::exp(1));
+  REQUIRE(env.get_exp(Atom("-I")) == Expression(std::complex<double>(0, -1)));
+
+  REQUIRE(env.get_spec(Atom("map")) != nullptr);
+  REQUIRE(!env.is_proc(Atom("map")));
+  REQUIRE(!env.is_known(Atom("")));
+  REQUIRE(!env.is_known(Atom("pie")));
+}
+
+TEST_CASE( "Test shadowing built-in constants", "[environment]" ) {
+  Environment env;
+
+  REQUIRE_THROWS_AS(env.add_exp(Atom("e"), Expression(1.0)), SemanticError);
+  REQUIRE_THROWS_AS(env.add_lamb(Atom("pi"), Expression(1.0)), SemanticError);
+
+  // removing a built-in constant lets it be redefined
+  Expression saved = env.get_exp(Atom("e"));
+  env.rm_exp(Atom("e"));
+  REQUIRE(!env.is_known(Atom("e")));
+  env.add_exp(Atom("e"), Expression(1.0));
+  REQUIRE(env.get_exp(Atom("e")) == Expression(1.0));
+
+  // and copies are independent
+  Environment copy = env;
+  env.rm_exp(Atom("e"));
+  env.add_exp(Atom("e"), saved);
+  REQUIRE(env.get_exp(Atom("e")) == saved);
+  REQUIRE(copy.get_exp(Atom("e")) == Expression(1.0));
+
+  copy.reset();
+  REQUIRE(copy.get_exp(Atom("e")) == saved);
+}
+
+TEST_CASE( "Test environment frames", "[environment]" ) {
+  Environment env;
+  env.add_exp(Atom("x"), Expression(7.0));
+  env.rm_exp(Atom("e"));
+  env.add_exp(Atom("e"), Expression(1.0));
+
+  // a frame sees its parent's definitions
+  Environment frame(&env);
+  REQUIRE(frame.get_exp(Atom("x")) == Expression(7.0));
+  REQUIRE(frame.get_exp(Atom("e")) == Expression(1.0));
+  REQUIRE(frame.is_proc(Atom("+")));
+
+  // and shadows them with its own, leaving the parent as it was
+  frame.add_exp(Atom("x"), Expression(2.0));
+  frame.add_exp(Atom("y"), Expression(3.0));
+  REQUIRE(frame.get_exp(Atom("x")) == Expression(2.0));
+  REQUIRE(env.get_exp(Atom("x")) == Expression(7.0));
+  REQUIRE(!env.is_known(Atom("y")));
+
+  frame.rm_exp(Atom("x"));
+  REQUIRE(frame.get_exp(Atom("x")) == Expression(7.0));
+  frame.rm_exp(Atom("pi"));
+  REQUIRE(!frame.is_known(Atom("pi")));
+  REQUIRE(env.is_known(Atom("pi")));
+
+  // reset forgets only the frame's definitions
+  frame.reset();
+  REQUIRE(!frame.is_known(Atom("y")));
+  REQUIRE(frame.get_exp(Atom("e")) == Expression(1.0));
+  REQUIRE(frame.is_known(Atom("pi")));
+}
@@ -1,10 +1,23 @@
 #include "expression.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <iterator>
 #include <sstream>
 #include <list>
+#include <map>
+#include <memory>
 #include <iomanip>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <utility>
 
+#include "decimate.hpp"
 #include "environment.hpp"
+#include "plot_buffer.hpp"
+#include "sampler.hpp"
 #include "semantic_error.hpp"
 
 Expression::Expression(){}
@@ -14,14 +27,18 @@ Expression::Expression(const Atom & a){
   m_head = a;
 }
 
-// recursive copy
-Expression::Expression(const Expression & a){
+// recursive copy, each subexpression is copied once
+Expression::Expression(const Expression & a):
+  m_tail(a.m_tail), m_prop(a.m_prop ? new PropertyList(*a.m_prop) : nullptr), m_kind(a.m_kind){
 
   m_head = a.m_head;
-  for(auto e : a.m_tail){
-    m_tail.push_back(e);
-  }
-  m_prop = a.m_prop;
+}
+
+Expression::Expression(Expression && a) noexcept:
+  m_head(std::move(a.m_head)), m_tail(std::move(a.m_tail)), m_prop(std::move(a.m_prop)), m_kind(a.m_kind){
+
+  a.m_tail.clear();
+  a.m_kind = NO_GRAPHICS;
 }
 
 Expression::Expression(const std::list<Expression>& a) {
@@ -46,17 +63,28 @@ Expression & Expression::operator=(const Expression & a){
 
   // prevent self-assignment
   if(this != &a){
-    m_head = a.m_head;
-    m_tail.clear();
-    for(auto e : a.m_tail){
-      m_tail.push_back(e);
-    } 
-	m_prop = a.m_prop;
+    // copy first, a may be part of this expression
+    Expression copy(a);
+    *this = std::move(copy);
   }
   
   return *this;
 }
 
+Expression & Expression::operator=(Expression && a) noexcept{
+
+  if(this != &a){
+    // take a's parts before releasing ours, a may be part of this expression
+    Expression taken(std::move(a));
+    m_head = std::move(taken.m_head);
+    m_tail.swap(taken.m_tail);
+    m_prop.swap(taken.m_prop);
+    m_kind = taken.m_kind;
+  }
+
+  return *this;
+}
+
 
 Atom & Expression::head(){
   return m_head;
@@ -82,6 +110,41 @@ void Expression::append(const Atom & a){
   m_tail.emplace_back(a);
 }
 
+bool Expression::isHeadPlot() const noexcept{
+  return m_head.isPlot();
+}
+
+Expression Expression::expanded() const{
+
+  if(!m_head.isPlot()){
+    return *this;
+  }
+
+  const PlotBuffer & plot = *m_head.asPlot();
+  Expression result(Atom("List"));
+  result.m_tail.reserve(plot.size());
+  std::size_t point = 0, line = 0, text = 0;
+  for(PlotPrimitive kind : plot.order){
+    if(kind == PLOT_POINT){
+      result.m_tail.push_back(make_point(plot.point_x[point], plot.point_y[point], plot.point_size[point]));
+      ++point;
+    }
+    else if(kind == PLOT_LINE){
+      result.m_tail.push_back(make_line(plot.line_x1[line], plot.line_y1[line], plot.line_x2[line], plot.line_y2[line], plot.line_thickness[line]));
+      ++line;
+    }
+    else{
+      result.m_tail.push_back(make_text(plot.text_x[text], plot.text_y[text], plot.text[text], plot.text_scale[text], plot.text_rotation[text]));
+      ++text;
+    }
+  }
+  return result;
+}
+
+void Expression::reserveTail(std::size_t n){
+  m_tail.reserve(n);
+}
+
 
 Expression * Expression::tail(){
   Expression * ptr = nullptr;
@@ -93,85 +156,170 @@ Expression * Expression::tail(){
   return ptr;
 }
 
-std::string Expression::objName()
+void Expression::setProperty(const std::string & key, Expression value){
+
+  SymbolId id;
+  if(find_symbol(key, id)){
+    setProperty(id, std::move(value));
+    return;
+  }
+
+  if(!m_prop){
+    m_prop.reset(new PropertyList);
+  }
+  for(auto & p : *m_prop){
+    if((p.key == PROPERTY_KEY_COUNT) && (p.name == key)){
+      p.value = std::move(value);
+      return;
+    }
+  }
+  m_prop->push_back(Property{PROPERTY_KEY_COUNT, key, std::move(value)});
+}
+
+void Expression::setProperty(SymbolId key, Expression value){
+
+  if(key == OBJECT_NAME_KEY){
+    m_kind = NO_GRAPHICS;
+    if(value.isHeadSymbol()){
+      const std::string & name = value.head().asSymbol();
+      if(name == "\"point\"") m_kind = POINT_GRAPHICS;
+      else if(name == "\"line\"") m_kind = LINE_GRAPHICS;
+      else if(name == "\"text\"") m_kind = TEXT_GRAPHICS;
+    }
+  }
+
+  if(!m_prop){
+    m_prop.reset(new PropertyList);
+  }
+  for(auto & p : *m_prop){
+    if(p.key == key){
+      p.value = std::move(value);
+      return;
+    }
+  }
+  m_prop->push_back(Property{key, std::string(), std::move(value)});
+}
+
+const Expression * Expression::property(const std::string & key) const{
+
+  if(!m_prop){
+    return nullptr;
+  }
+  SymbolId id;
+  if(find_symbol(key, id)){
+    return property(id);
+  }
+  for(const auto & p : *m_prop){
+    if((p.key == PROPERTY_KEY_COUNT) && (p.name == key)){
+      return &p.value;
+    }
+  }
+  return nullptr;
+}
+
+const Expression * Expression::property(SymbolId key) const noexcept{
+
+  if(m_prop && (key < PROPERTY_KEY_COUNT)){
+    for(const auto & p : *m_prop){
+      if(p.key == key){
+        return &p.value;
+      }
+    }
+  }
+  return nullptr;
+}
+
+std::size_t Expression::propertyCount() const noexcept{
+  return m_prop ? m_prop->size() : 0;
+}
+
+const std::string & Expression::propertyKey(std::size_t i) const{
+  const Property & p = m_prop->at(i);
+  return (p.key == PROPERTY_KEY_COUNT) ? p.name : symbol_name(p.key);
+}
+
+const Expression & Expression::propertyValue(std::size_t i) const{
+  return m_prop->at(i).value;
+}
+
+GraphicsKind Expression::graphicsKind() const noexcept{
+  return m_kind;
+}
+
+std::string Expression::objName() const
 {
+	switch (m_kind) {
+	case POINT_GRAPHICS: return "\"point\"";
+	case LINE_GRAPHICS: return "\"line\"";
+	case TEXT_GRAPHICS: return "\"text\"";
+	default: break;
+	}
+
 	std::string name = "NONE";
 
-	if (m_prop.size() > 0) {
-		auto result = m_prop.find("\"object-name\"");
-		if (result != m_prop.end()) {
-			name = (result->second).head().asSymbol();
-		}
+	const Expression * result = property(OBJECT_NAME_KEY);
+	if (result) {
+		name = result->head().asSymbol();
 	}
 
 	return name;
 }
 
-double Expression::pointSize()
+double Expression::pointSize() const
 {
 	double size = 0;
 	
-	if (m_prop.size() > 0) {
-		auto result = m_prop.find("\"size\"");
-		if (result != m_prop.end()) {
-			size = (result->second).head().asNumber();
-		}
+	const Expression * result = property(SIZE_KEY);
+	if (result) {
+		size = result->head().asNumber();
 	}
 
 	return size;
 }
 
-double Expression::lineThick()
+double Expression::lineThick() const
 {
 	double thick = 0;
 	
-	if (m_prop.size() > 0) {
-		auto result = m_prop.find("\"thickness\"");
-		if (result != m_prop.end()) {
-			thick = (result->second).head().asNumber();
-		}
+	const Expression * result = property(THICKNESS_KEY);
+	if (result) {
+		thick = result->head().asNumber();
 	}
 
 	return thick;
 }
 
-Expression Expression::textPos()
+Expression Expression::textPos() const
 {
 	Expression pos;
 	
-	if (m_prop.size() > 0) {
-		auto result = m_prop.find("\"position\"");
-		if (result != m_prop.end()) {
-			pos = result->second;
-		}
+	const Expression * result = property(POSITION_KEY);
+	if (result) {
+		pos = *result;
 	}
 
 	return pos;
 }
 
-double Expression::textScale()
+double Expression::textScale() const
 {
 	double scale = 1;
 	
-	if (m_prop.size() > 0) {
-		auto result = m_prop.find("\"scale\"");
-		if (result != m_prop.end()) {
-			scale = (result->second).head().asNumber();
-		}
+	const Expression * result = property(SCALE_KEY);
+	if (result) {
+		scale = result->head().asNumber();
 	}
 
 	return scale;
 }
 
-double Expression::textRotation()
+double Expression::textRotation() const
 {
 	double rotation = 0;
 	
-	if (m_prop.size() > 0) {
-		auto result = m_prop.find("\"rotation\"");
-		if (result != m_prop.end()) {
-			rotation = (result->second).head().asNumber();
-		}
+	const Expression * result = property(ROTATION_KEY);
+	if (result) {
+		rotation = result->head().asNumber();
 	}
 
 	return rotation;
@@ -185,6 +333,163 @@ Expression::ConstIteratorType Expression::tailConstEnd() const noexcept{
   return m_tail.cend();
 }
 
+// true if evaluating exp can never add a definition to the environment
+bool defines_nothing(const Expression & exp){
+
+  if(exp.head().isSymbol() && (exp.head().asSymbol() == "define")){
+    return false;
+  }
+  for(auto e = exp.tailConstBegin(); e != exp.tailConstEnd(); ++e){
+    if(!defines_nothing(*e)) return false;
+  }
+  return true;
+}
+
+// evaluate body at xs[first, last) into ys with param bound to each in
+// turn, leaving env as it was; body must define nothing, so binding the
+// parameter in place stands in for copying env per point as apply does
+void evaluate_samples(const Atom & param, const Expression & body, Environment & env,
+		      const std::vector<double> & xs, std::vector<double> & ys, std::size_t first, std::size_t last){
+
+  bool shadowed = env.is_exp(param);
+  Expression saved;
+  if(shadowed){
+    saved = env.get_exp(param);
+    env.rm_exp(param);
+  }
+  try{
+    for(std::size_t i = first; i < last; ++i){
+      env.add_exp(param, Expression(xs[i]));
+      Expression point = body;
+      ys[i] = point.eval(env).head().asNumber();
+      env.rm_exp(param);
+    }
+  }
+  catch(...){
+    if(env.is_exp(param)) env.rm_exp(param);
+    if(shadowed) env.add_exp(param, saved);
+    throw;
+  }
+  if(shadowed) env.add_exp(param, saved);
+}
+
+// threads evaluating the batches of samples of one plot, each binding the
+// parameter in its own frame over env, which must not change while the
+// pool works, so a lambda called from the body copies the frame rather
+// than env; the calling thread is worker 0, the others start with the
+// first batch that needs them and wait between batches
+class SamplePool {
+public:
+
+  SamplePool(const Atom & param, const Expression & body, const Environment & env):
+    m_param(param), m_body(body), m_env(env), m_scope(InterruptScope::current()), m_frame(&env),
+    m_xs(nullptr), m_ys(nullptr), m_workers(1), m_round(0), m_pending(0), m_stopping(false) {}
+
+  ~SamplePool(){
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopping = true;
+    }
+    m_start.notify_all();
+    for(auto & thread : m_threads){
+      thread.join();
+    }
+  }
+
+  SamplePool(const SamplePool &) = delete;
+  SamplePool & operator=(const SamplePool &) = delete;
+
+  // evaluate_samples over all of xs split between workers threads,
+  // rethrowing the first error in xs order
+  void evaluate(const std::vector<double> & xs, std::vector<double> & ys, std::size_t workers){
+
+    while(m_threads.size() + 1 < workers){
+      m_threads.emplace_back(&SamplePool::run, this, m_threads.size() + 1, m_round);
+    }
+    m_errors.assign(workers, nullptr);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_xs = &xs;
+      m_ys = &ys;
+      m_workers = workers;
+      m_pending = workers - 1;
+      ++m_round;
+    }
+    m_start.notify_all();
+    work(m_frame, 0);
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_done.wait(lock, [this]{ return m_pending == 0; });
+    }
+
+    for(auto & error : m_errors){
+      if(error) std::rethrow_exception(error);
+    }
+  }
+
+private:
+
+  // evaluate worker w's share of the current batch in frame
+  void work(Environment & frame, std::size_t w){
+
+    try{
+      std::size_t n = m_xs->size();
+      evaluate_samples(m_param, m_body, frame, *m_xs, *m_ys, n * w / m_workers, n * (w + 1) / m_workers);
+    }
+    catch(...){
+      m_errors[w] = std::current_exception();
+    }
+  }
+
+  // the loop of worker w, started after round seen
+  void run(std::size_t w, std::size_t seen){
+
+    // the workers stop with the thread sampling when it is interrupted
+    InterruptScope inherited(m_scope ? m_scope->through() : nullptr, m_scope ? m_scope->id() : 0);
+    Environment frame(&m_env);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true){
+      m_start.wait(lock, [this, seen]{ return m_stopping || (m_round != seen); });
+      if(m_stopping){
+        return;
+      }
+      seen = m_round;
+      if(w >= m_workers){
+        continue;
+      }
+      lock.unlock();
+      work(frame, w);
+      lock.lock();
+      if(--m_pending == 0){
+        m_done.notify_one();
+      }
+    }
+  }
+
+  const Atom & m_param;
+  const Expression & m_body;
+  const Environment & m_env;
+  const InterruptScope * m_scope;
+
+  // the frame of worker 0, the thread sampling
+  Environment m_frame;
+
+  std::vector<std::thread> m_threads;
+  std::vector<std::exception_ptr> m_errors;
+
+  // the current batch, guarded by m_mutex
+  std::mutex m_mutex;
+  std::condition_variable m_start;
+  std::condition_variable m_done;
+  const std::vector<double> * m_xs;
+  std::vector<double> * m_ys;
+  std::size_t m_workers;
+  std::size_t m_round;
+  std::size_t m_pending;
+  bool m_stopping;
+};
+
 Expression apply(const Atom & op, const std::vector<Expression> & args, Environment & env){
 
   // head must be a symbol
@@ -198,7 +503,7 @@ Expression apply(const Atom & op, const std::vector<Expression> & args, Environm
 	  Procedure proc = env.get_proc(op);
 
 	  // call proc with args
-	  return proc(args);
+	  return call_procedure(proc, args);
   }
   else if (env.is_lamb(op))  {
 	  Expression exp = env.get_lamb(op);
@@ -452,7 +757,7 @@ Expression Expression::handle_setprop(const std::vector<Expression>& args)
 			std::string s = args[0].head().asSymbol();
 			Expression exp;
 			exp = args[2];
-			exp.m_prop[s] = args[1];
+			exp.setProperty(s, args[1]);
 			return Expression(exp);
 		}
 		else
@@ -469,9 +774,9 @@ Expression Expression::handle_getprop(const std::vector<Expression>& args){
 			std::string s = args[0].head().asSymbol();
 			Expression exp;
 
-			auto result = args[1].m_prop.find(args[0].head().asSymbol());
-			if (result != args[1].m_prop.end()) {
-				exp = result->second;
+			const Expression * result = args[1].property(s);
+			if (result) {
+				exp = *result;
 			}
 			return exp;
 		}
@@ -482,9 +787,43 @@ Expression Expression::handle_getprop(const std::vector<Expression>& args){
 		throw SemanticError("Error in call to set-property: invalid number of arguments.");
 }
 
+// the decimation among the options of discrete-plot, leaving method and
+// threshold as they are unless given
+void decimation_options(const Expression & options, DecimationMethod & method, size_t & threshold){
+
+	for (auto e = options.tailConstBegin(); e != options.tailConstEnd(); ++e) {
+		if (std::distance(e->tailConstBegin(), e->tailConstEnd()) != 2) {
+			continue;
+		}
+		std::string key = e->tailConstBegin()->head().asSymbol();
+		Atom value = std::next(e->tailConstBegin())->head();
+		if (key == "\"decimation\"") {
+			std::string name = value.isSymbol() ? value.asSymbol() : "";
+			if (name == "\"min-max\"") {
+				method = MIN_MAX_DECIMATION;
+			}
+			else if (name == "\"lttb\"") {
+				method = LTTB_DECIMATION;
+			}
+			else if (name == "\"none\"") {
+				method = NO_DECIMATION;
+			}
+			else {
+				throw SemanticError("Error in call to discrete-plot: decimation must be \"min-max\", \"lttb\" or \"none\".");
+			}
+		}
+		else if (key == "\"decimation-threshold\"") {
+			if (!value.isNumber() || !(value.asNumber() >= 3) || (value.asNumber() != std::floor(value.asNumber()))) {
+				throw SemanticError("Error in call to discrete-plot: decimation-threshold must be an integer of at least 3.");
+			}
+			threshold = static_cast<size_t>(value.asNumber());
+		}
+	}
+}
+
 Expression Expression::handle_discrete(const std::vector<Expression>& args) {
 
-	std::list<Expression> result;
+	std::shared_ptr<PlotBuffer> plot = std::make_shared<PlotBuffer>();
 	if (args.size() == 2) {
 		std::string s = args[0].head().asSymbol();
 		if (s == "List") {
@@ -511,32 +850,43 @@ Expression Expression::handle_discrete(const std::vector<Expression>& args) {
 				std::string OUvalue;
 				std::string OLvalue;
 
-				std::vector<Expression> xCoords;
-				std::vector<Expression> yCoords;
+				std::vector<double> xCoords;
+				std::vector<double> yCoords;
+				xCoords.reserve(args[0].m_tail.size());
+				yCoords.reserve(args[0].m_tail.size());
 				for (size_t i = 0; i < (args[0].m_tail.size()); ++i) {
-					xCoords.push_back(Expression(args[0].m_tail[i].m_tail[0].head().asNumber()));
-					yCoords.push_back(Expression(-(args[0].m_tail[i].m_tail[1].head().asNumber())));
+					xCoords.push_back(args[0].m_tail[i].m_tail[0].head().asNumber());
+					yCoords.push_back(-(args[0].m_tail[i].m_tail[1].head().asNumber()));
 				}
 
-				maxX = xCoords.front().head().asNumber();
-				minX = xCoords.back().head().asNumber();
-				for (size_t g = 0; g < xCoords.size(); ++g) {
-					if (maxX < xCoords[g].head().asNumber()) {
-						maxX = xCoords[g].head().asNumber();
-					}
-					if (minX > xCoords[g].head().asNumber()) {
-						minX = xCoords[g].head().asNumber();
-					}
+				if (xCoords.empty()) {
+					throw SemanticError("Error in call to discrete-plot: first argument must not be empty.");
 				}
-				maxY = yCoords.back().head().asNumber();
-				minY = yCoords.front().head().asNumber();
-				for (size_t g = 0; g < yCoords.size(); ++g) {
-					if (maxY > yCoords[g].head().asNumber()) {
-						maxY = yCoords[g].head().asNumber();
-					}
-					if (minY < yCoords[g].head().asNumber()) {
-						minY = yCoords[g].head().asNumber();
+
+				//the axes span every point, decimated or not
+				auto xRange = std::minmax_element(xCoords.begin(), xCoords.end());
+				maxX = *xRange.second;
+				minX = *xRange.first;
+				auto yRange = std::minmax_element(yCoords.begin(), yCoords.end());
+				maxY = *yRange.first;
+				minY = *yRange.second;
+
+				//thin long series to the points that show
+				DecimationMethod method = MIN_MAX_DECIMATION;
+				size_t threshold = DECIMATION_THRESHOLD;
+				decimation_options(args[1], method, threshold);
+				if ((method != NO_DECIMATION) && (xCoords.size() > threshold)) {
+					std::vector<size_t> kept = (method == LTTB_DECIMATION) ?
+						decimate_lttb(xCoords, yCoords, threshold) : decimate_min_max(xCoords, yCoords, threshold);
+					std::vector<double> keptX, keptY;
+					keptX.reserve(kept.size());
+					keptY.reserve(kept.size());
+					for (size_t k : kept) {
+						keptX.push_back(xCoords[k]);
+						keptY.push_back(yCoords[k]);
 					}
+					xCoords.swap(keptX);
+					yCoords.swap(keptY);
 				}
 				
 				xLength = sqrt(pow((maxX - minX), 2));
@@ -571,18 +921,9 @@ Expression Expression::handle_discrete(const std::vector<Expression>& args) {
 				xmiddle = (maxX + minX) / 2;
 				ymiddle = (maxY + minY) / 2;
 
-				int xSize = xCoords.size();
-				for (int g = 0; g < xSize; ++g) {
-					double newX = xCoords[0].head().asNumber() * scalex;
-					xCoords.push_back(Expression(newX));
-					xCoords.erase(xCoords.begin());
-				}
-
-				int ySize = yCoords.size();
-				for (int g = 0; g < ySize; ++g) {
-					double newY = yCoords[0].head().asNumber() * scaley;
-					yCoords.push_back(Expression(newY));
-					yCoords.erase(yCoords.begin());
+				for (size_t g = 0; g < xCoords.size(); ++g) {
+					xCoords[g] = xCoords[g] * scalex;
+					yCoords[g] = yCoords[g] * scaley;
 				}
 
 				//graph lines
@@ -591,22 +932,18 @@ Expression Expression::handle_discrete(const std::vector<Expression>& args) {
 						//points and lines inside
 						for (size_t m = 0; m < xCoords.size(); ++m) {
 							//make-point						
-							Expression point1 = make_point(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), P);
-							result.push_back(point1);
+							plot->add_point(xCoords[m], yCoords[m], P);
 							//make-line
-							Expression line1 = make_line(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), xCoords[m].head().asNumber(), maxY, 0);
-							result.push_back(line1);
+							plot->add_line(xCoords[m], yCoords[m], xCoords[m], maxY, 0);
 						}
 					}
 					else {
 						//points and lines inside
 						for (size_t m = 0; m < xCoords.size(); ++m) {
 							//make-point						
-							Expression point1 = make_point(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), P);
-							result.push_back(point1);
+							plot->add_point(xCoords[m], yCoords[m], P);
 							//make-line
-							Expression line1 = make_line(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), xCoords[m].head().asNumber(), minY, 0);
-							result.push_back(line1);
+							plot->add_line(xCoords[m], yCoords[m], xCoords[m], minY, 0);
 						}
 					}
 				}
@@ -615,68 +952,52 @@ Expression Expression::handle_discrete(const std::vector<Expression>& args) {
 						//points and lines inside
 						for (size_t m = 0; m < xCoords.size(); ++m) {
 							//make-point						
-							Expression point1 = make_point(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), P);
-							result.push_back(point1);
+							plot->add_point(xCoords[m], yCoords[m], P);
 							//make-line
-							Expression line1 = make_line(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), xCoords[m].head().asNumber(), maxY, 0);
-							result.push_back(line1);
+							plot->add_line(xCoords[m], yCoords[m], xCoords[m], maxY, 0);
 						}
 					}
 					else {
 						//points and lines inside
 						for (size_t m = 0; m < xCoords.size(); ++m) {
 							//make-point						
-							Expression point1 = make_point(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), P);
-							result.push_back(point1);
+							plot->add_point(xCoords[m], yCoords[m], P);
 							//make-line
-							Expression line1 = make_line(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), xCoords[m].head().asNumber(), minY, 0);
-							result.push_back(line1);
+							plot->add_line(xCoords[m], yCoords[m], xCoords[m], minY, 0);
 						}
 					}
 					//Y origin
-					Expression lineY1 = make_line(0, minY, 0, maxY, 0);
-					result.push_back(lineY1);
+					plot->add_line(0, minY, 0, maxY, 0);
 				}
 				else if (((maxX > 0) && (minX > 0)) || ((maxX < 0) && (minX < 0))) {
 					//points and lines inside
 					for (size_t m = 0; m < xCoords.size(); ++m) {
 						//make-point						
-						Expression point1 = make_point(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), P);
-						result.push_back(point1);
+						plot->add_point(xCoords[m], yCoords[m], P);
 						//make-line
-						Expression line1 = make_line(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), xCoords[m].head().asNumber(), 0, 0);
-						result.push_back(line1);
+						plot->add_line(xCoords[m], yCoords[m], xCoords[m], 0, 0);
 					}
 					//X origin
-					Expression lineX1 = make_line(minX, 0, maxX, 0, 0);
-					result.push_back(lineX1);
+					plot->add_line(minX, 0, maxX, 0, 0);
 				}
 				else {
 					//points and lines inside
 					for (size_t m = 0; m < xCoords.size(); ++m) {
 						//make-point						
-						Expression point1 = make_point(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), P);
-						result.push_back(point1);
+						plot->add_point(xCoords[m], yCoords[m], P);
 						//make-line
-						Expression line1 = make_line(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), xCoords[m].head().asNumber(), 0, 0);
-						result.push_back(line1);
+						plot->add_line(xCoords[m], yCoords[m], xCoords[m], 0, 0);
 					}
 					//X origin
-					Expression lineX1 = make_line(minX, 0, maxX, 0, 0);
-					result.push_back(lineX1);
+					plot->add_line(minX, 0, maxX, 0, 0);
 					//Y origin
-					Expression lineY1 = make_line(0, minY, 0, maxY, 0);
-					result.push_back(lineY1);
+					plot->add_line(0, minY, 0, maxY, 0);
 				}
 				//Outer lines
-				Expression border1 = make_line(minX, maxY, maxX, maxY, 0);
-				result.push_back(border1);
-				Expression border2 = make_line(minX, minY, maxX, minY, 0);
-				result.push_back(border2);
-				Expression border3 = make_line(minX, maxY, minX, minY, 0);
-				result.push_back(border3);
-				Expression border4 = make_line(maxX, maxY, maxX, minY, 0);
-				result.push_back(border4);
+				plot->add_line(minX, maxY, maxX, maxY, 0);
+				plot->add_line(minX, minY, maxX, minY, 0);
+				plot->add_line(minX, maxY, minX, minY, 0);
+				plot->add_line(maxX, maxY, maxX, minY, 0);
 
 				//Coordinate labels
 				double textScale = 1;
@@ -685,28 +1006,21 @@ Expression Expression::handle_discrete(const std::vector<Expression>& args) {
 						textScale = args[1].m_tail[i].m_tail[1].head().asNumber();
 					}
 				}
-				Expression cLabel1 = make_text(maxX, minY + C, AUvalue, textScale, 0);
-				result.push_back(cLabel1);
-				Expression cLabel2 = make_text(minX, minY + C, ALvalue, textScale, 0);
-				result.push_back(cLabel2);
-				Expression cLabel3 = make_text(minX - D, maxY, OUvalue, textScale, 0);
-				result.push_back(cLabel3);
-				Expression cLabel4 = make_text(minX - D, minY, OLvalue, textScale, 0);
-				result.push_back(cLabel4);
+				plot->add_text(maxX, minY + C, AUvalue, textScale, 0);
+				plot->add_text(minX, minY + C, ALvalue, textScale, 0);
+				plot->add_text(minX - D, maxY, OUvalue, textScale, 0);
+				plot->add_text(minX - D, minY, OLvalue, textScale, 0);
 
 				for (size_t i = 0; i < (args[1].m_tail.size()); ++i) {
 					std::list<Expression> label;
 					if (args[1].m_tail[i].m_tail[0].head().asSymbol() == "\"title\"") {
-						Expression cLabel = make_text(xmiddle, maxY - A, args[1].m_tail[i].m_tail[1].head().asSymbol(), textScale, 0);
-						result.push_back(cLabel);
+						plot->add_text(xmiddle, maxY - A, args[1].m_tail[i].m_tail[1].head().asSymbol(), textScale, 0);
 					}
 					else if (args[1].m_tail[i].m_tail[0].head().asSymbol() == "\"abscissa-label\"") {
-						Expression cLabel = make_text(xmiddle, minY + A, args[1].m_tail[i].m_tail[1].head().asSymbol(), textScale, 0);
-						result.push_back(cLabel);
+						plot->add_text(xmiddle, minY + A, args[1].m_tail[i].m_tail[1].head().asSymbol(), textScale, 0);
 					}
 					else if (args[1].m_tail[i].m_tail[0].head().asSymbol() == "\"ordinate-label\"") {
-						Expression cLabel = make_text(minX - B, ymiddle, args[1].m_tail[i].m_tail[1].head().asSymbol(), textScale, (-90 * (atan(1) * 4) / 180));
-						result.push_back(cLabel);
+						plot->add_text(minX - B, ymiddle, args[1].m_tail[i].m_tail[1].head().asSymbol(), textScale, (-90 * (atan(1) * 4) / 180));
 					}
 				}
 			}
@@ -722,12 +1036,92 @@ Expression Expression::handle_discrete(const std::vector<Expression>& args) {
 		throw SemanticError("Error in call to discrete-plot: invalid number of arguments.");
 	}
 
-	return result;
+	return Expression(Atom(std::shared_ptr<const PlotBuffer>(plot)));
+}
+
+// the sampler options among the options of continuous-plot, a plot size
+// units across, "preview" applies before the other options whatever the order
+SamplerOptions sampler_options(const Expression & options, double size){
+
+	SamplerOptions sampler;
+	std::vector<std::pair<std::string, Atom>> given;
+	for (auto e = options.tailConstBegin(); e != options.tailConstEnd(); ++e) {
+		if (std::distance(e->tailConstBegin(), e->tailConstEnd()) != 2) {
+			continue;
+		}
+		std::string key = e->tailConstBegin()->head().asSymbol();
+		Atom value = std::next(e->tailConstBegin())->head();
+		if (key == "\"preview\"") {
+			if (!value.isNumber()) {
+				throw SemanticError("Error in call to continuous-plot: preview must be a number.");
+			}
+			if (value.asNumber() != 0) sampler = SamplerOptions::preview();
+		}
+		else if (key == "\"sampling\"") {
+			given.push_back(std::make_pair(key, value));
+		}
+		else if ((key == "\"initial-samples\"") || (key == "\"max-depth\"") ||
+			 (key == "\"angle-tolerance\"") || (key == "\"error-tolerance\"") || (key == "\"threads\"")) {
+			given.push_back(std::make_pair(key, value));
+		}
+	}
+
+	for (auto & option : given) {
+		std::string name = option.first.substr(1, option.first.size() - 2);
+		if (option.first == "\"sampling\"") {
+			std::string method = option.second.asSymbol();
+			if (method == "\"slope\"") {
+				sampler.method = SLOPE_SAMPLING;
+			}
+			else if (method == "\"turn\"") {
+				sampler.method = TURN_SAMPLING;
+			}
+			else {
+				throw SemanticError("Error in call to continuous-plot: sampling must be \"slope\" or \"turn\".");
+			}
+			continue;
+		}
+		if (!option.second.isNumber()) {
+			throw SemanticError("Error in call to continuous-plot: " + name + " must be a number.");
+		}
+		double value = option.second.asNumber();
+		if (option.first == "\"initial-samples\"") {
+			if (!(value >= 2) || (value != std::floor(value))) {
+				throw SemanticError("Error in call to continuous-plot: initial-samples must be an integer of at least 2.");
+			}
+			sampler.initial_samples = static_cast<std::size_t>(value);
+		}
+		else if (option.first == "\"max-depth\"") {
+			if (!(value >= 0) || (value != std::floor(value))) {
+				throw SemanticError("Error in call to continuous-plot: max-depth must be a non-negative integer.");
+			}
+			sampler.max_depth = static_cast<std::size_t>(value);
+		}
+		else if (option.first == "\"angle-tolerance\"") {
+			if (!(value > 0) || !(value < 180)) {
+				throw SemanticError("Error in call to continuous-plot: angle-tolerance must be between 0 and 180 degrees.");
+			}
+			sampler.angle_tolerance = value;
+		}
+		else if (option.first == "\"threads\"") {
+			if (!(value >= 0) || (value != std::floor(value))) {
+				throw SemanticError("Error in call to continuous-plot: threads must be a non-negative integer.");
+			}
+			sampler.workers = static_cast<std::size_t>(value);
+		}
+		else {
+			if (!(value >= 0)) {
+				throw SemanticError("Error in call to continuous-plot: error-tolerance must be non-negative.");
+			}
+			sampler.error_tolerance = value / size;
+		}
+	}
+	return sampler;
 }
 
 Expression Expression::handle_continuous(const std::vector<Expression>& args, Environment & env){
 	
-	std::list<Expression> result;
+	std::shared_ptr<PlotBuffer> plot = std::make_shared<PlotBuffer>();
 	if (args.size() >= 2) {
 		if (env.is_lamb(args[0].head().asSymbol())) {
 			//check if one argument lambda function
@@ -743,13 +1137,11 @@ Expression Expression::handle_continuous(const std::vector<Expression>& args, En
 			if (paramSize == 1) {
 				std::string s = args[1].head().asSymbol();
 				if (s == "List") {
-					double N = 20;
+					double N = PLOT_SIZE;
 					double A = 3;
 					double B = 3;
 					double C = 2;
 					double D = 2;
-					double M = 50;
-					double MAX = 10;
 					double maxX = args[1].m_tail[1].head().asNumber();
 					double minX = args[1].m_tail[0].head().asNumber();
 					double maxY;
@@ -758,7 +1150,6 @@ Expression Expression::handle_continuous(const std::vector<Expression>& args, En
 					double yLength;
 					double scalex;
 					double scaley;
-					double xIntervals = xLength / (M - 1);
 					double xmiddle;
 					double ymiddle;
 					std::string AUvalue;
@@ -766,40 +1157,42 @@ Expression Expression::handle_continuous(const std::vector<Expression>& args, En
 					std::string OUvalue;
 					std::string OLvalue;
 
-					std::vector<Expression> xCoords;
-					xCoords.push_back(Expression(minX));
-					for (int i = 0; i < (M - 2); ++i) {
-						xCoords.push_back(Expression(xCoords[i].head().asNumber() + xIntervals));
+					SamplerOptions options;
+					if ((args.size() == 3) && (args[2].head().asSymbol() == "List")) {
+						options = sampler_options(args[2], N);
 					}
-					xCoords.push_back(Expression(maxX));
-
-					std::list<Expression> X;
-					for (size_t k = 0; k < xCoords.size(); ++k) {
-						X.push_back(Expression(xCoords[k].head().asNumber()));
-					}
-
-					std::vector<Expression> findY;
-					findY.push_back(args[0].head());
-					findY.push_back(Expression(X));
-					SpecialProc spec = env.get_spec(Atom("map"));
-					Expression Y = spec(findY, env);
-					findY.pop_back();
 
-					std::vector<Expression> yCoords;
-					for (auto e = Y.tailConstBegin(); e != Y.tailConstEnd(); ++e) {
-						yCoords.push_back(Expression(-((*e).head().asNumber())));
-					}
-
-					maxY = yCoords.back().head().asNumber();
-					minY = yCoords.front().head().asNumber();
-					for (size_t g = 0; g < yCoords.size(); ++g) {
-						if (maxY > yCoords[g].head().asNumber()) {
-							maxY = yCoords[g].head().asNumber();
-						}
-						if (minY < yCoords[g].head().asNumber()) {
-							minY = yCoords[g].head().asNumber();
+					//sample the function, evaluating each round of points together
+					Atom name = args[0].head();
+					Atom param = parameters[0].head();
+					const Expression & body = lamb.m_tail[1];
+					bool pure = defines_nothing(body);
+					std::unique_ptr<SamplePool> pool(pure ? new SamplePool(param, body, env) : nullptr);
+					SampleFunction f = [&](const std::vector<double> & xs, std::vector<double> & ys) {
+						ys.resize(xs.size());
+						if (!pure) {
+							std::vector<Expression> point(1);
+							for (size_t i = 0; i < xs.size(); ++i) {
+								point[0] = Expression(xs[i]);
+								ys[i] = apply(name, point, env).head().asNumber();
+							}
+							return;
 						}
+						pool->evaluate(xs, ys, sample_workers(xs.size(), options.workers));
+					};
+					std::vector<double> xCoords;
+					std::vector<double> yCoords;
+					double lowY;
+					double highY;
+					sample_adaptive(minX, maxX, f, options, xCoords, yCoords, lowY, highY);
+					pool.reset();
+
+					//the ordinate is drawn downwards
+					for (size_t g = 0; g < yCoords.size(); ++g) {
+						yCoords[g] = -yCoords[g];
 					}
+					maxY = -highY;
+					minY = -lowY;
 
 					yLength = sqrt(pow((maxY - minY), 2));
 
@@ -832,112 +1225,39 @@ Expression Expression::handle_continuous(const std::vector<Expression>& args, En
 					xmiddle = (maxX + minX) / 2;
 					ymiddle = (maxY + minY) / 2;
 
-					int xSize = xCoords.size();
-					for (int g = 0; g < xSize; ++g) {
-						double newX = xCoords[0].head().asNumber() * scalex;
-						xCoords.push_back(Expression(newX));
-						xCoords.erase(xCoords.begin());
-					}
-
-					int ySize = yCoords.size();
-					for (int g = 0; g < ySize; ++g) {
-						double newY = yCoords[0].head().asNumber() * scaley;
-						yCoords.push_back(Expression(newY));
-						yCoords.erase(yCoords.begin());
-					}
-
-					std::list<Expression> newX;
-					bool split = true;
-					for (int toMax = 0; toMax < MAX; ++toMax) {
-						if (split == true) {
-							int numPts = xCoords.size() - 2;
-							int numSplit = 0;
-							for (int ptPos = 0; ptPos < numPts; ++ptPos) {
-								//find slopes
-								double m1 = ((yCoords[ptPos+1].head().asNumber()) - (yCoords[ptPos].head().asNumber())) / ((xCoords[ptPos + 1].head().asNumber()) - (xCoords[ptPos].head().asNumber()));
-								double m2 = ((yCoords[ptPos+2].head().asNumber()) - (yCoords[ptPos+1].head().asNumber())) / ((xCoords[ptPos+2].head().asNumber()) - (xCoords[ptPos+1].head().asNumber()));
-								//find angle
-								double angle = (atan((m2 - m1) / (1 + m2 * m1))) * 180 / (atan(1) * 4) + 180;
-								if (!((angle > 175) && (angle < 185))) {
-									//split
-									//find midpoint
-									double midpt1x = ((xCoords[ptPos + 1].head().asNumber()) + (xCoords[ptPos].head().asNumber())) / 2;
-									newX.push_back(Expression(midpt1x / scalex));
-									findY.push_back(Expression(newX));
-									Expression newY1 = spec(findY, env);
-									findY.pop_back();
-									newX.clear();
-									double midpt1y = newY1.m_tail[0].head().asNumber() * -scaley;
-									double midpt2x = ((xCoords[ptPos + 2].head().asNumber()) + (xCoords[ptPos + 1].head().asNumber())) / 2;
-									newX.push_back(Expression(midpt2x / scalex));
-									findY.push_back(Expression(newX));
-									Expression newY2 = spec(findY, env);
-									findY.pop_back();
-									newX.clear();
-									double midpt2y = newY2.m_tail[0].head().asNumber() * -scaley;
-									
-									//add points
-									xCoords.insert(xCoords.begin()+ptPos+1, Expression(midpt1x));
-									xCoords.insert(xCoords.begin()+ptPos+3, Expression(midpt2x));
-									yCoords.insert(yCoords.begin()+ptPos+1, Expression(midpt1y));
-									yCoords.insert(yCoords.begin()+ptPos+3, Expression(midpt2y));
-									
-									ptPos = ptPos + 4;
-									numPts = xCoords.size() - 2;
-									++numSplit;
-								}
-								//if at the end of line list
-								if (ptPos == (numPts - 1)) {
-									if (numSplit > 0) {
-										split = true;
-									}
-									else
-										split = false;
-								}
-							}
-						}
-						else {
-							toMax = 10;
-						}
+					for (size_t g = 0; g < xCoords.size(); ++g) {
+						xCoords[g] = xCoords[g] * scalex;
+						yCoords[g] = yCoords[g] * scaley;
 					}
 
 					//points and lines inside
 					for (size_t m = 0; m < (xCoords.size() - 1); ++m) {
 						//make-line
-						Expression line1 = make_line(xCoords[m].head().asNumber(), yCoords[m].head().asNumber(), xCoords[m+1].head().asNumber(), yCoords[m+1].head().asNumber(), 0);
-						result.push_back(line1);
+						plot->add_line(xCoords[m], yCoords[m], xCoords[m+1], yCoords[m+1], 0);
 					}
 					
 					//graph lines
 					if ((((maxY > 0) && (minY > 0)) || ((maxY < 0) && (minY < 0))) && (((maxX > 0) && (minX > 0)) || ((maxX < 0) && (minX < 0)))) {}
 					else if (((maxY > 0) && (minY > 0)) || ((maxY < 0) && (minY < 0))) {
 						//Y origin
-						Expression lineY1 = make_line(0, minY, 0, maxY, 0);
-						result.push_back(lineY1);
+						plot->add_line(0, minY, 0, maxY, 0);
 					}
 					else if (((maxX > 0) && (minX > 0)) || ((maxX < 0) && (minX < 0))) {
 						//X origin
-						Expression lineX1 = make_line(minX, 0, maxX, 0, 0);
-						result.push_back(lineX1);
+						plot->add_line(minX, 0, maxX, 0, 0);
 					}
 					else {
 						//X origin
-						Expression lineX1 = make_line(minX, 0, maxX, 0, 0);
-						result.push_back(lineX1);
+						plot->add_line(minX, 0, maxX, 0, 0);
 						//Y origin
-						Expression lineY1 = make_line(0, minY, 0, maxY, 0);
-						result.push_back(lineY1);
+						plot->add_line(0, minY, 0, maxY, 0);
 					}
 
 					//Outer lines
-					Expression border1 = make_line(minX, maxY, maxX, maxY, 0);
-					result.push_back(border1);
-					Expression border2 = make_line(minX, minY, maxX, minY, 0);
-					result.push_back(border2);
-					Expression border3 = make_line(minX, maxY, minX, minY, 0);
-					result.push_back(border3);
-					Expression border4 = make_line(maxX, maxY, maxX, minY, 0);
-					result.push_back(border4);
+					plot->add_line(minX, maxY, maxX, maxY, 0);
+					plot->add_line(minX, minY, maxX, minY, 0);
+					plot->add_line(minX, maxY, minX, minY, 0);
+					plot->add_line(maxX, maxY, maxX, minY, 0);
 
 					//if options are there, set the labels
 					if (args.size() == 3) {
@@ -950,28 +1270,21 @@ Expression Expression::handle_continuous(const std::vector<Expression>& args, En
 									textScale = args[2].m_tail[i].m_tail[1].head().asNumber();
 								}
 							}
-							Expression cLabel1 = make_text(maxX, minY + C, AUvalue, textScale, 0);
-							result.push_back(cLabel1);
-							Expression cLabel2 = make_text(minX, minY + C, ALvalue, textScale, 0);
-							result.push_back(cLabel2);
-							Expression cLabel3 = make_text(minX - D, maxY, OUvalue, textScale, 0);
-							result.push_back(cLabel3);
-							Expression cLabel4 = make_text(minX - D, minY, OLvalue, textScale, 0);
-							result.push_back(cLabel4);
+							plot->add_text(maxX, minY + C, AUvalue, textScale, 0);
+							plot->add_text(minX, minY + C, ALvalue, textScale, 0);
+							plot->add_text(minX - D, maxY, OUvalue, textScale, 0);
+							plot->add_text(minX - D, minY, OLvalue, textScale, 0);
 
 							for (size_t i = 0; i < (args[2].m_tail.size()); ++i) {
 								std::list<Expression> label;
 								if (args[2].m_tail[i].m_tail[0].head().asSymbol() == "\"title\"") {
-									Expression cLabel = make_text(xmiddle, maxY - A, args[2].m_tail[i].m_tail[1].head().asSymbol(), textScale, 0);
-									result.push_back(cLabel);
+									plot->add_text(xmiddle, maxY - A, args[2].m_tail[i].m_tail[1].head().asSymbol(), textScale, 0);
 								}
 								else if (args[2].m_tail[i].m_tail[0].head().asSymbol() == "\"abscissa-label\"") {
-									Expression cLabel = make_text(xmiddle, minY + A, args[2].m_tail[i].m_tail[1].head().asSymbol(), textScale, 0);
-									result.push_back(cLabel);
+									plot->add_text(xmiddle, minY + A, args[2].m_tail[i].m_tail[1].head().asSymbol(), textScale, 0);
 								}
 								else if (args[2].m_tail[i].m_tail[0].head().asSymbol() == "\"ordinate-label\"") {
-									Expression cLabel = make_text(minX - B, ymiddle, args[2].m_tail[i].m_tail[1].head().asSymbol(), textScale, (-90 * (atan(1) * 4) / 180));
-									result.push_back(cLabel);
+									plot->add_text(minX - B, ymiddle, args[2].m_tail[i].m_tail[1].head().asSymbol(), textScale, (-90 * (atan(1) * 4) / 180));
 								}
 							}
 						}
@@ -982,14 +1295,10 @@ Expression Expression::handle_continuous(const std::vector<Expression>& args, En
 					else {
 						//Coordinate labels
 						double textScale = 1;
-						Expression cLabel1 = make_text(maxX, minY + C, AUvalue, textScale, 0);
-						result.push_back(cLabel1);
-						Expression cLabel2 = make_text(minX, minY + C, ALvalue, textScale, 0);
-						result.push_back(cLabel2);
-						Expression cLabel3 = make_text(minX - D, maxY, OUvalue, textScale, 0);
-						result.push_back(cLabel3);
-						Expression cLabel4 = make_text(minX - D, minY, OLvalue, textScale, 0);
-						result.push_back(cLabel4);
+						plot->add_text(maxX, minY + C, AUvalue, textScale, 0);
+						plot->add_text(minX, minY + C, ALvalue, textScale, 0);
+						plot->add_text(minX - D, maxY, OUvalue, textScale, 0);
+						plot->add_text(minX - D, minY, OLvalue, textScale, 0);
 					}
 				}
 				else {
@@ -1008,7 +1317,7 @@ Expression Expression::handle_continuous(const std::vector<Expression>& args, En
 		throw SemanticError("Error in call to continuous-plot: invalid number of arguments.");
 	}
 
-	return result;
+	return Expression(Atom(std::shared_ptr<const PlotBuffer>(plot)));
 }
 
 Expression Expression::make_point(double x, double y, double size){
@@ -1017,8 +1326,8 @@ Expression Expression::make_point(double x, double y, double size){
 	result.push_back(Atom(x));
 	result.push_back(Atom(y));
 	Expression point = Expression(result);
-	point.m_prop["\"object-name\""] = Expression(Atom("\"point\""));
-	point.m_prop["\"size\""] = Expression(Atom(size));
+	point.setProperty(OBJECT_NAME_KEY, Expression(Atom("\"point\"")));
+	point.setProperty(SIZE_KEY, Expression(Atom(size)));
 	return point;
 }
 
@@ -1030,8 +1339,8 @@ Expression Expression::make_line(double x1, double y1, double x2, double y2, dou
 	result.push_back(point1);
 	result.push_back(point2);
 	Expression line = Expression(result);
-	line.m_prop["\"object-name\""] = Expression(Atom("\"line\""));
-	line.m_prop["\"thickness\""] = Expression(Atom(thickness));
+	line.setProperty(OBJECT_NAME_KEY, Expression(Atom("\"line\"")));
+	line.setProperty(THICKNESS_KEY, Expression(Atom(thickness)));
 	return line;
 }
 
@@ -1039,10 +1348,10 @@ Expression Expression::make_text(double x, double y, std::string text, double sc
 
 	Expression string = Expression(Atom(text));
 	Expression point = make_point(x, y, 0);
-	string.m_prop["\"object-name\""] = Expression(Atom("\"text\""));
-	string.m_prop["\"position\""] = point;
-	string.m_prop["\"scale\""] = Expression(Atom(scale));
-	string.m_prop["\"rotation\""] = Expression(Atom(rotation));
+	string.setProperty(OBJECT_NAME_KEY, Expression(Atom("\"text\"")));
+	string.setProperty(POSITION_KEY, std::move(point));
+	string.setProperty(SCALE_KEY, Expression(Atom(scale)));
+	string.setProperty(ROTATION_KEY, Expression(Atom(rotation)));
 	return string;
 }
 
@@ -1050,7 +1359,9 @@ Expression Expression::make_text(double x, double y, std::string text, double sc
 // difficult with the ast data structure used (no parent pointer).
 // this limits the practical depth of our AST
 Expression Expression::eval(Environment & env){
-  
+
+  InterruptScope::check();
+
   if(m_tail.empty() && m_head.asSymbol() != "list"){
     return handle_lookup(m_head, env);
   }
@@ -1100,6 +1411,9 @@ Expression Expression::eval(Environment & env){
       results.push_back(it->eval(env));
     }
 	if ((m_head.asSymbol() == "set-property") || (m_head.asSymbol() == "get-property") || (m_head.asSymbol() == "discrete-plot")) {
+		for (auto & r : results) {
+			if (r.isHeadPlot()) r = r.expanded();
+		}
 		if (m_head.asSymbol() == "set-property") {
 			return handle_setprop(results);
 		}
@@ -1139,9 +1453,41 @@ std::vector<Expression> Expression::eval_app_map(Environment & env, Expression a
 	return results;
 }
 
+namespace {
+// the innermost InterruptScope of each thread
+thread_local const InterruptScope * current_scope = nullptr;
+}
+
+InterruptScope::InterruptScope(const std::atomic<std::uint64_t> * through, std::uint64_t id):
+  m_through(through), m_id(id), m_outer(current_scope){
+
+  current_scope = this;
+}
+
+InterruptScope::~InterruptScope(){
+
+  current_scope = m_outer;
+}
+
+const InterruptScope * InterruptScope::current() noexcept{
+
+  return current_scope;
+}
+
+void InterruptScope::check(){
+
+  const InterruptScope * scope = current_scope;
+  if(scope && scope->m_through && scope->m_through->load(std::memory_order_relaxed) >= scope->m_id){
+    throw SemanticError("Error: interpreter kernel interrupted");
+  }
+}
+
 std::ostream & operator<<(std::ostream & out, const Expression & exp){
 
-  if(exp.head().isComplex()){
+  if(exp.head().isPlot()){
+	out << exp.expanded();
+  }
+  else if(exp.head().isComplex()){
 	out << exp.head(); 
   }
   else if (exp.head().asSymbol().find("Error") != std::string::npos) {
@@ -4,17 +4,29 @@ Defines the Expression type and assiciated functions.
 #ifndef EXPRESSION_HPP
 #define EXPRESSION_HPP
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <list>
-#include <map>
+#include <memory>
+#include <utility>
 
 #include "token.hpp"
 #include "atom.hpp"
+#include "symbol_table.hpp"
 
 // forward declare Environment
 class Environment;
 
+/// the graphic primitive an Expression is, by its "object-name" property
+enum GraphicsKind : unsigned char {
+  NO_GRAPHICS,    ///< not a point, line or text
+  POINT_GRAPHICS, ///< "object-name" is "point"
+  LINE_GRAPHICS,  ///< "object-name" is "line"
+  TEXT_GRAPHICS   ///< "object-name" is "text"
+};
+
 /*! \class Expression
 \brief An expression is a tree of Atoms.
 
@@ -37,6 +49,9 @@ public:
   /// deep-copy construct an expression (recursive)
   Expression(const Expression & a);
 
+  /// move construct an expression, leaving a NoneType expression
+  Expression(Expression && a) noexcept;
+
   /// construct a list of expressions
   Expression(const std::list<Expression> & a);
 
@@ -46,6 +61,9 @@ public:
   /// deep-copy assign an expression  (recursive)
   Expression & operator=(const Expression & a);
 
+  /// move assign an expression, leaving a NoneType expression
+  Expression & operator=(Expression && a) noexcept;
+
   /// return a reference to the head Atom
   Atom & head();
 
@@ -55,26 +73,53 @@ public:
   /// append Atom to tail of the expression
   void append(const Atom & a);
 
+  /// reserve room for n expressions in the tail, to append without reallocating
+  void reserveTail(std::size_t n);
+
   /// return a pointer to the last expression in the tail, or nullptr
   Expression * tail();
   
+  /// set property key to value, replacing any value it has
+  void setProperty(const std::string & key, Expression value);
+
+  /// set the property with the fixed name key to value, replacing any value it has
+  void setProperty(SymbolId key, Expression value);
+
+  /// return a pointer to the value of property key, or nullptr
+  const Expression * property(const std::string & key) const;
+
+  /// return a pointer to the value of the property with the fixed name key, or nullptr
+  const Expression * property(SymbolId key) const noexcept;
+
+  /// return the number of properties
+  std::size_t propertyCount() const noexcept;
+
+  /// return the key of the i-th property, in the order they were first set
+  const std::string & propertyKey(std::size_t i) const;
+
+  /// return the value of the i-th property, in the order they were first set
+  const Expression & propertyValue(std::size_t i) const;
+
+  /// return the graphic primitive the "object-name" property names
+  GraphicsKind graphicsKind() const noexcept;
+
   /// return "object-name" property
-  std::string objName();
+  std::string objName() const;
   
   /// return "size" property for point
-  double pointSize();
+  double pointSize() const;
     
   /// return "thickness" property for line
-  double lineThick();
+  double lineThick() const;
   
   /// return "position" property for text
-  Expression textPos();
+  Expression textPos() const;
   
   /// return "scale" property for text
-  double textScale();
+  double textScale() const;
   
   ///return "rotation" property for text
-  double textRotation();
+  double textRotation() const;
 
   /// return a const-iterator to the beginning of tail
   ConstIteratorType tailConstBegin() const noexcept;
@@ -91,6 +136,13 @@ public:
   /// convienience member to determine if head atom is a complex
   bool isHeadComplex() const noexcept;
 
+  /// convienience member to determine if head atom is a plot
+  bool isHeadPlot() const noexcept;
+
+  /// return the list of graphic primitives a plot stands for, or a copy
+  /// of any other expression
+  Expression expanded() const;
+
   /// Evaluate expression using a post-order traversal (recursive)
   Expression eval(Environment & env);
 
@@ -99,9 +151,6 @@ public:
 
   /// steps used in map and apply
   std::vector<Expression> eval_app_map(Environment & env, Expression arguments);
-  
-  /// the property list
-  std::map<std::string, Expression> m_prop;
 
   /// equality comparison for two expressions (recursive)
   bool operator==(const Expression & exp) const noexcept;
@@ -115,6 +164,18 @@ private:
   // and cache coherence, at the cost of wasted memory.
   std::vector<Expression> m_tail;
 
+  // a property, defined below as Expression is complete
+  struct Property;
+
+  // the properties in the order they were first set. most expressions
+  // have none, so the list is only allocated with the first, and graphic
+  // primitives have at most four, so it is searched linearly.
+  typedef std::vector<Property> PropertyList;
+  std::unique_ptr<PropertyList> m_prop;
+
+  // the kind named by the "object-name" property, kept as it is set
+  GraphicsKind m_kind = NO_GRAPHICS;
+
   // convenience typedef
   typedef std::vector<Expression>::iterator IteratorType;
   
@@ -128,9 +189,55 @@ private:
   Expression handle_discrete(const std::vector<Expression> & args);
   Expression handle_continuous(const std::vector<Expression> & args, Environment & env);
 
-  Expression make_point(double x, double y, double size);
-  Expression make_line(double x1, double y1, double x2, double y2, double thickness);
-  Expression make_text(double x, double y, std::string text, double scale, double rotation);
+  static Expression make_point(double x, double y, double size);
+  static Expression make_line(double x1, double y1, double x2, double y2, double thickness);
+  static Expression make_text(double x, double y, std::string text, double scale, double rotation);
+};
+
+// a property, by the id of its fixed name, or by name, with key
+// PROPERTY_KEY_COUNT, for any other
+struct Expression::Property {
+  SymbolId key;
+  std::string name;
+  Expression value;
+};
+
+/*! \class InterruptScope
+\brief Lets another thread interrupt the evaluation of a request
+
+While an InterruptScope exists, Expression::eval on the thread that made it
+throws SemanticError("Error: interpreter kernel interrupted") as soon as
+*through is at least id, so a front end interrupts requests up to an id by
+storing it. Scopes nest, and the threads continuous-plot samples on
+inherit the scope of the thread starting them.
+*/
+class InterruptScope {
+public:
+
+  /// make evaluations on this thread stop once *through >= id, through
+  /// may be nullptr for no interruption
+  InterruptScope(const std::atomic<std::uint64_t> * through, std::uint64_t id);
+
+  /// restore the scope that was current before
+  ~InterruptScope();
+
+  InterruptScope(const InterruptScope &) = delete;
+  InterruptScope & operator=(const InterruptScope &) = delete;
+
+  /// return the scope current on this thread, or nullptr
+  static const InterruptScope * current() noexcept;
+
+  /// throw if the scope current on this thread has been interrupted
+  static void check();
+
+  /// the flag and id of this scope, to pass to another thread
+  const std::atomic<std::uint64_t> * through() const noexcept { return m_through; }
+  std::uint64_t id() const noexcept { return m_id; }
+
+private:
+  const std::atomic<std::uint64_t> * m_through;
+  std::uint64_t m_id;
+  const InterruptScope * m_outer;
 };
 
 /// Render expression to output stream
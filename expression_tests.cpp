@@ -1,6 +1,10 @@
 #include "catch.hpp"
 
+#include <memory>
+#include <sstream>
+
 #include "expression.hpp"
+#include "plot_buffer.hpp"
 
 TEST_CASE( "Test default expression", "[expression]" ) {
 
@@ -29,3 +33,127 @@ TEST_CASE( "Test symbol expression", "[expression]" ) {
   REQUIRE(exp.isHeadSymbol());
   REQUIRE(!exp.isHeadComplex());
 }
+
+TEST_CASE( "Test copying and moving expressions", "[expression]" ) {
+
+  Expression exp(Atom("list"));
+  exp.append(Atom(1.));
+  exp.append(Atom("a"));
+  exp.tail()->append(Atom(std::complex<double>(0, 1)));
+  exp.setProperty("\"object-name\"", Expression(Atom("\"point\"")));
+
+  Expression copy(exp);
+  REQUIRE(copy == exp);
+  REQUIRE(copy.objName() == "\"point\"");
+
+  Expression moved(std::move(copy));
+  REQUIRE(moved == exp);
+  REQUIRE(moved.objName() == "\"point\"");
+  REQUIRE(copy == Expression());
+  REQUIRE(copy.propertyCount() == 0);
+  REQUIRE(copy.graphicsKind() == NO_GRAPHICS);
+
+  Expression assigned;
+  assigned = std::move(moved);
+  REQUIRE(assigned == exp);
+  REQUIRE(moved == Expression());
+
+  // assigning a subexpression to its parent
+  Expression child = *assigned.tail();
+  assigned = *assigned.tail();
+  REQUIRE(assigned == child);
+  assigned = exp;
+  assigned = std::move(*assigned.tail());
+  REQUIRE(assigned == child);
+  REQUIRE(assigned.tailConstBegin()->isHeadComplex());
+}
+
+TEST_CASE( "Test expression properties", "[expression]" ) {
+
+  Expression exp(Atom(1.));
+  REQUIRE(exp.propertyCount() == 0);
+  REQUIRE(exp.property("\"size\"") == nullptr);
+  REQUIRE(exp.property("\"never-set\"") == nullptr);
+  REQUIRE(exp.objName() == "NONE");
+  REQUIRE(exp.graphicsKind() == NO_GRAPHICS);
+
+  // keys are kept in the order first set, and setting again replaces
+  exp.setProperty("\"weight\"", Expression(Atom(2.)));
+  exp.setProperty("\"size\"", Expression(Atom(3.)));
+  exp.setProperty("\"weight\"", Expression(Atom(4.)));
+  REQUIRE(exp.propertyCount() == 2);
+  REQUIRE(exp.propertyKey(0) == "\"weight\"");
+  REQUIRE(exp.propertyValue(0) == Expression(Atom(4.)));
+  REQUIRE(exp.propertyKey(1) == "\"size\"");
+  REQUIRE(exp.property(SIZE_KEY) == exp.property("\"size\""));
+  REQUIRE(exp.pointSize() == 3);
+
+  // the graphic kind follows "object-name"
+  exp.setProperty("\"object-name\"", Expression(Atom("\"line\"")));
+  REQUIRE(exp.graphicsKind() == LINE_GRAPHICS);
+  REQUIRE(exp.objName() == "\"line\"");
+  exp.setProperty(OBJECT_NAME_KEY, Expression(Atom("\"chart\"")));
+  REQUIRE(exp.graphicsKind() == NO_GRAPHICS);
+  REQUIRE(exp.objName() == "\"chart\"");
+  exp.setProperty(OBJECT_NAME_KEY, Expression(Atom("\"text\"")));
+  REQUIRE(exp.graphicsKind() == TEXT_GRAPHICS);
+
+  // only the property names of the graphic primitives have ids, others
+  // are kept by the expression
+  SymbolId id;
+  REQUIRE(find_symbol("\"thickness\"", id));
+  REQUIRE(id == THICKNESS_KEY);
+  REQUIRE(symbol_name(id) == "\"thickness\"");
+  REQUIRE(!find_symbol("\"weight\"", id));
+  REQUIRE(exp.property(PROPERTY_KEY_COUNT) == nullptr);
+
+  // copies do not share properties
+  Expression copy(exp);
+  copy.setProperty("\"weight\"", Expression(Atom(5.)));
+  REQUIRE(exp.property("\"weight\"")->head().asNumber() == 4);
+  REQUIRE(copy.graphicsKind() == TEXT_GRAPHICS);
+
+  // and properties do not take part in equality
+  REQUIRE(copy == Expression(Atom(1.)));
+}
+
+TEST_CASE( "Test plot expressions", "[expression]" ) {
+
+  std::shared_ptr<PlotBuffer> buffer = std::make_shared<PlotBuffer>();
+  buffer->add_point(1, 2, 0.5);
+  buffer->add_line(1, 2, 1, 0, 0);
+  buffer->add_text(0, -3, "\"title\"", 2, 0);
+  buffer->add_point(3, 4, 0.5);
+  Expression plot = Expression(Atom(std::shared_ptr<const PlotBuffer>(buffer)));
+
+  REQUIRE(plot.isHeadPlot());
+  REQUIRE(!plot.isHeadSymbol());
+  REQUIRE(plot.tailConstBegin() == plot.tailConstEnd());
+
+  // a plot stands for its primitives, in drawing order
+  Expression list = plot.expanded();
+  REQUIRE(list.head() == Atom("List"));
+  REQUIRE(std::distance(list.tailConstBegin(), list.tailConstEnd()) == 4);
+  std::vector<Expression> items(list.tailConstBegin(), list.tailConstEnd());
+  REQUIRE(items[0].objName() == "\"point\"");
+  REQUIRE(items[0].pointSize() == 0.5);
+  REQUIRE(*items[0].tailConstBegin() == Expression(1.));
+  REQUIRE(items[1].objName() == "\"line\"");
+  REQUIRE(items[1].lineThick() == 0);
+  REQUIRE(items[2].objName() == "\"text\"");
+  REQUIRE(items[2].head() == Atom("\"title\""));
+  REQUIRE(items[2].textScale() == 2);
+  REQUIRE(items[2].textPos().objName() == "\"point\"");
+  REQUIRE(items[3].objName() == "\"point\"");
+  REQUIRE(*items[3].tailConstBegin() == Expression(3.));
+
+  // and prints as them
+  std::ostringstream printed, expected;
+  printed << plot;
+  expected << list;
+  REQUIRE(printed.str() == expected.str());
+
+  // anything else expands to itself
+  REQUIRE(list.expanded() == list);
+  REQUIRE(Expression(1.).expanded() == Expression(1.));
+}
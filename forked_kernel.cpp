@@ -0,0 +1,213 @@
+#include "forked_kernel.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+
+#include "interpreter.hpp"
+#include "script_cache.hpp"
+#include "semantic_error.hpp"
+#include "server.hpp"
+
+#if defined(__APPLE__) || defined(__linux) || defined(__unix) ||             \
+    defined(__posix)
+#define FORKED_KERNEL_HAVE_POSIX
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef FORKED_KERNEL_HAVE_POSIX
+
+// the kernel process: evaluate each request frame on fd and answer with
+// a result frame, until the front end closes its end
+void run_kernel(int fd){
+
+  // Ctrl-C in a terminal signals the whole process group, the front end
+  // decides whether to interrupt the kernel
+  std::signal(SIGINT, SIG_IGN);
+
+  Interpreter interp;
+  try{
+    interp.startup();
+  }
+  catch(const SemanticError &){
+  }
+
+  std::string program;
+  while(read_frame(fd, program)){
+    std::string response(1, RESPONSE_RESULT);
+
+    if(!interp.parseBuffer(program.data(), program.size())){
+      response[0] = RESPONSE_ERROR;
+      response += "Error: Invalid Expression. Could not parse.";
+    }
+    else{
+      try{
+        Expression result = interp.evaluate();
+        std::ostringstream out;
+        write_compiled(out, result, SourceDigest());
+        response += out.str();
+      }
+      catch(const SemanticError & ex){
+        response[0] = RESPONSE_ERROR;
+        response += ex.what();
+      }
+    }
+
+    if(!write_frame(fd, response)){
+      break;
+    }
+  }
+}
+
+#endif
+
+} // namespace
+
+ForkedKernel::ForkedKernel(): m_kernel{-1, -1}, m_spare{-1, -1} {}
+
+ForkedKernel::~ForkedKernel(){
+
+  kill(m_kernel);
+  kill(m_spare);
+}
+
+bool ForkedKernel::start(){
+
+#ifdef FORKED_KERNEL_HAVE_POSIX
+  // load the startup snapshot here, so every kernel inherits it
+  try{
+    Interpreter().startup();
+  }
+  catch(const SemanticError &){
+  }
+
+  m_kernel = fork_kernel();
+  m_spare = fork_kernel();
+  return started();
+#else
+  return false;
+#endif
+}
+
+bool ForkedKernel::started() const noexcept{
+
+  return m_kernel.pid > 0;
+}
+
+bool ForkedKernel::send(const std::string & program){
+
+  if(!started() || !write_frame(m_kernel.fd, program)){
+    return false;
+  }
+
+  // replace a spare used by reset while the kernel evaluates, rather than
+  // making reset wait for the fork
+  if(m_spare.pid <= 0){
+    m_spare = fork_kernel();
+  }
+  return true;
+}
+
+ForkedKernel::Status ForkedKernel::wait(Expression & result, std::chrono::milliseconds timeout){
+
+#ifdef FORKED_KERNEL_HAVE_POSIX
+  if(!started()){
+    return KERNEL_DIED;
+  }
+
+  pollfd ready = {m_kernel.fd, POLLIN, 0};
+  int n = ::poll(&ready, 1, static_cast<int>(timeout.count()));
+  if(n == 0 || (n < 0 && errno == EINTR)){
+    return KERNEL_TIMEOUT;
+  }
+
+  std::string response;
+  if(n < 0 || !read_frame(m_kernel.fd, response) || response.empty()){
+    reset();
+    return KERNEL_DIED;
+  }
+
+  if(response[0] == RESPONSE_ERROR){
+    result = Expression(Atom(response.substr(1)));
+    return KERNEL_RESULT;
+  }
+
+  SourceDigest source;
+  if(!read_compiled(response.data() + 1, response.size() - 1, result, source)){
+    reset();
+    return KERNEL_DIED;
+  }
+  return KERNEL_RESULT;
+#else
+  return KERNEL_DIED;
+#endif
+}
+
+bool ForkedKernel::reset(){
+
+  kill(m_kernel);
+  m_kernel = m_spare;
+  m_spare = Process{-1, -1};
+
+  // no spare since the last reset, or it could not be forked
+  if(!started()){
+    m_kernel = fork_kernel();
+  }
+  return started();
+}
+
+ForkedKernel::Process ForkedKernel::fork_kernel(){
+
+  Process process = {-1, -1};
+
+#ifdef FORKED_KERNEL_HAVE_POSIX
+  int fds[2];
+  if(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0){
+    return process;
+  }
+
+  pid_t pid = ::fork();
+  if(pid < 0){
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return process;
+  }
+
+  if(pid == 0){
+    // only the kernel's own end stays open in the child
+    ::close(fds[0]);
+    if(m_kernel.fd >= 0) ::close(m_kernel.fd);
+    if(m_spare.fd >= 0) ::close(m_spare.fd);
+    run_kernel(fds[1]);
+    // skip the front end's exit handlers and static destructors
+    ::_exit(EXIT_SUCCESS);
+  }
+
+  ::close(fds[1]);
+  process.pid = pid;
+  process.fd = fds[0];
+#endif
+
+  return process;
+}
+
+void ForkedKernel::kill(Process & process){
+
+#ifdef FORKED_KERNEL_HAVE_POSIX
+  if(process.pid > 0){
+    ::kill(process.pid, SIGKILL);
+    ::waitpid(process.pid, nullptr, 0);
+    ::close(process.fd);
+  }
+#endif
+  process.pid = -1;
+  process.fd = -1;
+}
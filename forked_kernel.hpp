@@ -0,0 +1,94 @@
+/*! \file forked_kernel.hpp
+Defines the forked kernel, an interpreter kernel run in a child process.
+
+The kernel process is forked from the front end after the startup
+environment has been loaded, so it starts warm. A spare kernel is forked
+ahead of time, so resetting or interrupting the kernel only kills the
+current process and promotes the spare; the next spare is forked when a
+program is next sent, while the kernel evaluates it. A runaway evaluation
+is stopped at once, and a crash in the kernel does not take the front end
+with it.
+
+Requests and results are frames (see server.hpp) on a socket pair. A
+result frame is a status byte followed by the result as a compiled
+script (see script_cache.hpp), so it arrives with all its properties, or
+by the error message.
+ */
+#ifndef FORKED_KERNEL_HPP
+#define FORKED_KERNEL_HPP
+
+#include <chrono>
+#include <string>
+
+#include "expression.hpp"
+
+/*! \class ForkedKernel
+\brief An interpreter kernel in a child process, with a warm spare
+
+Only available on POSIX platforms, elsewhere start always fails. Forking
+copies only the calling thread, so the kernel must be started and reset
+from a thread that does not race with other threads holding locks used
+during evaluation.
+*/
+class ForkedKernel {
+public:
+
+  /// result of waiting for the kernel
+  enum Status {KERNEL_RESULT, KERNEL_TIMEOUT, KERNEL_DIED};
+
+  /// Construct a kernel, not yet started
+  ForkedKernel();
+
+  /// kill the kernel and the spare
+  ~ForkedKernel();
+
+  ForkedKernel(const ForkedKernel &) = delete;
+  ForkedKernel & operator=(const ForkedKernel &) = delete;
+
+  /*! Load the startup environment and fork the kernel and the spare
+    \return false if the processes could not be created
+   */
+  bool start();
+
+  /// return true if start succeeded
+  bool started() const noexcept;
+
+  /*! Send a program to the kernel for evaluation, then fork a spare if
+    there is none
+    \return false if the kernel is not running
+   */
+  bool send(const std::string & program);
+
+  /*! Wait for the result of the program sent last
+    \param result set to the result, or to the error message as a symbol,
+    if the result arrived
+    \param timeout how long to wait, a signal ends the wait early
+    \return KERNEL_RESULT, KERNEL_TIMEOUT, or KERNEL_DIED if the kernel
+    exited (it has then been replaced, as by reset)
+   */
+  Status wait(Expression & result, std::chrono::milliseconds timeout);
+
+  /*! Replace the kernel by the spare, which has the startup environment.
+    The new spare is forked by the next send; without a spare, as after two
+    resets in a row, a new kernel is forked here. Also used to interrupt an
+    evaluation.
+    \return false if no kernel could be started
+   */
+  bool reset();
+
+private:
+
+  // a kernel process and the front end's end of its socket pair
+  struct Process {
+    int pid;
+    int fd;
+  };
+
+  Process m_kernel;
+  Process m_spare;
+
+  Process fork_kernel();
+  void kill(Process & process);
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "catch.hpp"
+
+#include <chrono>
+#include <string>
+
+#include "forked_kernel.hpp"
+
+// send a program and wait for its result
+ForkedKernel::Status evaluate_forked(ForkedKernel & kernel, const std::string & program, Expression & result){
+
+  REQUIRE(kernel.send(program));
+  return kernel.wait(result, std::chrono::seconds(60));
+}
+
+TEST_CASE( "Test evaluating in a forked kernel", "[forked_kernel]" ) {
+
+  ForkedKernel kernel;
+  REQUIRE(!kernel.started());
+  REQUIRE(kernel.start());
+  REQUIRE(kernel.started());
+
+  Expression result;
+
+  {
+    INFO("the environment persists between requests");
+    REQUIRE(evaluate_forked(kernel, "(define a 3)", result) == ForkedKernel::KERNEL_RESULT);
+    REQUIRE(result == Expression(3.));
+    REQUIRE(evaluate_forked(kernel, "(+ a 1)", result) == ForkedKernel::KERNEL_RESULT);
+    REQUIRE(result == Expression(4.));
+  }
+
+  {
+    INFO("results keep their properties");
+    REQUIRE(evaluate_forked(kernel, "(make-point 1 2)", result) == ForkedKernel::KERNEL_RESULT);
+    REQUIRE(result.objName() == "\"point\"");
+  }
+
+  {
+    INFO("errors are returned as symbols");
+    REQUIRE(evaluate_forked(kernel, "(+ 1", result) == ForkedKernel::KERNEL_RESULT);
+    REQUIRE(result == Expression(Atom("Error: Invalid Expression. Could not parse.")));
+    REQUIRE(evaluate_forked(kernel, "(undefined-procedure)", result) == ForkedKernel::KERNEL_RESULT);
+    REQUIRE(result.head().asSymbol().find("Error") == 0);
+  }
+
+  {
+    INFO("reset restores the startup environment");
+    REQUIRE(kernel.reset());
+    REQUIRE(evaluate_forked(kernel, "(+ a 1)", result) == ForkedKernel::KERNEL_RESULT);
+    REQUIRE(result.head().asSymbol().find("Error") == 0);
+  }
+
+  {
+    INFO("resets in a row, before a spare is forked, start a new kernel");
+    REQUIRE(evaluate_forked(kernel, "(define a 3)", result) == ForkedKernel::KERNEL_RESULT);
+    REQUIRE(kernel.reset());
+    REQUIRE(kernel.reset());
+    REQUIRE(kernel.reset());
+    REQUIRE(evaluate_forked(kernel, "(+ a 1)", result) == ForkedKernel::KERNEL_RESULT);
+    REQUIRE(result.head().asSymbol().find("Error") == 0);
+    REQUIRE(evaluate_forked(kernel, "(+ 1 1)", result) == ForkedKernel::KERNEL_RESULT);
+    REQUIRE(result == Expression(2.));
+  }
+}
+
+TEST_CASE( "Test interrupting a forked kernel", "[forked_kernel]" ) {
+
+  ForkedKernel kernel;
+  REQUIRE(kernel.start());
+
+  Expression result;
+  REQUIRE(evaluate_forked(kernel, "(define a 3)", result) == ForkedKernel::KERNEL_RESULT);
+
+  {
+    INFO("a runaway evaluation is killed by reset");
+    REQUIRE(kernel.send("(begin (define f (lambda (x) (+ x 1))) (map f (range 0 10000000 1)))"));
+    REQUIRE(kernel.wait(result, std::chrono::milliseconds(20)) == ForkedKernel::KERNEL_TIMEOUT);
+
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE(kernel.reset());
+    REQUIRE(evaluate_forked(kernel, "(+ 1 1)", result) == ForkedKernel::KERNEL_RESULT);
+    REQUIRE(result == Expression(2.));
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+  }
+
+  {
+    INFO("a crash in the kernel is reported and the kernel replaced");
+    REQUIRE(evaluate_forked(kernel, "(begin (define f (lambda (x) (f x))) (f 1))", result) ==
+	    ForkedKernel::KERNEL_DIED);
+    REQUIRE(kernel.started());
+    REQUIRE(evaluate_forked(kernel, "(+ 2 2)", result) == ForkedKernel::KERNEL_RESULT);
+    REQUIRE(result == Expression(4.));
+  }
+}
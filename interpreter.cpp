@@ -1,26 +1,87 @@
 #include "interpreter.hpp"
 
 // system includes
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <utility>
 
 // module includes
 #include "token.hpp"
 #include "parse.hpp"
+#include "script_cache.hpp"
+#include "script_file.hpp"
 #include "expression.hpp"
 #include "environment.hpp"
 #include "semantic_error.hpp"
+#include "startup_config.hpp"
 
-bool Interpreter::parseStream(std::istream & expression) noexcept{
+namespace {
+
+// the environment after evaluating the startup file, shared by all
+// interpreters in the process once captured
+std::mutex startup_mutex;
+std::unique_ptr<const Environment> startup_env;
 
-  TokenSequenceType tokens = tokenize(expression);
+}
 
-  ast = parse(tokens);
+bool Interpreter::parseStream(std::istream & expression) noexcept{
+
+  ast = parse(expression);
 
   return (ast != Expression());
 };
+
+bool Interpreter::parseBuffer(const char * data, std::size_t size) noexcept{
+
+  ast = parse(data, size);
+
+  return (ast != Expression());
+}
+
+bool Interpreter::parseExpression(Expression && program) noexcept{
+
+  ast = std::move(program);
+
+  return (ast != Expression());
+}
+
+bool Interpreter::parseCompiled(const char * data, std::size_t size, SourceDigest & source) noexcept{
+
+  return read_compiled(data, size, ast, source) && (ast != Expression());
+}
+
+void Interpreter::writeCompiled(std::ostream & out, const SourceDigest & source) const{
+
+  write_compiled(out, ast, source);
+}
 				     
 
 Expression Interpreter::evaluate(){
 
   return ast.eval(env);
 }
+
+Interpreter::StartupStatus Interpreter::startup(){
+
+  std::lock_guard<std::mutex> lock(startup_mutex);
+
+  if(!startup_env){
+    ScriptFile file;
+    if(!file.open(STARTUP_FILE)){
+      return STARTUP_UNREADABLE;
+    }
+
+    // parsed once per process, so not worth a cache entry
+    Interpreter fresh;
+    if(!fresh.parseBuffer(file.data(), file.size())){
+      return STARTUP_UNPARSABLE;
+    }
+    fresh.evaluate();
+
+    startup_env.reset(new Environment(fresh.env));
+  }
+
+  env = *startup_env;
+  return STARTUP_OK;
+}
@@ -8,35 +8,82 @@ It maintains an environment during evaluation.
 #define INTERPRETER_HPP
 
 // system includes
+#include <cstddef>
 #include <istream>
+#include <ostream>
 #include <string>
 
 // module includes
 #include "environment.hpp"
 #include "expression.hpp"
 
+// forward declare SourceDigest (see script_cache.hpp)
+struct SourceDigest;
+
 /*! \class Interpreter
 \brief Class to parse and evaluate an expression (program)
 
 Interpreter has an Environment, which starts at a default.
 The parse method builds an internal AST.
 The eval method updates Environment and returns last result.
+The startup method replaces the Environment by the one the startup file
+produces.
 */
 class Interpreter {
 public:
 
+  /// result of loading the startup file
+  enum StartupStatus {STARTUP_OK, STARTUP_UNREADABLE, STARTUP_UNPARSABLE};
+
   /*! Parse into an internal Expression from a stream
     \param expression the raw text stream repreenting the candidate expression
     \return true on successful parsing 
    */
   bool parseStream(std::istream &expression) noexcept;
 
+  /*! Parse into an internal Expression from a character buffer
+    \param data the first character of the candidate expression
+    \param size the number of characters
+    \return true on successful parsing
+   */
+  bool parseBuffer(const char * data, std::size_t size) noexcept;
+
+  /*! Use an Expression parsed elsewhere (e.g. on another thread) as the
+    internal Expression
+    \param program the parsed program, the None Expression if parsing failed
+    \return true if program is not the None Expression
+   */
+  bool parseExpression(Expression && program) noexcept;
+
+  /*! Load the internal Expression from a compiled script (see script_cache.hpp)
+    \param data the first character of the compiled script
+    \param size the number of characters
+    \param source set to the source digest recorded in the compiled script
+    \return true if the compiled script is valid for this interpreter version
+   */
+  bool parseCompiled(const char * data, std::size_t size, SourceDigest & source) noexcept;
+
+  /*! Write the internal Expression as a compiled script
+    \param out the stream to write to, opened in binary mode
+    \param source the digest of the text it was parsed from
+   */
+  void writeCompiled(std::ostream & out, const SourceDigest & source) const;
+
   /*! Evaluate the Expression by walking the tree, returning the result.
     \return the Expression resulting from the evaluation in the current environment
     \throws SemanticError when a semantic error is encountered
    */
   Expression evaluate();
 
+  /*! Replace the environment by the one produced by the startup file.
+    The first successful call in the process reads, parses and evaluates
+    STARTUP_FILE in a default environment and keeps the result as a
+    snapshot. Later calls, e.g. on a kernel reset, copy the snapshot.
+    \return STARTUP_OK, or why the startup file could not be loaded
+    \throws SemanticError when evaluating the startup file fails
+   */
+  StartupStatus startup();
+
 private:
 
   // the environment
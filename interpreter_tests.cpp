@@ -5,12 +5,17 @@
 #include <fstream>
 #include <iostream>
 #include <complex>
+#include <cmath>
 #include <list>
+#include <iterator>
+#include <vector>
 #include <thread>
+#include <chrono>
 
 #include "semantic_error.hpp"
 #include "interpreter.hpp"
 #include "expression.hpp"
+#include "plot_buffer.hpp"
 #include "message_queue.hpp"
 #include "consumer.hpp"
 
@@ -1101,6 +1106,86 @@ TEST_CASE( "Test discrete-plot", "[interpreter]" ) {
 	REQUIRE(ok == true);
 	REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
   }
+  
+  { //long series are decimated, the axes still span every point
+    auto plot = [](const std::string & options){
+      std::string program = "(begin (define a (lambda (x) (list x (+ (sin x) (/ x 1000))))) (discrete-plot (map a (range 0 4999 1)) (list (list \"title\" \"Long\") " + options + ")))";
+      INFO(program);
+      return run(program);
+    };
+	auto items = [](const Expression & plot){
+	  REQUIRE(plot.isHeadPlot());
+	  return plot.head().asPlot()->size();
+	};
+	Expression all = plot("(list \"decimation\" \"none\")");
+	std::size_t extras = items(all) - 2 * 5000;
+	REQUIRE(items(plot("")) <= 2 * 4000 + extras);
+	REQUIRE(items(plot("(list \"decimation-threshold\" 5000)")) == items(all));
+	REQUIRE(items(plot("(list \"decimation-threshold\" 100) (list \"decimation\" \"min-max\")")) <= 2 * 100 + extras);
+
+	Expression lttb = plot("(list \"decimation\" \"lttb\") (list \"decimation-threshold\" 100)");
+	REQUIRE(items(lttb) == 2 * 100 + extras);
+	Expression lttbItems = lttb.expanded(), allItems = all.expanded();
+	for (std::size_t k = 1; k <= 5; ++k) {
+	  REQUIRE(*(lttbItems.tailConstEnd() - k) == *(allItems.tailConstEnd() - k));
+	}
+  }
+  
+  { //decimation options must be valid
+    std::vector<std::string> options = {"(list \"decimation\" \"fast\")", "(list \"decimation\" 1)",
+					"(list \"decimation-threshold\" 2)", "(list \"decimation-threshold\" 10.5)", "(list \"decimation-threshold\" \"many\")"};
+	for (auto & option : options) {
+	  std::string program = "(begin (define a (lambda (x) (list x x))) (discrete-plot (map a (range 0 9 1)) (list " + option + ")))";
+	  INFO(program);
+	  Interpreter interp;
+	  std::istringstream iss(program); 
+	  REQUIRE(interp.parseStream(iss));
+	  REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
+	}
+  }
+}
+
+TEST_CASE( "Test plots are lists of graphic primitives to scripts", "[interpreter]" ) {
+
+  std::string plot = "(define p (discrete-plot (list (list 1 1) (list 2 4)) (list (list \"title\" \"Squares\"))))";
+  Expression p = run(plot);
+  REQUIRE(p.isHeadPlot());
+  std::size_t primitives = p.head().asPlot()->size();
+
+  {
+    INFO("list procedures see the primitives");
+    REQUIRE(run("(begin " + plot + " (length p))") == Expression(static_cast<double>(primitives)));
+    REQUIRE(run("(begin " + plot + " (first p))").objName() == "\"point\"");
+    REQUIRE(run("(begin " + plot + " (get-property \"object-name\" (first (rest p))))") == Expression(Atom("\"line\"")));
+    REQUIRE(run("(begin " + plot + " (length (append p 1)))") == Expression(primitives + 1.));
+  }
+
+  {
+    INFO("however they are called");
+    Expression n(static_cast<double>(primitives));
+    Expression twice(std::list<Expression>{n, n});
+    REQUIRE(run("(begin " + plot + " (apply length (list p)))") == n);
+    REQUIRE(run("(begin " + plot + " (map length (list p p)))") == twice);
+    std::string len = "(define len (lambda (x) (length x)))";
+    REQUIRE(run("(begin " + plot + " " + len + " (apply len (list p)))") == n);
+    REQUIRE(run("(begin " + plot + " " + len + " (map len (list p p)))") == twice);
+  }
+
+  {
+    INFO("a plot is a value like any other");
+    REQUIRE(run("(begin " + plot + " p)") == p);
+    REQUIRE(run("(begin " + plot + " (define q p) q)") == p);
+    REQUIRE(run("(begin " + plot + " (define id (lambda (x) x)) (id p))") == p);
+    REQUIRE(run("(begin " + plot + " (get-property \"object-name\" (set-property \"object-name\" \"chart\" p)))") == Expression(Atom("\"chart\"")));
+  }
+
+  {
+    INFO("and prints as its primitives");
+    std::ostringstream printed, expected;
+    printed << p;
+    expected << p.expanded();
+    REQUIRE(printed.str() == expected.str());
+  }
 }
 
 TEST_CASE( "Test continuous-plot", "[interpreter]" ) {
@@ -1163,9 +1248,159 @@ TEST_CASE( "Test continuous-plot", "[interpreter]" ) {
 	REQUIRE(ok == true);
 	REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
   }
+  
+  { //sampling leaves the parameter's definition as it was
+    std::string program = "(begin (define x 7) (define j (lambda (x) (* x x))) (continuous-plot j (list -2 2)) x)";
+	INFO(program);
+	REQUIRE(run(program) == Expression(7.));
+  }
+  
+  { //including a builtin constant
+    std::string program = "(begin (define j (lambda (e) (* e e))) (continuous-plot j (list -2 2)) e)";
+	INFO(program);
+	REQUIRE(run(program) == Expression(std::exp(1)));
+  }
+  
+  { //a body that defines is sampled without keeping its definitions
+    std::string program = "(begin (define j (lambda (x) (begin (define y (* x x)) y))) (continuous-plot j (list -2 2)) (define y 1))";
+	INFO(program);
+	REQUIRE(run(program) == Expression(1.));
+  }
+  
+  { //the default sampling draws the lines continuous-plot always has
+    std::string program = "(begin (define f (lambda (x) (sin (* 3 x)))) (continuous-plot f (list -3 3)))";
+	Expression plot = run(program);
+	REQUIRE(plot.isHeadPlot());
+	Expression list = plot.expanded();
+	std::vector<Expression> items(list.tailConstBegin(), list.tailConstEnd());
+	REQUIRE(items.size() == 349);
+
+	//the curve is the first 339 lines, joined end to end
+	auto coordinates = [&items](std::size_t i){
+	  std::vector<double> xy;
+	  for (auto e = items[i].tailConstBegin(); e != items[i].tailConstEnd(); ++e) {
+	    for (auto c = e->tailConstBegin(); c != e->tailConstEnd(); ++c) {
+	      xy.push_back(c->head().asNumber());
+	    }
+	  }
+	  REQUIRE(xy.size() == 4);
+	  return xy;
+	};
+	double sumx = 0, sumy = 0;
+	for (std::size_t i = 0; i < 339; ++i) {
+	  std::vector<double> xy = coordinates(i);
+	  if (i > 0) REQUIRE(xy[0] == coordinates(i - 1)[2]);
+	  sumx += xy[0];
+	  sumy += xy[1];
+	}
+	REQUIRE(coordinates(339)[0] != coordinates(338)[2]);
+	REQUIRE(std::fabs(sumx - -149.64605) < 1e-3);
+	REQUIRE(std::fabs(sumy - 62.48045) < 1e-2);
+
+	//at the points the original sampler took
+	std::vector<std::pair<std::size_t, std::vector<double>>> expected = {
+	  {0, {-10, 4.12517, -9.59184, 7.12536}},
+	  {1, {-9.59184, 7.12536, -9.38776, 8.28951}},
+	  {200, {1.62628, -9.95227, 1.62946, -9.9553}},
+	  {338, {9.59184, -7.12536, 10, -4.12517}}};
+	for (auto & line : expected) {
+	  std::vector<double> xy = coordinates(line.first);
+	  for (std::size_t c = 0; c < 4; ++c) {
+	    REQUIRE(std::fabs(xy[c] - line.second[c]) < 1e-5);
+	  }
+	}
+  }
+  
+  { //sampling options trade the number of lines for speed
+    auto items = [](const std::string & options){
+      std::string program = "(begin (define f (lambda (x) (sin (* 4 x)))) (continuous-plot f (list -3 3) (list (list \"title\" \"wave\") " + options + ")))";
+      INFO(program);
+      Expression plot = run(program);
+      REQUIRE(plot.isHeadPlot());
+      return plot.head().asPlot()->size();
+    };
+	auto standard = items("");
+	auto preview = items("(list \"preview\" 1)");
+	REQUIRE(preview < standard);
+	REQUIRE(items("(list \"preview\" 0)") == standard);
+	REQUIRE(standard < items("(list \"initial-samples\" 200) (list \"max-depth\" 12) (list \"angle-tolerance\" 1)"));
+	REQUIRE(items("(list \"error-tolerance\" 0.5)") < standard);
+	REQUIRE(items("(list \"sampling\" \"slope\")") == standard);
+	auto turn = items("(list \"sampling\" \"turn\")");
+	REQUIRE(turn != standard);
+	REQUIRE(items("(list \"sampling\" \"turn\") (list \"error-tolerance\" 0.5)") < turn);
+
+	//preview refines by turns, unless told otherwise
+	REQUIRE(items("(list \"preview\" 1) (list \"sampling\" \"turn\")") == preview);
+	REQUIRE(items("(list \"sampling\" \"slope\") (list \"preview\" 1)") != preview);
+
+	//explicit options apply over preview, in any order
+	REQUIRE(items("(list \"max-depth\" 0) (list \"initial-samples\" 10) (list \"preview\" 1)") == items("(list \"initial-samples\" 10) (list \"max-depth\" 0)"));
+	REQUIRE(items("(list \"max-depth\" 0) (list \"initial-samples\" 10) (list \"preview\" 1)") < preview);
+  }
+  
+  { //threads sample the same points as one thread
+    std::string plot = "(begin (define x 7) (define g (lambda (y) (* y y))) (define f (lambda (x) (+ (g (sin (* 4 x))) x))) (continuous-plot f (list -3 3) (list (list \"initial-samples\" 400) ";
+	Expression serial = run(plot + "(list \"threads\" 1))))");
+	Expression threaded = run(plot + "(list \"threads\" 4))))");
+	REQUIRE(threaded == serial);
+	REQUIRE(run(plot + "(list \"threads\" 4))) x)") == Expression(7.));
+  }
+  
+  { //threads see a large environment without copying it
+    Interpreter interp;
+    std::istringstream define("(begin (define big (range 0 100000 1)) (define f (lambda (x) (+ (sin (* 4 x)) x))))");
+	REQUIRE(interp.parseStream(define));
+	interp.evaluate();
+	auto seconds = [&interp](const std::string & threads){
+	  std::istringstream plot("(continuous-plot f (list -3 3) (list (list \"initial-samples\" 400) (list \"threads\" " + threads + ")))");
+	  REQUIRE(interp.parseStream(plot));
+	  auto start = std::chrono::steady_clock::now();
+	  interp.evaluate();
+	  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+	double serial = seconds("1");
+	double threaded = seconds("4");
+	INFO("serial " << serial << " s, threaded " << threaded << " s");
+	REQUIRE(threaded < 2 * serial + 0.05);
+  }
+  
+  { //an error on any thread is reported
+    std::string program = "(begin (define f (lambda (x) (first x))) (continuous-plot f (list -3 3) (list (list \"initial-samples\" 400) (list \"threads\" 4))))";
+	Interpreter interp;
+	std::istringstream iss(program); 
+	REQUIRE(interp.parseStream(iss));
+	REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
+  }
+  
+  { //sampling options must be in range
+    std::vector<std::string> options = {"(list \"initial-samples\" 1)", "(list \"initial-samples\" 2.5)", "(list \"max-depth\" -1)",
+					"(list \"angle-tolerance\" 0)", "(list \"angle-tolerance\" 180)", "(list \"error-tolerance\" -1)",
+					"(list \"max-depth\" \"deep\")", "(list \"preview\" \"yes\")", "(list \"threads\" -2)",
+					"(list \"sampling\" \"fast\")", "(list \"sampling\" 1)"};
+	for (auto & option : options) {
+	  std::string program = "(begin (define f (lambda (x) x)) (continuous-plot f (list -1 1) (list " + option + ")))";
+	  INFO(program);
+	  Interpreter interp;
+	  std::istringstream iss(program); 
+	  REQUIRE(interp.parseStream(iss));
+	  REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
+	}
+  }
+  
+  { //and an error while sampling restores the parameter too
+    std::string program = "(begin (define x 7) (define j (lambda (x) (first x))) (continuous-plot j (list -2 2)))";
+	Interpreter interp;
+	std::istringstream iss(program); 
+	REQUIRE(interp.parseStream(iss));
+	REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
+	std::istringstream again("(+ x 0)");
+	REQUIRE(interp.parseStream(again));
+	REQUIRE(interp.evaluate() == Expression(7.));
+  }
 }
 
-void worker1(inputQueue & inQ){
+void worker1(message_queue<std::string> & inQ){
 	
   for(int i = 0; i < 15; ++i){
 	  std::string line = "Hello";
@@ -1173,7 +1408,7 @@ void worker1(inputQueue & inQ){
   }
 }
 
-void worker2(outputQueue & outQ){
+void worker2(message_queue<Expression> & outQ){
 	
   for(int i = 0; i < 15; ++i){
 	  std::string str = "Hello";
@@ -1248,3 +1483,39 @@ TEST_CASE( "Test using number as procedure", "[interpreter]" ) {
   
   REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
 }
+
+TEST_CASE( "Test restoring the startup environment", "[interpreter]" ) {
+
+  Interpreter interp;
+  REQUIRE(interp.startup() == Interpreter::STARTUP_OK);
+
+  std::istringstream iss("(begin (define a 1) (get-property \"object-name\" (make-point 0 0)))");
+  REQUIRE(interp.parseStream(iss));
+  REQUIRE(interp.evaluate() == Expression(Atom("\"point\"")));
+
+  // a reset drops user definitions but keeps the startup ones
+  REQUIRE(interp.startup() == Interpreter::STARTUP_OK);
+  std::istringstream undefined("(+ a 1)");
+  REQUIRE(interp.parseStream(undefined));
+  REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
+
+  std::istringstream defined("(make-line (make-point 0 0) (make-point 1 1))");
+  REQUIRE(interp.parseStream(defined));
+  REQUIRE_NOTHROW(interp.evaluate());
+
+  // the snapshot is shared with other interpreters
+  Interpreter other;
+  REQUIRE(other.startup() == Interpreter::STARTUP_OK);
+  std::istringstream text("(make-text \"a\")");
+  REQUIRE(other.parseStream(text));
+  REQUIRE(other.evaluate().objName() == "\"text\"");
+}
+
+TEST_CASE( "Test lambda parameters shadowing built-in constants", "[interpreter]" ) {
+
+  std::string program = "(begin (define f (lambda (e) (* 2 e))) (list (f 3) e))";
+  Expression result = run(program);
+
+  REQUIRE(*result.tailConstBegin() == Expression(6.));
+  REQUIRE(*result.tail() == Expression(std::exp(1)));
+}
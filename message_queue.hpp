@@ -1,22 +1,60 @@
 #ifndef _MESSAGE_QUEUE_H_
 #define _MESSAGE_QUEUE_H_
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <utility>
+
+#include "queue_policy.hpp"
 
 template<typename MessageType>
 class message_queue
 {
 public:
-	
-  /// push message into queue, blocks until available
-  void push(MessageType const& message)
+
+  /// construct a queue holding at most capacity messages (0 for no
+  /// limit), policy says what push does when it is full
+  explicit message_queue(std::size_t capacity = 0, OverflowPolicy policy = BLOCK_PRODUCER)
+    : the_capacity(capacity), the_policy(policy), the_stats()
+  {
+    the_stats.capacity = capacity;
+  }
+
+  /// push message into queue, blocks until available, return false if
+  /// the queue is full and rejects it
+  bool push(MessageType const& message)
   {
     std::unique_lock<std::mutex> lock(the_mutex);
+    if(!make_room(lock)) return false;
     the_queue.push(message);
-    lock.unlock();
-    the_condition_variable.notify_one();
+    pushed(lock);
+    return true;
+  }
+
+  /// move message into queue, blocks until available, return false if
+  /// the queue is full and rejects it
+  bool push(MessageType&& message)
+  {
+    std::unique_lock<std::mutex> lock(the_mutex);
+    if(!make_room(lock)) return false;
+    the_queue.push(std::move(message));
+    pushed(lock);
+    return true;
+  }
+
+  /// move message into queue unless the queue is full and would block,
+  /// return false (counted as rejected) instead of waiting for room
+  bool try_push(MessageType&& message)
+  {
+    std::unique_lock<std::mutex> lock(the_mutex);
+    if(!make_room(lock, false)) return false;
+    the_queue.push(std::move(message));
+    pushed(lock);
+    return true;
   }
 
   /// check if queue is empty, blocks until available
@@ -26,21 +64,20 @@ public:
     return the_queue.empty();
   }
 
-  /// pop message from queue, return false if queue is empty
+  /// pop (move) message from queue, return false if queue is empty
   bool try_pop(MessageType& popped_value)
   {
-    std::lock_guard<std::mutex> lock(the_mutex);
+    std::unique_lock<std::mutex> lock(the_mutex);
     if(the_queue.empty())
       {
 	return false;
       }
-        
-    popped_value=the_queue.front();
-    the_queue.pop();
+
+    pop_front(popped_value, lock);
     return true;
   }
 
-  /// pop message from queue, blocks until the queue is nonempty
+  /// pop (move) message from queue, blocks until the queue is nonempty
   void wait_and_pop(MessageType& popped_value)
   {
     std::unique_lock<std::mutex> lock(the_mutex);
@@ -48,22 +85,98 @@ public:
       {
 	the_condition_variable.wait(lock);
       }
-        
-    popped_value=the_queue.front();
-    the_queue.pop();
+
+    pop_front(popped_value, lock);
+  }
+
+  /// pop message from queue, waits up to timeout for the queue to be
+  /// nonempty, return false if it is still empty
+  template<typename Rep, typename Period>
+  bool wait_for_and_pop(MessageType& popped_value, const std::chrono::duration<Rep, Period> & timeout)
+  {
+    std::unique_lock<std::mutex> lock(the_mutex);
+    if(!the_condition_variable.wait_for(lock, timeout, [this](){ return !the_queue.empty(); }))
+      {
+	return false;
+      }
+
+    pop_front(popped_value, lock);
+    return true;
   }
-  
+
   /// return size of queue
   std::size_t size(){
 	  std::lock_guard<std::mutex> lock(the_mutex);
 	  return the_queue.size();
   }
+
+  /// return the current depth and counters
+  QueueStats stats() const
+  {
+    std::lock_guard<std::mutex> lock(the_mutex);
+    QueueStats current = the_stats;
+    current.depth = the_queue.size();
+    return current;
+  }
+
 private:
   std::queue<MessageType> the_queue;
-  
+
+  std::size_t the_capacity;
+  OverflowPolicy the_policy;
+  QueueStats the_stats;
+
   mutable std::mutex the_mutex;
-  
-  std::condition_variable the_condition_variable;	
+
+  std::condition_variable the_condition_variable;
+
+  // waited on by producers blocked on a full queue
+  std::condition_variable the_room_variable;
+
+  // apply the policy if the queue is full, return false to reject, which
+  // a blocking policy does too when may_wait is false
+  bool make_room(std::unique_lock<std::mutex> & lock, bool may_wait = true)
+  {
+    if(the_capacity == 0 || the_queue.size() < the_capacity) return true;
+
+    switch(the_policy){
+    case REJECT_NEWEST:
+      ++the_stats.rejected;
+      return false;
+    case DROP_OLDEST:
+      the_queue.pop();
+      ++the_stats.dropped;
+      return true;
+    default:
+      if(!may_wait){
+	++the_stats.rejected;
+	return false;
+      }
+      while(the_queue.size() >= the_capacity)
+	{
+	  the_room_variable.wait(lock);
+	}
+      return true;
+    }
+  }
+
+  void pushed(std::unique_lock<std::mutex> & lock)
+  {
+    ++the_stats.pushed;
+    if(the_queue.size() > the_stats.high_water) the_stats.high_water = the_queue.size();
+    lock.unlock();
+    the_condition_variable.notify_one();
+  }
+
+  void pop_front(MessageType& popped_value, std::unique_lock<std::mutex> & lock)
+  {
+    popped_value=std::move(the_queue.front());
+    the_queue.pop();
+    if(the_capacity > 0 && the_policy == BLOCK_PRODUCER){
+      lock.unlock();
+      the_room_variable.notify_one();
+    }
+  }
 };
 
 #endif
\ No newline at end of file
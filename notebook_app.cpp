@@ -4,24 +4,22 @@
 
 #include "interpreter.hpp"
 #include "semantic_error.hpp"
-#include "startup_config.hpp"
 #include "consumer.hpp"
 
 #include <QLayout>
 #include <QPushButton>
 #include <QString>
-#include <QTimer>
 
 #include <string>
 #include <sstream>
 #include <iostream>
 #include <fstream>
-#include <thread>
-#include <chrono>
+#include <functional>
+#include <limits>
 #include <thread>
 #include <chrono>
 
-NotebookApp::NotebookApp(QWidget *parent) : QWidget(parent) 
+NotebookApp::NotebookApp(QWidget *parent) : QWidget(parent)
 {
 	input = new InputWidget();
 	input->setObjectName("input");
@@ -37,8 +35,6 @@ NotebookApp::NotebookApp(QWidget *parent) : QWidget(parent)
     interrupt = new QPushButton("Interrupt");
     interrupt->setObjectName("interrupt");
 	
-	timer = new QTimer(this);
-
     auto buttonLayout = new QHBoxLayout();
     buttonLayout->addWidget(start);
     buttonLayout->addWidget(stop);
@@ -52,8 +48,6 @@ NotebookApp::NotebookApp(QWidget *parent) : QWidget(parent)
 	
 	connect(input, SIGNAL(changedScene()), output, SLOT(updateScene()));
 	
-	connect(timer, SIGNAL(timeout()), this, SLOT(loop()));
-	
 	connect(this, SIGNAL(changedScene()), output, SLOT(updateScene()));
 	connect(this, SIGNAL(changedError(QString)), output, SLOT(updateError(QString)));
 	connect(this, SIGNAL(changedExpression(QString)), output, SLOT(updateExpression(QString)));
@@ -71,50 +65,100 @@ NotebookApp::NotebookApp(QWidget *parent) : QWidget(parent)
 		
     setLayout(layout);
 	
-	c1 = new Consumer(&inQ, &outQ, &interp);
-	consumer_thread = new std::thread(*c1);
-	
-	startup();
+	std::string message;
+	bool optionsValid = kernel_queue_options_from_env(queueOptions, message);
+	if (!optionsValid) {
+		queueOptions = KernelQueueOptions();
+	}
+
+	startKernel();
+
+	if (!optionsValid) {
+		emit changedScene();
+		emit changedError(QString::fromStdString("Error: " + message));
+	}
 }
 
 NotebookApp::~NotebookApp()
 {
-	inQ.push("%exit");
-	//send stop to thread
-	consumer_thread->join();
-	delete consumer_thread;
-	delete c1;
+	retireKernel();
+	// interrupted kernels stop at their next evaluation step
+	for (auto & old : retired) {
+		if (!old->exitSent) {
+			old->inQ.push({0, "%exit"});
+		}
+		old->thread.join();
+	}
 }
 
 void NotebookApp::startup()
 {
-	std::ifstream ifs(STARTUP_FILE);
-  
-    if(!ifs){
-	  emit changedScene();
-	  emit changedError("Error: Could not open file for reading.");
-    }
-  
-    if(!interp.parseStream(ifs)){
-	  emit changedScene();
-	  emit changedError("Error: Invalid Expression. Could not parse.");
-    }
-    else{
-  	  try{
-	    Expression start = interp.evaluate();
+	try{
+	  Interpreter::StartupStatus status = kernel->interp.startup();
+	  if(status == Interpreter::STARTUP_UNREADABLE){
+	    emit changedScene();
+	    emit changedError("Error: Could not open file for reading.");
 	  }
-	  catch(const SemanticError & ex){
-	    std::string error(ex.what());
-		QString err = QString::fromStdString(error);
-		emit changedScene();
-		emit changedError(err);
-	  }	
-    }
+	  else if(status == Interpreter::STARTUP_UNPARSABLE){
+	    emit changedScene();
+	    emit changedError("Error: Invalid Expression. Could not parse.");
+	  }
+	}
+	catch(const SemanticError & ex){
+	  std::string error(ex.what());
+	  QString err = QString::fromStdString(error);
+	  emit changedScene();
+	  emit changedError(err);
+	}
 }
 
-void NotebookApp::loop()
+void NotebookApp::startKernel()
 {
-	
+	kernel.reset(new Kernel(queueOptions));
+	startup();
+
+	// the kernel thread posts to the GUI thread when a result is ready
+	Kernel * k = kernel.get();
+	Consumer consumer(&k->inQ, &k->outQ, &k->interp, [this]() {
+		QMetaObject::invokeMethod(this, "showResults", Qt::QueuedConnection);
+	}, &k->interrupted);
+	k->thread = std::thread([k, consumer]() {
+		consumer();
+		k->finished = true;
+	});
+}
+
+void NotebookApp::retireKernel()
+{
+	// the kernel stops what it is evaluating and skips what is queued,
+	// its results are never shown
+	kernel->interrupted = std::numeric_limits<std::uint64_t>::max();
+	retired.push_back(std::move(kernel));
+
+	// join the kernels that have ended, and tell the others to end once
+	// their queue has room
+	for (auto old = retired.begin(); old != retired.end();) {
+		Kernel & k = **old;
+		if (!k.exitSent) {
+			k.exitSent = k.inQ.try_push({0, "%exit"});
+		}
+		if (k.finished) {
+			k.thread.join();
+			old = retired.erase(old);
+		}
+		else {
+			++old;
+		}
+	}
+}
+
+void NotebookApp::setBusy(bool value)
+{
+	busy = value;
+	if (busy)
+		setCursor(Qt::BusyCursor);
+	else
+		unsetCursor();
 }
 
 void NotebookApp::eval(QString line)
@@ -123,24 +167,50 @@ void NotebookApp::eval(QString line)
 	
 	emit changedScene();
 	
-	if(run) {
-		inQ.push(strline);
-		
-		Expression exp;
-		//check output queue for result
-		while (!outQ.try_pop(exp)) {
-			timer->start(1);
+	if(strline == "%stats") {
+		// the counters of the kernel queues, as the REPL shows them
+		emit changedExpression(QString::fromStdString(format_stats("input", kernel->inQ.stats()) + "\n" +
+							      format_stats("output", kernel->outQ.stats())));
+		emit finishEval();
+	}
+	else if(run) {
+		// the result is shown by showResults when the kernel posts it,
+		// a full queue is refused rather than block the GUI
+		if (kernel->inQ.try_push({request + 1, strline})) {
+			++request;
+			setBusy(true);
 		}
-		
-		std::string name = exp.objName();
+		else {
+			emit changedError("Error: interpreter kernel busy");
+			emit finishEval();
+		}
+	}
+	else {
+		emit changedError("Error: interpreter kernel not running");
+		emit finishEval();
+	}
+}
+
+void NotebookApp::showResults()
+{
+	KernelResult result;
+	while (kernel->outQ.try_pop(result)) {
+		// results of superseded or interrupted requests are not shown
+		if (result.id != request) continue;
+
+		Expression exp = std::move(result.exp);
+		GraphicsKind kind = exp.graphicsKind();
 
-		if(name == "\"point\"") {
+		if(exp.isHeadPlot()) {
+			isPlot(*exp.head().asPlot());
+		}
+		else if(kind == POINT_GRAPHICS) {
 			isPoint(exp);
 		}
-		else if(name == "\"line\"") {
+		else if(kind == LINE_GRAPHICS) {
 			isLine(exp);
 		}
-		else if(name == "\"text\"") {
+		else if(kind == TEXT_GRAPHICS) {
 			isText(exp);
 		}
 		else if(exp.head().asSymbol() == "lambda") {
@@ -150,70 +220,50 @@ void NotebookApp::eval(QString line)
 			isList(exp);
 		}
 		else
-			isExpression(exp);	
+			isExpression(exp);
+
+		setBusy(false);
+		emit finishEval();
 	}
-	else 
-		emit changedError("Error: interpreter kernel not running");
 }
 
 void NotebookApp::Start()
 {
-	if(run){}
-	else{
-		delete consumer_thread;
-		run = true;
-		//start thread
-		consumer_thread = new std::thread(*c1);
-	}	
+	run = true;
 }
 
 void NotebookApp::Stop()
 {
-	if(run){
-		inQ.push("%stop");
-		//stop thread
-		consumer_thread->join();
-		run = false;
-	}
-	else{}	
+	// the kernel finishes the requests it has, but takes no more
+	run = false;
 }
 
 void NotebookApp::Reset()
 {
-	if(run){	
-		inQ.push("%reset");
-		//stop thread
-		consumer_thread->join();
-		//reset environment
-		run = true;
-		Interpreter temp;
-		interp = temp;
-		startup();
-		delete c1;
-		delete consumer_thread;
-		//start thread
-		c1 = new Consumer(&inQ, &outQ, &interp);
-		consumer_thread = new std::thread(*c1);
+	// a pending result is not shown after the reset
+	++request;
+	if (busy) {
+		setBusy(false);
+		emit finishEval();
 	}
-	else {
-		run = true;
-		//reset environment
-		Interpreter temp;
-		interp = temp;
-		startup();
-		delete c1;
-		delete consumer_thread;	
-		//start thread
-		c1 = new Consumer(&inQ, &outQ, &interp);
-		consumer_thread = new std::thread(*c1);
-	}	
+	run = true;
+	//reset environment with a fresh kernel, the old one is not waited for
+	retireKernel();
+	startKernel();
 }
 
 void NotebookApp::Interrupt()
 {
-	Reset();
+	// the kernel stops the pending request, keeping its environment,
+	// and the result it then posts is not shown
+	kernel->interrupted = request;
+	++request;
 	emit changedScene();
 	emit changedError("Error: interpreter kernel interrupted");
+	if (busy) {
+		setBusy(false);
+		emit finishEval();
+	}
 }
 
 void NotebookApp::isExpression(Expression exp)
@@ -232,14 +282,17 @@ void NotebookApp::isList(Expression exp)
 {
 	for (auto v = exp.tailConstBegin(); v != exp.tailConstEnd(); ++v) {
 	  Expression value = (*v);
-	  std::string valObj = value.objName();
-	  if(valObj == "\"point\"") {
+	  GraphicsKind kind = value.graphicsKind();
+	  if(value.isHeadPlot()) {
+		isPlot(*value.head().asPlot());
+	  }
+	  else if(kind == POINT_GRAPHICS) {
 		isPoint(value);
 	  }
-	  else if(valObj == "\"line\"") {
+	  else if(kind == LINE_GRAPHICS) {
 		isLine(value);
   	  }
-	  else if(valObj == "\"text\"") {
+	  else if(kind == TEXT_GRAPHICS) {
 		isText(value);
 	  }
 	  else if(value.head().asSymbol() == "List") {
@@ -273,7 +326,7 @@ void NotebookApp::isLine(Expression exp)
 	for (auto e = exp.tailConstBegin(); e != exp.tailConstEnd(); ++e) {
 		Expression p = (*e);
 		if(error != true) {
-			if(p.objName() == "\"point\"") {
+			if(p.graphicsKind() == POINT_GRAPHICS) {
 				if(p.pointSize() >= 0){
 					for (auto ee = (*e).tailConstBegin(); ee != (*e).tailConstEnd(); ++ee) {
 						coords.push_back((*ee).head().asNumber());
@@ -315,8 +368,7 @@ void NotebookApp::isText(Expression exp)
 	Expression point;
 	point = exp.textPos();
 	
-	std::string valObj = point.objName();
-    if(valObj == "\"point\"") {
+    if(point.graphicsKind() == POINT_GRAPHICS) {
   	  
 	  QList<double> coord;
 	  for (auto e = point.tailConstBegin(); e != point.tailConstEnd(); ++e) {
@@ -334,4 +386,25 @@ void NotebookApp::isText(Expression exp)
     }
 	else
 		emit changedError("Error: position not a point.");
+}
+
+void NotebookApp::isPlot(const PlotBuffer & plot)
+{
+	// plots are drawn straight from their arrays, in drawing order
+	std::size_t point = 0, line = 0, text = 0;
+	for (PlotPrimitive kind : plot.order) {
+		if (kind == PLOT_POINT) {
+			emit changedPoint(plot.point_x[point], plot.point_y[point], plot.point_size[point]);
+			++point;
+		}
+		else if (kind == PLOT_LINE) {
+			emit changedLine(plot.line_thickness[line], plot.line_x1[line], plot.line_y1[line], plot.line_x2[line], plot.line_y2[line]);
+			++line;
+		}
+		else {
+			// as isText prints a text expression, "(" "\"" string "\"" ")"
+			emit changedText(plot.text_x[text], plot.text_y[text], QString::fromStdString("(" + plot.text[text] + ")"), plot.text_scale[text], plot.text_rotation[text]);
+			++text;
+		}
+	}
 }
\ No newline at end of file
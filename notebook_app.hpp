@@ -8,9 +8,13 @@
 #include "startup_config.hpp"
 #include "message_queue.hpp"
 #include "consumer.hpp"
+#include "plot_buffer.hpp"
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <thread>
-#include <chrono>
+#include <vector>
 
 #include <QWidget>
 #include <QEventLoop>
@@ -18,7 +22,6 @@
 class InputWidget;
 class OutputWidget;
 class QPushButton;
-class QTimer;
 
 class NotebookApp : public QWidget{
     Q_OBJECT
@@ -33,10 +36,14 @@ public:
 	void isPoint(Expression exp);
 	void isLine(Expression exp);
 	void isText(Expression exp);
+	void isPlot(const PlotBuffer & plot);
+	
+	/// true while a result is pending
+	bool isBusy() const { return busy; }
 	
 public slots:
 	void eval(QString line);
-	void loop();
+	void showResults();
 	void Start();
     void Stop();
     void Reset();
@@ -51,6 +58,7 @@ signals:
 	void changedLine(double thickness, double x1, double y1, double x2, double y2);
 	void changedText(double x, double y, QString text, double scale, double rotation);
 	void changedDiscrete(QList<QGraphicsEllipseItem *> points, QList<QGraphicsLineItem *> lines, QList<QGraphicsTextItem *> labels);
+	/// emitted when the output of an input has been shown
 	void finishEval();
 	
 	
@@ -61,15 +69,37 @@ private:
     QPushButton * stop;
     QPushButton * reset;
     QPushButton * interrupt;
-	QTimer * timer;
-	
-	Interpreter interp;
-	inputQueue inQ;
-    outputQueue outQ;
-	Consumer *c1;
-	std::thread *consumer_thread;
+
+	// an interpreter kernel thread with its own queues, so one that is
+	// reset while busy is left to stop by itself off the GUI thread
+	struct Kernel {
+		Interpreter interp;
+		inputQueue inQ;
+		outputQueue outQ;
+		// the kernel stops the requests up to this id
+		std::atomic<std::uint64_t> interrupted;
+		// set by the kernel thread as it ends
+		std::atomic<bool> finished;
+		bool exitSent = false;
+		std::thread thread;
+
+		Kernel(const KernelQueueOptions & options) :
+			inQ(options.capacity, options.policy), interrupted(0), finished(false) {}
+	};
+
+	// read from the environment when the notebook starts
+	KernelQueueOptions queueOptions;
+
+	std::unique_ptr<Kernel> kernel;
+	// kernels replaced by Reset, until their threads end
+	std::vector<std::unique_ptr<Kernel>> retired;
+	std::uint64_t request = 0;
+	bool busy = false;
 	bool run = true;
-	bool killLoopFlag_;
+
+	void startKernel();
+	void retireKernel();
+	void setBusy(bool value);
 };
 
 #endif // NOTEBOOK_APP_H
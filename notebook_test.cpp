@@ -1,6 +1,8 @@
 #include <QTest>
+#include <QSignalSpy>
 
 #include <QPlainTextEdit>
+#include <QPushButton>
 #include <QGraphicsScene>
 #include <QGraphicsView>
 #include <QGraphicsItem>
@@ -16,6 +18,7 @@ public:
   int findText(QGraphicsScene * scene, QPointF center, qreal rotation, QString contents);
   int findPoints(QGraphicsScene * scene, QPointF center, qreal radius);
   int intersectsLine(QGraphicsScene * scene, QPointF center, qreal radius);
+  void send(InputWidget * in);
 
 private slots:
   void initTestCase();
@@ -32,6 +35,8 @@ private slots:
   void listOutput();
   void discretePlot();
   void continuousPlot();
+  void interruptKernel();
+  void queueStats();
 
 private:
   NotebookApp widget;
@@ -57,7 +62,7 @@ void NotebookTest::errorOutput(){
   auto scene = view->scene();
     
   in->setPlainText("(get-property \"key\" (3))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   auto item = scene->itemAt(QPointF(0, 0), QTransform());
   QGraphicsTextItem * text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -69,7 +74,7 @@ void NotebookTest::errorOutput(){
   in->clear();
   
   in->setPlainText("(begin))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   item = scene->itemAt(QPointF(0, 0), QTransform());
   text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -81,7 +86,7 @@ void NotebookTest::errorOutput(){
   in->clear();
   
   in->setPlainText("(begin (define a I) (first a))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   item = scene->itemAt(QPointF(0, 0), QTransform());
   text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -101,7 +106,7 @@ void NotebookTest::expressionOutput(){
   auto scene = view->scene();
     
   in->setPlainText("(cos pi)");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   auto item = scene->itemAt(QPointF(0, 0), QTransform());
   QGraphicsTextItem * text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -113,7 +118,7 @@ void NotebookTest::expressionOutput(){
   in->clear();
   
   in->setPlainText("(begin (define title \"The Title\") (title))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   item = scene->itemAt(QPointF(0, 0), QTransform());
   text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -133,7 +138,7 @@ void NotebookTest::lambOutput(){
   auto scene = view->scene();
     
   in->setPlainText("(define inc (lambda (x) (+ x 1)))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   QList<QGraphicsItem *> items = scene->items();
   
@@ -150,7 +155,7 @@ void NotebookTest::pointOutput(){
   auto scene = view->scene();
   
   in->setPlainText("(make-point 0 0)");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   QList<QGraphicsItem *> items = scene->items();
   
@@ -168,7 +173,7 @@ void NotebookTest::pointOutput(){
   in->clear();
   
   in->setPlainText("(set-property \"size\" 20 (make-point 0 0))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   items.clear();
   items = scene->items();
@@ -195,7 +200,7 @@ void NotebookTest::pointChecks(){
   auto scene = view->scene();
     
   in->setPlainText("(set-property \"size\" -2 (make-point 0 0))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   auto item = scene->itemAt(QPointF(0, 0), QTransform());
   QGraphicsTextItem * text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -215,7 +220,7 @@ void NotebookTest::lineOutput(){
   auto scene = view->scene();
   
   in->setPlainText("(make-line (make-point 0 0) (make-point 20 20))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   QList<QGraphicsItem *> items = scene->items();
   
@@ -231,7 +236,7 @@ void NotebookTest::lineOutput(){
   in->clear();
   
   in->setPlainText("(set-property \"thickness\" (4) (make-line (make-point 0 0) (make-point 20 20)))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   items.clear();
   items = scene->items();
@@ -256,7 +261,7 @@ void NotebookTest::lineChecks(){
   auto scene = view->scene();
     
   in->setPlainText("(make-line (set-property \"size\" -3 (make-point 0 0)) (make-point 20 20))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   auto item = scene->itemAt(QPointF(0, 0), QTransform());
   QGraphicsTextItem * text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -268,7 +273,7 @@ void NotebookTest::lineChecks(){
   in->clear();
   
   in->setPlainText("(make-line 5 4)");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   item = scene->itemAt(QPointF(0, 0), QTransform());
   text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -280,7 +285,7 @@ void NotebookTest::lineChecks(){
   in->clear();
   
   in->setPlainText("(set-property \"thickness\" (-4) (make-line (make-point 0 0) (make-point 20 20)))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   item = scene->itemAt(QPointF(0, 0), QTransform());
   text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -300,7 +305,7 @@ void NotebookTest::textOutput(){
   auto scene = view->scene();
     
   in->setPlainText("(make-text \"Hello World!\")");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
    
   auto item = scene->itemAt(QPointF(0, 0), QTransform());
   QGraphicsTextItem * text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -316,7 +321,7 @@ void NotebookTest::textOutput(){
   in->clear();
   
   in->setPlainText("(set-property \"scale\" (3) (set-property \"rotation\" (1) (make-text \"Hello World!\")))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
    
   item = scene->itemAt(QPointF(0, 0), QTransform());
   text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -342,7 +347,7 @@ void NotebookTest::textChecks(){
   auto scene = view->scene();
     
   in->setPlainText("(set-property \"position\" (set-property \"size\" -20 (make-point 0 0)) (make-text \"Hi\"))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   auto item = scene->itemAt(QPointF(0, 0), QTransform());
   QGraphicsTextItem * text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -354,7 +359,7 @@ void NotebookTest::textChecks(){
   in->clear();
   
   in->setPlainText("(set-property \"position\" (0) (make-text \"Hi\"))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   item = scene->itemAt(QPointF(0, 0), QTransform());
   text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
@@ -372,7 +377,7 @@ void NotebookTest::listOutput(){
   auto scene = view->scene();
     
   in->setPlainText("(list (set-property \"size\" 1 (make-point 0 0)) (set-property \"size\" 2 (make-point 4 0)) (set-property \"size\" 4 (make-point 8 0)) (set-property \"size\" 8 (make-point 16 0)) (set-property \"size\" 16 (make-point 32 0)) (set-property \"size\" 32 (make-point 64 0)))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   QList<QGraphicsItem *> items = scene->items();
   
@@ -413,7 +418,7 @@ void NotebookTest::listOutput(){
   in->clear();
   
   in->setPlainText("(list (make-line (make-point 0 0) (make-point 0 20)) (make-line (make-point 10 0) (make-point 10 20)) (make-line (make-point 20 0) (make-point 20 20)))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   items.clear();
   items = scene->items();
@@ -442,7 +447,7 @@ void NotebookTest::listOutput(){
   in->clear();
   
   in->setPlainText("(begin (define xloc 0) (define yloc 0) (list (set-property \"position\" (make-point (+ xloc 20) yloc) (make-text \"Hi\")) (set-property \"position\" (make-point (+ xloc 40) yloc) (make-text \"Hi\")) (set-property \"position\" (make-point (+ xloc 60) yloc) (make-text \"Hi\")) (set-property \"position\" (make-point (+ xloc 80) yloc) (make-text \"Hi\")) (set-property \"position\" (make-point (+ xloc 100) yloc) (make-text \"Hi\"))))");
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   items.clear();
   items = scene->items();
@@ -501,7 +506,7 @@ void NotebookTest::discretePlot(){
 		  )";
   
   in->setPlainText(QString::fromStdString(program));
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   // first check total number of items
   // 8 lines + 2 points + 7 text = 17
@@ -579,7 +584,7 @@ void NotebookTest::continuousPlot(){
   std::string program = R"((begin (define j (lambda (x) (+ (* 2 x) 1))) (continuous-plot j (list -2 2) (list (list "title" "The linear function y=2x+1") (list "abscissa-label" "x") (list "ordinate-label" "y") (list "text-scale" 2)))))";
   
   in->setPlainText(QString::fromStdString(program));
-  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  send(in);
   
   auto items = scene->items();
   
@@ -638,6 +643,94 @@ void NotebookTest::continuousPlot(){
   QCOMPARE(findLines(scene, QRectF(0, -ymax, 0, 20), 0.1), 1);
 }
 
+void NotebookTest::interruptKernel(){
+  auto in = widget.findChild<InputWidget *>("input");
+  auto out = widget.findChild<OutputWidget *>("output");
+  auto interrupt = widget.findChild<QPushButton *>("interrupt");
+  auto reset = widget.findChild<QPushButton *>("reset");
+
+  auto view = out->findChild<QGraphicsView *>();
+  auto scene = view->scene();
+
+  // a request that would run for minutes
+  QString busy = "(begin (define g (lambda (y) (* y y))) (define f (lambda (x) (length (map g (range 0 1000 1)))))"
+    " (map f (range 0 100000 1)))";
+
+  in->setPlainText("(define kept 1)");
+  send(in);
+  in->clear();
+
+  // interrupting shows the error at once and keeps the environment
+  in->setPlainText(busy);
+  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  QVERIFY(widget.isBusy());
+  QTest::mouseClick(interrupt, Qt::LeftButton);
+  QVERIFY(!widget.isBusy());
+
+  auto item = scene->itemAt(QPointF(0, 0), QTransform());
+  QGraphicsTextItem * text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
+  QCOMPARE(text->toPlainText(), QString("Error: interpreter kernel interrupted"));
+  in->clear();
+
+  in->setPlainText("(+ kept 1)");
+  send(in);
+  item = scene->itemAt(QPointF(0, 0), QTransform());
+  text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
+  QCOMPARE(text->toPlainText(), QString("(2)"));
+  in->clear();
+
+  // resetting does not wait for the busy kernel, and the new one starts
+  // from the startup environment
+  in->setPlainText(busy);
+  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  QVERIFY(widget.isBusy());
+  QTest::mouseClick(reset, Qt::LeftButton);
+  QVERIFY(!widget.isBusy());
+  in->clear();
+
+  in->setPlainText("(+ kept 1)");
+  send(in);
+  item = scene->itemAt(QPointF(0, 0), QTransform());
+  text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
+  QCOMPARE(text->toPlainText(), QString("Error during evaluation: unknown symbol"));
+  in->clear();
+}
+
+void NotebookTest::queueStats(){
+  auto in = widget.findChild<InputWidget *>("input");
+  auto out = widget.findChild<OutputWidget *>("output");
+
+  auto view = out->findChild<QGraphicsView *>();
+  auto scene = view->scene();
+
+  in->setPlainText("%stats");
+  send(in);
+
+  auto item = scene->itemAt(QPointF(0, 0), QTransform());
+  QGraphicsTextItem * text = qgraphicsitem_cast<QGraphicsTextItem *>(item);
+  QStringList lines = text->toPlainText().split("\n");
+
+  QCOMPARE(lines.size(), 2);
+  QVERIFY(lines[0].startsWith("input queue: depth 0/1024, "));
+  QVERIFY(lines[1].startsWith("output queue: depth 0"));
+
+  in->clear();
+}
+
+/* 
+send - send the input with Shift-Enter and wait for the kernel result
+       to be shown, evaluation is asynchronous
+ */
+void NotebookTest::send(InputWidget * in){
+
+  QSignalSpy shown(&widget, SIGNAL(finishEval()));
+  QTest::keyRelease(in, Qt::Key_Return, Qt::ShiftModifier, 10);
+  if(shown.count() == 0){
+    QVERIFY(shown.wait(10000));
+  }
+  QVERIFY(!widget.isBusy());
+}
+
 /* 
 findText - find text in a scene centered at a specified point with a given 
            rotation and string contents  
@@ -1,99 +1,236 @@
 #include "parse.hpp"
 
+#include <cctype>
 #include <stack>
 
-bool setHead(Expression &exp, const Token &token) {
-
-  Atom a(token);
+bool setHead(Expression &exp, const Atom &a) {
 
   exp.head() = a;
 
   return !a.isNone();
 }
 
-bool append(Expression *exp, const Token &token) {
-
-  Atom a(token);
+bool append(Expression *exp, const Atom &a) {
 
   exp->append(a);
 
   return !a.isNone();
 }
 
-Expression parse(const TokenSequenceType &tokens) noexcept {
+namespace {
 
-  Expression ast;
+// Builds the AST one token at a time. Shared by the token sequence parser
+// and the buffer reader so both accept exactly the same inputs.
+class AstBuilder {
+public:
+  AstBuilder() : athead(false), inDelim(false), done(false) {}
 
-  // cannot parse empty
-  if (tokens.empty())
+  // each returns false as soon as the input is known to be invalid
+  bool open() {
+    if (done)
+      return false;
+    athead = true;
+    return true;
+  }
+
+  bool close() {
+    if (done || stack.empty() || inDelim)
+      return false;
+    stack.pop();
+
+    // the outermost expression is complete, nothing may follow it
+    if (stack.empty())
+      done = true;
+    return true;
+  }
+
+  bool delim() {
+    if (done)
+      return false;
+    inDelim = !inDelim;
+    return true;
+  }
+
+  bool atom(const Atom &a) {
+    if (done)
+      return false;
+
+    if (athead) {
+      if (stack.empty()) {
+        if (!setHead(ast, a))
+          return false;
+        stack.push(&ast);
+      } else {
+        if (!append(stack.top(), a))
+          return false;
+        stack.push(stack.top()->tail());
+      }
+      athead = false;
+    } else {
+      if (stack.empty())
+        return false;
+      if (!append(stack.top(), a))
+        return false;
+    }
+    return true;
+  }
+
+  bool feed(const Token &t) {
+    switch (t.type()) {
+    case Token::OPEN:
+      return open();
+    case Token::CLOSE:
+      return close();
+    case Token::STRING_DELIM:
+      return delim();
+    default:
+      return atom(Atom(t));
+    }
+  }
+
+  // the atom is built from the slice, without copying it into a Token
+  bool feed(const TokenSlice &t) {
+    switch (t.type) {
+    case Token::OPEN:
+      return open();
+    case Token::CLOSE:
+      return close();
+    case Token::STRING_DELIM:
+      return delim();
+    default:
+      return atom(Atom(t));
+    }
+  }
+
+  // the finished expression, or the None Expression if it is incomplete
+  Expression finish() {
+    if (stack.empty())
+      return ast;
     return Expression();
+  }
 
-  bool athead = false;
-  bool inDelim = false;
+private:
+  Expression ast;
+  bool athead;
+  bool inDelim;
+  bool done;
 
   // stack tracks the last node created
   std::stack<Expression *> stack;
+};
+
+} // namespace
+
+Expression parse(const TokenSequenceType &tokens) noexcept {
+
+  // cannot parse empty
+  if (tokens.empty())
+    return Expression();
 
-  std::size_t num_tokens_seen = 0;
+  AstBuilder builder;
 
   for (auto &t : tokens) {
+    if (!builder.feed(t))
+      return Expression();
+  }
+
+  return builder.finish();
+};
+
+Expression parse(const char *data, std::size_t size) noexcept {
+
+  AstBuilder builder;
+
+  TokenScanner scanner(data, data + size);
+  TokenSlice t;
+  while (scanner.next(t)) {
+    if (!builder.feed(t))
+      return Expression();
+  }
+
+  return builder.finish();
+}
+
+Expression parse(std::istream &stream) noexcept {
+
+  AstBuilder builder;
 
-    if (t.type() == Token::OPEN) {
-      athead = true;
-    } 
-	else if (t.type() == Token::CLOSE) {
-      if (stack.empty() || inDelim) {
+  // only one chunk of the text is held at a time, the scanner keeps the
+  // part of a token that continues into the next chunk
+  char chunk[1 << 16];
+  TokenScanner scanner(chunk, chunk, false);
+  bool last = false;
+  TokenSlice t;
+  while (true) {
+    if (scanner.next(t)) {
+      if (!builder.feed(t))
         return Expression();
-      }
-      stack.pop();
+    } else if (last) {
+      break;
+    } else {
+      stream.read(chunk, sizeof(chunk));
+      last = !stream;
+      scanner.resume(chunk, chunk + stream.gcount(), last);
+    }
+  }
 
-      if (stack.empty()) {
-        num_tokens_seen += 1;
-        break;
-      }
-    } 
-	else if (t.type() == Token::STRING_DELIM) {
-	  if (!inDelim)
-		inDelim = true;
-	  else
-		inDelim = false;
-	}
-	else {
-
-	  if (athead) {
-        if (stack.empty()) {
-
-		  if (!setHead(ast, t)) {
-            return Expression();
-          }
-          stack.push(&ast);
-        } else {
-          if (stack.empty()) {
-            return Expression();
-          }
-
-		  if (!append(stack.top(), t)) {
-            return Expression();
-          }
-          stack.push(stack.top()->tail());
-        }
-        athead = false;
-      } else {
-        if (stack.empty()) {
-          return Expression();
-        }
+  return builder.finish();
+}
+
+FormReader::FormReader(std::istream &stream)
+    : m_stream(stream), m_buffer(1 << 16), m_pos(0), m_end(0) {}
+
+bool FormReader::fill() {
+
+  m_pos = 0;
+  m_end = 0;
+  if (m_stream) {
+    m_stream.read(m_buffer.data(), m_buffer.size());
+    m_end = static_cast<std::size_t>(m_stream.gcount());
+  }
+  return m_end > 0;
+}
+
+bool FormReader::next(std::string &form) {
 
-		if (!append(stack.top(), t)) {
-          return Expression();
+  form.clear();
+
+  int depth = 0;
+  bool incomment = false;
+  bool started = false;
+
+  while (m_pos != m_end || fill()) {
+
+    std::size_t begin = m_pos;
+    bool complete = false;
+
+    for (; m_pos != m_end; ++m_pos) {
+      char c = m_buffer[m_pos];
+
+      if (incomment) {
+        incomment = (c != '\n');
+      } else if (c == ';') {
+        incomment = true;
+      } else if (c == '(') {
+        started = true;
+        ++depth;
+      } else if (c == ')') {
+        started = true;
+        if (--depth <= 0) {
+          ++m_pos;
+          complete = true;
+          break;
         }
+      } else if (!std::isspace(static_cast<unsigned char>(c))) {
+        started = true;
       }
     }
-    num_tokens_seen += 1;
-  }
 
-  if (stack.empty() && (num_tokens_seen == tokens.size())) {
-    return ast;
+    form.append(m_buffer.data() + begin, m_pos - begin);
+    if (complete)
+      return true;
   }
 
-  return Expression();
-};
+  // at the end of the input, anything left over is an (invalid) partial form
+  return started;
+}
@@ -4,6 +4,11 @@ Defines the parse function.
 #ifndef PARSE_HPP
 #define PARSE_HPP
 
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
 #include "token.hpp"
 #include "expression.hpp"
 
@@ -15,4 +20,61 @@ Defines the parse function.
  */
 Expression parse(const TokenSequenceType & tokens) noexcept;
 
+/*! \fn parse
+\brief read an expression (abstract syntax tree) directly from characters
+
+Tokenizes and parses in a single pass, building the tree while scanning
+without materializing the token sequence. Accepts and rejects exactly the
+same inputs as tokenize followed by parse.
+
+\param data the first character of the input
+\param size the number of characters in the input
+\returns the expression resulting from parsing or the None Expression on failure
+ */
+Expression parse(const char * data, std::size_t size) noexcept;
+
+/*! \fn parse
+\brief read an expression (abstract syntax tree) directly from a stream
+
+As parse(const char *, std::size_t), reading the stream in chunks, so the
+text is never held in memory as a whole. Reading stops at the first
+token that makes the input invalid.
+
+\param stream the input character stream
+\returns the expression resulting from parsing or the None Expression on failure
+ */
+Expression parse(std::istream & stream) noexcept;
+
+/*! \class FormReader
+\brief Splits a stream into its top-level forms.
+
+Reads the stream in chunks and returns the text of one top-level form at a
+time, so a program of many forms can be parsed and evaluated without
+holding all of it in memory. A form ends at the close paren that balances
+its first open paren; comments are skipped when counting parens. The form
+text is not validated, that is left to parse.
+*/
+class FormReader {
+public:
+
+  /// read forms from stream, which must outlive the reader
+  FormReader(std::istream & stream);
+
+  /*! Read the next top-level form
+    \param form set to the text of the form
+    \return false once only whitespace and comments remain
+   */
+  bool next(std::string & form);
+
+private:
+  std::istream & m_stream;
+
+  // characters read from the stream but not yet consumed
+  std::vector<char> m_buffer;
+  std::size_t m_pos;
+  std::size_t m_end;
+
+  bool fill();
+};
+
 #endif
@@ -57,3 +57,145 @@ TEST_CASE( "Test empty parens", "[parse]" ) {
   REQUIRE(parse(tokens) == Expression());
 }
 
+
+TEST_CASE( "Test buffer reader agrees with parser", "[parse]" ) {
+
+  std::vector<std::string> programs = {
+    "(begin (define r 10) (* pi (* r r)))",
+    "(+ 1 2) (+ 3 4)",
+    "(1abc)",
+    "(a",
+    "a)",
+    "()",
+    "b",
+    "",
+    "; nothing",
+    "(((f 1)))",
+    "(make-text \"a string\")",
+    "(make-text \"a (string)\")",
+    "(list \"a\" b \"c\")",
+    "(f \"unterminated)",
+    "(+ 1\n;comment\n2)",
+  };
+
+  for(auto & program : programs){
+    std::istringstream iss(program);
+    Expression expected = parse(tokenize(iss));
+    Expression exp = parse(program.data(), program.size());
+
+    INFO(program);
+    REQUIRE(exp == expected);
+
+    std::istringstream stream(program);
+    REQUIRE(parse(stream) == expected);
+  }
+}
+
+TEST_CASE( "Test stream reader with tokens spanning reads", "[parse]" ) {
+
+  // the stream is read in chunks of 64k characters, each of these is
+  // placed to cross from one chunk into the next
+  std::vector<std::string> pieces = {
+    " 12345 ",
+    " symbol ",
+    " ; a comment (\n",
+    " ab;note\ncd ",
+    " \"a string\" ",
+    " \"a (string)\" ",
+    " 1 ) ",
+  };
+
+  for(auto & piece : pieces){
+    for(std::size_t offset = 1; offset < piece.size(); ++offset){
+      std::string program = "(list";
+      program.resize((1 << 16) - offset, ' ');
+      program += piece + " 2)";
+
+      std::istringstream iss(program);
+      Expression expected = parse(tokenize(iss));
+      std::istringstream stream(program);
+
+      INFO(piece << " at " << offset);
+      REQUIRE(parse(stream) == expected);
+    }
+  }
+
+  {
+    INFO("a large literal");
+    std::string list = "(list";
+    for(int i = 0; i < 100000; ++i) list += " 1.5 a";
+    list += ")";
+
+    std::istringstream iss(list);
+    Expression expected = parse(tokenize(iss));
+    REQUIRE(expected != Expression());
+    std::istringstream stream(list);
+    REQUIRE(parse(stream) == expected);
+  }
+}
+
+TEST_CASE( "Test reading top-level forms", "[parse]" ) {
+
+  std::string program = "(define a 1) ; a comment (with parens\n"
+                        "(define s \"a string\")\n"
+                        "\n(+ a\n  ; )\n  2)  ; trailing comment";
+
+  std::istringstream iss(program);
+  FormReader reader(iss);
+  std::string form;
+
+  std::vector<std::string> forms;
+  while(reader.next(form)){
+    forms.push_back(form);
+    REQUIRE(parse(form.data(), form.size()) != Expression());
+  }
+
+  REQUIRE(forms.size() == 3);
+  REQUIRE(forms[0] == "(define a 1)");
+  REQUIRE(forms[1] == " ; a comment (with parens\n(define s \"a string\")");
+  REQUIRE(forms[2] == "\n\n(+ a\n  ; )\n  2)");
+}
+
+TEST_CASE( "Test reading invalid and large top-level forms", "[parse]" ) {
+
+  {
+    INFO("trailing atom");
+    std::istringstream iss("(+ 1 2) 3 ");
+    FormReader reader(iss);
+    std::string form;
+
+    REQUIRE(reader.next(form));
+    REQUIRE(reader.next(form));
+    REQUIRE(parse(form.data(), form.size()) == Expression());
+    REQUIRE(!reader.next(form));
+  }
+
+  {
+    INFO("stray close");
+    std::istringstream iss(") (+ 1 2)");
+    FormReader reader(iss);
+    std::string form;
+
+    REQUIRE(reader.next(form));
+    REQUIRE(form == ")");
+    REQUIRE(reader.next(form));
+    REQUIRE(form == " (+ 1 2)");
+  }
+
+  {
+    INFO("forms spanning several reads");
+    std::string list = "(list";
+    for(int i = 0; i < 50000; ++i) list += " 1";
+    list += ")";
+
+    std::istringstream iss(list + list);
+    FormReader reader(iss);
+    std::string form;
+
+    REQUIRE(reader.next(form));
+    REQUIRE(form == list);
+    REQUIRE(reader.next(form));
+    REQUIRE(form == list);
+    REQUIRE(!reader.next(form));
+  }
+}
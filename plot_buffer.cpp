@@ -0,0 +1,39 @@
+#include "plot_buffer.hpp"
+
+void PlotBuffer::add_point(double x, double y, double size){
+
+  order.push_back(PLOT_POINT);
+  point_x.push_back(x);
+  point_y.push_back(y);
+  point_size.push_back(size);
+}
+
+void PlotBuffer::add_line(double x1, double y1, double x2, double y2, double thickness){
+
+  order.push_back(PLOT_LINE);
+  line_x1.push_back(x1);
+  line_y1.push_back(y1);
+  line_x2.push_back(x2);
+  line_y2.push_back(y2);
+  line_thickness.push_back(thickness);
+}
+
+void PlotBuffer::add_text(double x, double y, const std::string & value, double scale, double rotation){
+
+  order.push_back(PLOT_TEXT);
+  text.push_back(value);
+  text_x.push_back(x);
+  text_y.push_back(y);
+  text_scale.push_back(scale);
+  text_rotation.push_back(rotation);
+}
+
+bool PlotBuffer::operator==(const PlotBuffer & other) const noexcept{
+
+  return order == other.order &&
+    point_x == other.point_x && point_y == other.point_y && point_size == other.point_size &&
+    line_x1 == other.line_x1 && line_y1 == other.line_y1 &&
+    line_x2 == other.line_x2 && line_y2 == other.line_y2 && line_thickness == other.line_thickness &&
+    text == other.text && text_x == other.text_x && text_y == other.text_y &&
+    text_scale == other.text_scale && text_rotation == other.text_rotation;
+}
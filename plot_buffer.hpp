@@ -0,0 +1,62 @@
+/*! \file plot_buffer.hpp
+Defines the PlotBuffer, the value of discrete-plot and continuous-plot.
+
+A plot is thousands of points, lines and texts. Rather than an Expression
+for each, with its properties in a map, a PlotBuffer keeps each kind of
+primitive in parallel arrays and the drawing order in one byte per
+primitive. It is immutable once made and shared between the copies of
+the Expression holding it, so plots are cheap to define, copy and pass to
+the notebook. Scripts see a plot as the list of graphic primitives it
+stands for (see Expression::expanded).
+ */
+#ifndef PLOT_BUFFER_HPP
+#define PLOT_BUFFER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// the kinds of graphic primitive in a plot
+enum PlotPrimitive : unsigned char {
+  PLOT_POINT, ///< a point, drawn with a size
+  PLOT_LINE,  ///< a line between two points, drawn with a thickness
+  PLOT_TEXT   ///< a string at a position, drawn with a scale and rotation
+};
+
+/*! \struct PlotBuffer
+\brief The graphic primitives of a plot, by kind in parallel arrays
+
+The i-th point, line or text is the i-th element of each of the arrays of
+its kind. Line ends and text positions are points of size 0.
+*/
+struct PlotBuffer {
+  /// the kind of each primitive in drawing order
+  std::vector<PlotPrimitive> order;
+
+  /// the points
+  std::vector<double> point_x, point_y, point_size;
+
+  /// the lines
+  std::vector<double> line_x1, line_y1, line_x2, line_y2, line_thickness;
+
+  /// the texts, each a quoted string symbol
+  std::vector<std::string> text;
+  std::vector<double> text_x, text_y, text_scale, text_rotation;
+
+  /// append a point
+  void add_point(double x, double y, double size);
+
+  /// append a line
+  void add_line(double x1, double y1, double x2, double y2, double thickness);
+
+  /// append a text
+  void add_text(double x, double y, const std::string & value, double scale, double rotation);
+
+  /// the number of primitives
+  std::size_t size() const noexcept { return order.size(); }
+
+  /// the same primitives in the same order
+  bool operator==(const PlotBuffer & other) const noexcept;
+};
+
+#endif
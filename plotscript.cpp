@@ -1,19 +1,34 @@
+#include <atomic>
+#include <functional>
 #include <string>
+#include <vector>
 #include <sstream>
 #include <iostream>
 #include <fstream>
 #include <thread>
 #include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <utility>
 
 #include "interpreter.hpp"
+#include "parse.hpp"
+#include "script_file.hpp"
+#include "script_cache.hpp"
 #include "semantic_error.hpp"
-#include "startup_config.hpp"
 #include "message_queue.hpp"
 #include "consumer.hpp"
+#include "server.hpp"
+#include "batch.hpp"
+#include "forked_kernel.hpp"
 #include "cntlc_tracer.cpp"
 
-typedef message_queue<std::string> inputQueue;
-typedef message_queue<Expression> outputQueue;
+#if defined(_WIN64) || defined(_WIN32)
+#include <io.h>
+#endif
+
 
 void prompt(){
   std::cout << "\nplotscript> ";
@@ -26,6 +41,15 @@ std::string readline(){
   return line;
 }
 
+// whether standard input is a terminal, rather than a pipe or file
+bool interactive_input(){
+#if defined(_WIN64) || defined(_WIN32)
+  return _isatty(_fileno(stdin)) != 0;
+#else
+  return isatty(STDIN_FILENO) != 0;
+#endif
+}
+
 void error(const std::string & err_str){
   std::cerr << "Error: " << err_str << std::endl;
 }
@@ -34,48 +58,150 @@ void info(const std::string & err_str){
   std::cout << "Info: " << err_str << std::endl;
 }
 
-int eval_from_stream(std::istream & stream){
+// parse a program into interp; compiled scripts are loaded as they are,
+// source programs go through the cache of compiled scripts
+bool parse_program(Interpreter & interp, const char * data, std::size_t size, ScriptCache & cache){
 
-  std::ifstream ifs(STARTUP_FILE);
-  
-  if(!ifs){
-    error("Could not open file for reading.");
+  if(is_compiled(data, size)){
+    SourceDigest source;
+    return interp.parseCompiled(data, size, source);
   }
-  
+
+  return cache.parse(interp, data, size);
+}
+
+// replace the environment of interp by the startup environment
+void load_startup(Interpreter & interp){
+
+  try{
+    switch(interp.startup()){
+    case Interpreter::STARTUP_UNREADABLE:
+      error("Could not open file for reading.");
+      break;
+    case Interpreter::STARTUP_UNPARSABLE:
+      error("Invalid Program. Could not parse.");
+      break;
+    default:
+      break;
+    }
+  }
+  catch(const SemanticError & ex){
+    std::cerr << ex.what() << std::endl;
+  }
+}
+
+int eval_from_buffer(const char * data, std::size_t size, ScriptCache & cache){
+
   Interpreter interp;
+  load_startup(interp);
   
-  if(!interp.parseStream(ifs)){
+  if(!parse_program(interp, data, size, cache)){
     error("Invalid Program. Could not parse.");
+    return EXIT_FAILURE;
   }
   else{
     try{
       Expression exp = interp.evaluate();
+      std::cout << exp << std::endl;
     }
     catch(const SemanticError & ex){
       std::cerr << ex.what() << std::endl;
+      return EXIT_FAILURE;
     }	
   }
+
+  return EXIT_SUCCESS;
+}
+
+// evaluate a file, or standard input if filename is "-"
+int eval_from_file(std::string filename){
+      
+  ScriptFile file;
+
+  if(filename == "-"){
+    file.read(std::cin);
+  }
+  else if(!file.open(filename)){
+    error("Could not open file for reading.");
+    return EXIT_FAILURE;
+  }
   
-  if(!interp.parseStream(stream)){
+  ScriptCache cache;
+  return eval_from_buffer(file.data(), file.size(), cache);
+}
+
+// write the compiled form of the program in file input to file output
+int compile_file(std::string input, std::string output){
+
+  ScriptFile file;
+
+  if(!file.open(input)){
+    error("Could not open file for reading.");
+    return EXIT_FAILURE;
+  }
+
+  Interpreter interp;
+
+  if(!interp.parseBuffer(file.data(), file.size())){
     error("Invalid Program. Could not parse.");
     return EXIT_FAILURE;
   }
-  else{
+
+  std::ofstream ofs(output, std::ios::binary);
+  interp.writeCompiled(ofs, source_digest(file.data(), file.size()));
+
+  if(!ofs){
+    error("Could not write compiled program.");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// Evaluate a program of any number of top-level forms, one form at a
+// time, printing the result of the last. Memory use is bounded by the
+// largest single form rather than the whole program.
+int eval_forms_from_stream(std::istream & stream){
+
+  Interpreter interp;
+  load_startup(interp);
+
+  FormReader reader(stream);
+  std::string form;
+  Expression exp;
+  bool empty = true;
+
+  while(reader.next(form)){
+    if(!interp.parseBuffer(form.data(), form.size())){
+      error("Invalid Program. Could not parse.");
+      return EXIT_FAILURE;
+    }
     try{
-      Expression exp = interp.evaluate();
-      std::cout << exp << std::endl;
+      exp = interp.evaluate();
     }
     catch(const SemanticError & ex){
       std::cerr << ex.what() << std::endl;
       return EXIT_FAILURE;
-    }	
+    }
+    empty = false;
   }
 
+  if(empty){
+    error("Invalid Program. Could not parse.");
+    return EXIT_FAILURE;
+  }
+
+  std::cout << exp << std::endl;
   return EXIT_SUCCESS;
 }
 
-int eval_from_file(std::string filename){
-      
+// stream the forms of a file, or of standard input if filename is "-"
+int eval_forms_from_file(std::string filename){
+
+  if(filename == "-"){
+    return eval_forms_from_stream(std::cin);
+  }
+
   std::ifstream ifs(filename);
   
   if(!ifs){
@@ -83,64 +209,232 @@ int eval_from_file(std::string filename){
     return EXIT_FAILURE;
   }
   
-  return eval_from_stream(ifs);
+  return eval_forms_from_stream(ifs);
 }
 
 int eval_from_command(std::string argexp){
 
-  std::istringstream expression(argexp);
+  // one-off programs are not worth caching
+  ScriptCache cache("");
+  return eval_from_buffer(argexp.data(), argexp.size(), cache);
+}
 
-  return eval_from_stream(expression);
+// number of worker threads for "-j N", or one per core
+std::size_t parse_jobs(const char * arg){
+
+  int jobs = (arg != nullptr) ? std::atoi(arg) : 0;
+  if(jobs > 0){
+    return static_cast<std::size_t>(jobs);
+  }
+  unsigned cores = std::thread::hardware_concurrency();
+  return (cores > 0) ? cores : 1;
 }
 
-// A REPL is a repeated read-eval-print loop
-void repl(){
-	
-  std::ifstream ifs(STARTUP_FILE);
-  
-  if(!ifs){
-    error("Could not open file for reading.");
+// evaluate the programs named by args (files, @manifests and -j N) and
+// print a line for each: file, ok or error, milliseconds, result
+int eval_batch(int argc, char *argv[]){
+
+  std::vector<std::string> files;
+  const char * jobs = nullptr;
+
+  for(int i = 0; i < argc; ++i){
+    std::string arg(argv[i]);
+    if(arg == "-j" && i + 1 < argc){
+      jobs = argv[++i];
+    }
+    else if(arg.size() > 1 && arg[0] == '@'){
+      if(!read_manifest(arg.substr(1), files)){
+        error("Could not open file for reading.");
+        return EXIT_FAILURE;
+      }
+    }
+    else{
+      files.push_back(arg);
+    }
   }
-   
+
+  // report a bad startup file once, rather than for every program
   Interpreter interp;
-  
-  if(!interp.parseStream(ifs)){
-    error("Invalid Program. Could not parse.");
-  }
-  else{
-    try{
-      Expression exp = interp.evaluate();
+  load_startup(interp);
+
+  ScriptCache cache;
+  std::vector<BatchResult> results = run_batch(files, parse_jobs(jobs), cache);
+
+  int status = EXIT_SUCCESS;
+  for(const BatchResult & result : results){
+    std::cout << result.file << '\t' << (result.ok ? "ok" : "error") << '\t'
+              << result.milliseconds << '\t' << result.output << '\n';
+    if(!result.ok){
+      status = EXIT_FAILURE;
     }
-    catch(const SemanticError & ex){
-      std::cerr << ex.what() << std::endl;
-    }	
   }
+  std::cout << std::flush;
+
+  return status;
+}
+
+// the running server, stopped by SIGINT or SIGTERM
+Server * running_server = nullptr;
+
+void stop_server(int){
+  if(running_server != nullptr){
+    running_server->stop();
+  }
+}
+
+int serve(const std::string & path, std::size_t workers){
+
+  Server server(path, workers);
+
+  std::string message;
+  if(!server.listen(message)){
+    error(message);
+    return EXIT_FAILURE;
+  }
+
+  running_server = &server;
+  std::signal(SIGINT, stop_server);
+  std::signal(SIGTERM, stop_server);
+
+  info("serving on " + path + " with " + std::to_string(workers) + " workers");
+  server.run();
+
+  running_server = nullptr;
+  return EXIT_SUCCESS;
+}
+
+// A REPL is a repeated read-eval-print loop
+void repl(const KernelQueueOptions & options){
+	
+  Interpreter interp;
+  load_startup(interp);
   
-  inputQueue inQ;
+  inputQueue inQ(options.capacity, options.policy);
   outputQueue outQ;
+  std::uint64_t request = 0;
+
+  // Ctrl-C interrupts the kernel through the request waited for
+  std::atomic<std::uint64_t> interrupted(0);
+
+  // how long a wait for a result may delay noticing Ctrl-C
+  const std::chrono::milliseconds interrupt_poll(20);
   
   bool run = true;
   
   Consumer *c1;
-  c1 = new Consumer(&inQ, &outQ, &interp);
+  c1 = new Consumer(&inQ, &outQ, &interp, std::function<void()>(), &interrupted);
   std::thread *consumer_thread;
   consumer_thread = new std::thread(*c1);
   
+  // piped input is not waited for line by line: up to window requests
+  // are in flight and their results are printed in order, each after the
+  // prompt of its line. The window fits both queues, so neither the REPL
+  // nor the kernel blocks on a full one, and none are dropped.
+  const bool piped = !interactive_input();
+  std::size_t window = inQ.stats().capacity;
+  if (outQ.stats().capacity > 0 && outQ.stats().capacity < window) {
+	  window = outQ.stats().capacity;
+  }
+  // the lines not printed yet: the request sent for each, or 0 and the
+  // text to print for it
+  std::deque<std::pair<std::uint64_t, std::string>> unprinted;
+  std::size_t in_flight = 0;
+
+  // Ctrl-C interrupts every request sent so far
+  auto check_interrupt = [&]() {
+	  if (global_status_flag != 0) {
+		  interrupted = request;
+		  global_status_flag = 0;
+	  }
+  };
+
+  // print the lines before the next one waiting for a result
+  auto print_ready = [&unprinted]() {
+	  while (!unprinted.empty() && unprinted.front().first == 0) {
+		  prompt();
+		  std::cout << unprinted.front().second;
+		  unprinted.pop_front();
+	  }
+  };
+
+  // print the result of the oldest request in flight, return false if it
+  // has not arrived and wait is not set
+  auto print_result = [&](bool wait) {
+	  KernelResult result;
+	  bool popped = outQ.try_pop(result);
+	  while (!popped && wait) {
+		  check_interrupt();
+		  popped = outQ.wait_for_and_pop(result, interrupt_poll);
+	  }
+	  if (!popped) return false;
+
+	  // the kernel answers each request once, in order
+	  prompt();
+	  std::cout << result.exp << std::endl;
+	  unprinted.pop_front();
+	  --in_flight;
+	  print_ready();
+	  return true;
+  };
+
   // call the platform-specific code
   install_handler();
 
   while (true) {
 
-	  // reset the status flag
-	  global_status_flag = 0;
+	  if (!piped) {
+		  // reset the status flag
+		  global_status_flag = 0;
 
-	  prompt();
+		  prompt();
+	  }
 
 	  std::string line = readline();
+
+	  if (piped) {
+		  check_interrupt();
+
+		  if (std::cin.fail() && std::ferror(stdin)) {
+			  // a read interrupted by Ctrl-C
+			  std::cin.clear();
+			  std::clearerr(stdin);
+			  continue;
+		  }
+		  else if (std::cin.fail()) {
+			  // the end of the input
+			  line = "%exit";
+		  }
+
+		  if (line.empty()) {
+			  unprinted.push_back({0, ""});
+			  print_ready();
+			  continue;
+		  }
+		  else if (line[0] != '%') {
+			  if (!run) {
+				  unprinted.push_back({0, "Error: interpreter kernel not running\n"});
+			  }
+			  else if (!inQ.push({++request, line})) {
+				  unprinted.push_back({0, "Error: interpreter kernel busy\n"});
+			  }
+			  else {
+				  unprinted.push_back({request, ""});
+				  ++in_flight;
+			  }
+			  print_ready();
+			  while (in_flight >= window) print_result(true);
+			  while (print_result(false)) {}
+			  continue;
+		  }
+
+		  // commands find the kernel idle, as when typed
+		  while (in_flight > 0) print_result(true);
+		  prompt();
+	  }
 	  
 	  if (line == "%exit") {
 		  if(run) {
-			  inQ.push(line);
+			  inQ.push({0, line});
 			  consumer_thread->join();
 			  return;
 		  }
@@ -156,6 +450,12 @@ void repl(){
 
 	  if (line.empty()) continue;
 
+	  if (line == "%stats") {
+		  info(format_stats("input", inQ.stats()));
+		  info(format_stats("output", outQ.stats()));
+		  continue;
+	  }
+
 	  if (!run) {
 		  if (line[0] != '%') {
 			  std::cout << "Error: interpreter kernel not running" << std::endl;
@@ -170,32 +470,30 @@ void repl(){
 			  run = true;
 			  //reset environment
 			  //start thread
-			  Interpreter temp;
-			  interp = temp;
+			  load_startup(interp);
 			  delete c1;
 			  delete consumer_thread;							
-			  c1 = new Consumer(&inQ, &outQ, &interp);
+			  c1 = new Consumer(&inQ, &outQ, &interp, std::function<void()>(), &interrupted);
 			  consumer_thread = new std::thread(*c1);
 		  }
 		  else if (line == "%stop") { run = false; }
 	  }
 	  else {
 		  if (line == "%stop") {
-			  inQ.push(line);
+			  inQ.push({0, line});
 			  consumer_thread->join();
 			  run = false;
 		  }
 		  else if (line == "%reset") {
-			  inQ.push(line);
+			  inQ.push({0, line});
 			  consumer_thread->join();
 			  //reset environment
 			  run = true;
-			  Interpreter temp;
-			  interp = temp;
+			  load_startup(interp);
 			  delete c1;
 			  delete consumer_thread;
 			  //start thread			  
-			  c1 = new Consumer(&inQ, &outQ, &interp);
+			  c1 = new Consumer(&inQ, &outQ, &interp, std::function<void()>(), &interrupted);
 			  consumer_thread = new std::thread(*c1);
 		  }
 		  else if (line == "%start") { run = true; }
@@ -203,45 +501,182 @@ void repl(){
 			  // reset the status flag
 			  global_status_flag = 0;
 
-			  //add line to input queue	
-			  inQ.push(line);
+			  //add line to input queue, tagged with a new request id
+			  if (!inQ.push({++request, line})) {
+				  std::cout << "Error: interpreter kernel busy" << std::endl;
+				  continue;
+			  }
 
 			  Expression exp;
-			  //check output queue for result
-			  while (!outQ.try_pop(exp)) {
-				  if ((global_status_flag > 0)){
-					break;
-				  }
-				  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			  //wait for its result, checking for Ctrl-C between waits
+			  bool done = false;
+			  while (!done && (global_status_flag == 0)) {
+				  done = wait_for_result(outQ, request, exp, interrupt_poll);
 			  }
-			  if(global_status_flag == 0) {
+			  if(done) {
 				std::cout << exp << std::endl;
 			  }
 			  else {
+				// stop evaluating it, its result is discarded when it arrives
+				interrupted = request;
 				std::cout << "Error: interpreter kernel interrupted\n";
-				outQ.try_pop(exp);
 			  }
 		  }
 		}
 	}
 }
 
+// A REPL whose kernel runs in a child process, so %reset and Ctrl-C kill
+// the kernel at once and switch to a warm spare
+int forked_repl(){
+
+  ForkedKernel kernel;
+  if(!kernel.start()){
+	error("Could not start the interpreter kernel.");
+	return EXIT_FAILURE;
+  }
+
+  // how long a wait for a result may delay noticing Ctrl-C
+  const std::chrono::milliseconds interrupt_poll(20);
+
+  bool run = true;
+
+  install_handler();
+
+  while (true) {
+
+	  global_status_flag = 0;
+
+	  prompt();
+
+	  std::string line = readline();
+
+	  if (line == "%exit") {
+		  return EXIT_SUCCESS;
+	  }
+
+	  if (std::cin.fail() || std::cin.eof()) {
+		  std::cin.clear(); // reset cin state
+		  line.clear();
+		  std::cout << "\n";
+	  }
+
+	  if (line.empty()) continue;
+
+	  if (line == "%stop") { run = false; }
+	  else if (line == "%start") { run = true; }
+	  else if (line == "%reset") {
+		  run = true;
+		  if (!kernel.reset()) {
+			  error("Could not start the interpreter kernel.");
+			  return EXIT_FAILURE;
+		  }
+	  }
+	  else if (line[0] == '%') {}
+	  else if (!run) {
+		  std::cout << "Error: interpreter kernel not running" << std::endl;
+	  }
+	  else if (!kernel.send(line)) {
+		  error("Could not start the interpreter kernel.");
+		  return EXIT_FAILURE;
+	  }
+	  else {
+		  Expression exp;
+		  ForkedKernel::Status status = ForkedKernel::KERNEL_TIMEOUT;
+		  while (status == ForkedKernel::KERNEL_TIMEOUT && (global_status_flag == 0)) {
+			  status = kernel.wait(exp, interrupt_poll);
+		  }
+
+		  if (status == ForkedKernel::KERNEL_RESULT) {
+			  std::cout << exp << std::endl;
+		  }
+		  else if (status == ForkedKernel::KERNEL_DIED) {
+			  std::cout << "Error: interpreter kernel died, environment reset\n";
+		  }
+		  else {
+			  // the evaluation is killed, not left running
+			  kernel.reset();
+			  std::cout << "Error: interpreter kernel interrupted, environment reset\n";
+		  }
+	  }
+  }
+}
+
+// run the REPL with the kernel queue options of the environment,
+// overridden by --queue-capacity N and --queue-policy P in args
+int repl_with_options(int argc, char *argv[]){
+
+  KernelQueueOptions options;
+  std::string message;
+  if(!kernel_queue_options_from_env(options, message)){
+	error(message);
+	return EXIT_FAILURE;
+  }
+
+  for(int i = 0; i < argc; ++i){
+	std::string arg(argv[i]);
+	if(arg == "--queue-capacity" && i + 1 < argc){
+	  if(!parse_queue_capacity(argv[++i], options.capacity)){
+		error("--queue-capacity must be a positive number");
+		return EXIT_FAILURE;
+	  }
+	}
+	else if(arg == "--queue-policy" && i + 1 < argc){
+	  if(!parse_overflow_policy(argv[++i], options.policy)){
+		error("--queue-policy must be block, reject or drop-oldest");
+		return EXIT_FAILURE;
+	  }
+	}
+	else{
+	  error("Incorrect number of command line arguments.");
+	  return EXIT_FAILURE;
+	}
+  }
+
+  repl(options);
+  return EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[])
 {	
-  if(argc == 2){
+  if(argc >= 3 && std::string(argv[1]) == "--batch"){
+	return eval_batch(argc - 2, argv + 2);
+  }
+  else if(argc >= 3 && std::string(argv[1]) == "--serve"){
+	if(argc == 3){
+	  return serve(argv[2], parse_jobs(nullptr));
+	}
+	if(argc == 5 && std::string(argv[3]) == "-j"){
+	  return serve(argv[2], parse_jobs(argv[4]));
+	}
+	error("Incorrect number of command line arguments.");
+	return EXIT_FAILURE;
+  }
+  else if(argc == 2 && std::string(argv[1]) == "--forked-kernel"){
+	return forked_repl();
+  }
+  else if(argc >= 3 && std::string(argv[1]).compare(0, 8, "--queue-") == 0){
+	return repl_with_options(argc - 1, argv + 1);
+  }
+  else if(argc == 2){
 	return eval_from_file(argv[1]);
   }
   else if(argc == 3){
 	if(std::string(argv[1]) == "-e"){
 	  return eval_from_command(argv[2]);
 	}
+	else if(std::string(argv[1]) == "--stream"){
+	  return eval_forms_from_file(argv[2]);
+	}
 	else{
 	  error("Incorrect number of command line arguments.");
 	}
   }
+  else if(argc == 4 && std::string(argv[1]) == "--compile"){
+	return compile_file(argv[2], argv[3]);
+  }
   else{
-	repl();
-	return EXIT_SUCCESS;
+	return repl_with_options(0, nullptr);
   }
 	
   return EXIT_SUCCESS;
@@ -0,0 +1,821 @@
+// Microbenchmarks for the plotscript interpreter.
+//
+// Each benchmark is run repeatedly until a minimum wall time has elapsed,
+// the measurement is repeated several times and the median is reported.
+// Heap allocations are counted by replacing the global operator new, so
+// allocs/op and bytes/op cover the interpreter library as well.
+//
+// usage: plotscript_bench [--filter SUBSTR] [--min-time SECONDS]
+//                         [--repetitions N] [--json FILE]
+//        plotscript_bench --script FILE [--runs N]
+//        plotscript_bench --measure OUTFILE COMMAND [ARGS...]
+//
+// The --script form runs a whole program through the Interpreter API (the
+// startup file followed by FILE) and prints the wall time of each run as
+// JSON. The --measure form runs COMMAND and writes its exit status, wall
+// time and peak resident set size to OUTFILE as JSON. Both are used by
+// scripts/bench_corpus.py.
+//
+// With --json - the JSON goes to standard output and the table to standard
+// error, so the output can be piped straight into a JSON reader.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "token.hpp"
+#include "atom.hpp"
+#include "expression.hpp"
+#include "environment.hpp"
+#include "parse.hpp"
+#include "interpreter.hpp"
+#include "consumer.hpp"
+#include "forked_kernel.hpp"
+#include "script_file.hpp"
+#include "semantic_error.hpp"
+#include "startup_config.hpp"
+
+#if defined(__APPLE__) || defined(__linux) || defined(__unix) || defined(__posix)
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define BENCH_HAVE_MEASURE
+#endif
+
+#ifndef BENCH_BUILD_TYPE
+#define BENCH_BUILD_TYPE ""
+#endif
+
+/***********************************************************************
+Allocation counting
+**********************************************************************/
+
+// the replacements below pair malloc with free. if GCC inlines operator
+// delete into code it saw call operator new it warns of a mismatch, so
+// they are kept out of line
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+static std::atomic<unsigned long long> alloc_count(0);
+static std::atomic<unsigned long long> alloc_bytes(0);
+
+void * operator new(std::size_t size){
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+  void * p = std::malloc(size == 0 ? 1 : size);
+  if(p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void * operator new[](std::size_t size){
+  return operator new(size);
+}
+
+BENCH_NOINLINE void operator delete(void * p) noexcept{
+  std::free(p);
+}
+
+BENCH_NOINLINE void operator delete[](void * p) noexcept{
+  std::free(p);
+}
+
+BENCH_NOINLINE void operator delete(void * p, std::size_t) noexcept{
+  std::free(p);
+}
+
+BENCH_NOINLINE void operator delete[](void * p, std::size_t) noexcept{
+  std::free(p);
+}
+
+/***********************************************************************
+Harness
+**********************************************************************/
+
+// the address of each benchmarked result escapes through this volatile
+// pointer, so the optimizer cannot discard the work that produced it
+static const void * volatile sink;
+
+// prevent the optimizer from discarding a benchmarked result
+template<typename T>
+void keep(const T & value){
+  sink = &value;
+  // value is usually a local, do not leave a dangling pointer behind
+  sink = nullptr;
+}
+
+struct BenchResult {
+  std::string name;
+  std::size_t size;
+  unsigned long long iterations;
+  double ns_per_op;
+  double allocs_per_op;
+  double bytes_per_op;
+};
+
+struct BenchOptions {
+  std::string filter;
+  std::string json_file;
+  double min_time = 0.2;
+  int repetitions = 5;
+};
+
+class Bench {
+public:
+  Bench(const BenchOptions & opts):
+    options(opts), table(opts.json_file == "-" ? std::cerr : std::cout) {}
+
+  // run fn repeatedly, record the median of options.repetitions measurements
+  void run(const std::string & name, std::size_t size, const std::function<void()> & fn){
+
+    if(name.find(options.filter) == std::string::npos) return;
+
+    typedef std::chrono::steady_clock clock;
+
+    // warm up and calibrate the number of iterations per measurement
+    unsigned long long iterations = 1;
+    while(true){
+      clock::time_point start = clock::now();
+      for(unsigned long long i = 0; i < iterations; ++i) fn();
+      double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+      if(elapsed >= options.min_time || iterations >= (1ULL << 40)) break;
+      if(elapsed <= 0) iterations *= 10;
+      else iterations = static_cast<unsigned long long>(iterations * std::min(10.0, 1.2*options.min_time/elapsed)) + 1;
+    }
+
+    std::vector<double> times;
+    std::vector<double> allocs;
+    std::vector<double> bytes;
+    for(int r = 0; r < options.repetitions; ++r){
+      unsigned long long count0 = alloc_count.load();
+      unsigned long long bytes0 = alloc_bytes.load();
+      clock::time_point start = clock::now();
+      for(unsigned long long i = 0; i < iterations; ++i) fn();
+      double elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+      times.push_back(elapsed/iterations);
+      allocs.push_back(double(alloc_count.load() - count0)/iterations);
+      bytes.push_back(double(alloc_bytes.load() - bytes0)/iterations);
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.size = size;
+    result.iterations = iterations;
+    result.ns_per_op = median(times);
+    result.allocs_per_op = median(allocs);
+    result.bytes_per_op = median(bytes);
+    results.push_back(result);
+
+    table << std::left << std::setw(28) << name
+              << std::right << std::setw(8) << size
+              << std::setw(16) << std::fixed << std::setprecision(1) << result.ns_per_op
+              << std::setw(14) << std::setprecision(1) << result.allocs_per_op
+              << std::setw(14) << std::setprecision(0) << result.bytes_per_op
+              << std::endl;
+  }
+
+  void header() const{
+    table << std::left << std::setw(28) << "benchmark"
+              << std::right << std::setw(8) << "size"
+              << std::setw(16) << "ns/op"
+              << std::setw(14) << "allocs/op"
+              << std::setw(14) << "bytes/op" << std::endl;
+  }
+
+  // log-log slope of ns/op against size, between the smallest and largest size
+  double scaling(const std::string & name) const{
+    const BenchResult * lo = nullptr;
+    const BenchResult * hi = nullptr;
+    for(auto & r : results){
+      if(r.name != name) continue;
+      if(!lo || r.size < lo->size) lo = &r;
+      if(!hi || r.size > hi->size) hi = &r;
+    }
+    if(!lo || !hi || lo->size == hi->size || lo->ns_per_op <= 0) return 0;
+    return std::log(hi->ns_per_op/lo->ns_per_op)/std::log(double(hi->size)/lo->size);
+  }
+
+  void write_json(std::ostream & stream) const{
+
+    // a fresh stream, not inheriting the fixed precision of the table
+    std::ostringstream out;
+
+    std::time_t now = std::time(nullptr);
+    char date[64];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"build_type\": \"" << BENCH_BUILD_TYPE << "\",\n"
+        << "    \"min_time\": " << options.min_time << ",\n"
+        << "    \"repetitions\": " << options.repetitions << "\n"
+        << "  },\n  \"benchmarks\": [";
+    out << std::setprecision(3) << std::fixed;
+    for(std::size_t i = 0; i < results.size(); ++i){
+      const BenchResult & r = results[i];
+      out << (i ? ",\n" : "\n")
+          << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+          << ", \"iterations\": " << r.iterations
+          << ", \"ns_per_op\": " << r.ns_per_op
+          << ", \"allocs_per_op\": " << r.allocs_per_op
+          << ", \"bytes_per_op\": " << r.bytes_per_op << "}";
+    }
+    out << "\n  ],\n  \"scaling\": {";
+    std::vector<std::string> names;
+    for(auto & r : results){
+      if(std::find(names.begin(), names.end(), r.name) == names.end()) names.push_back(r.name);
+    }
+    bool first = true;
+    for(auto & n : names){
+      std::size_t count = 0;
+      for(auto & r : results) if(r.name == n) ++count;
+      if(count < 2) continue;
+      out << (first ? "\n" : ",\n") << "    \"" << n << "\": " << scaling(n);
+      first = false;
+    }
+    out << "\n  }\n}\n";
+    stream << out.str();
+  }
+
+  const BenchOptions options;
+
+private:
+  // where the table of results is printed
+  std::ostream & table;
+
+  std::vector<BenchResult> results;
+
+  static double median(std::vector<double> v){
+    std::sort(v.begin(), v.end());
+    std::size_t n = v.size();
+    return (n % 2) ? v[n/2] : (v[n/2 - 1] + v[n/2])/2;
+  }
+};
+
+/***********************************************************************
+Input generators
+**********************************************************************/
+
+// a nested program with about n numeric leaves
+std::string make_program(std::size_t n){
+  std::ostringstream out;
+  out << "(begin (define r 10) ; benchmark program\n";
+  for(std::size_t i = 0; i < n; i += 4){
+    out << "  (+ (* r " << i << ") (- " << i << ".5 1e-3) pi \"label " << i << "\")\n";
+  }
+  out << ")";
+  return out.str();
+}
+
+// (list 0 1 2 ... n-1)
+std::string make_list(std::size_t n){
+  std::ostringstream out;
+  out << "(list";
+  for(std::size_t i = 0; i < n; ++i) out << " " << i;
+  out << ")";
+  return out.str();
+}
+
+// (list (list x y) ...) with n points on a sine curve
+std::string make_points(std::size_t n){
+  std::ostringstream out;
+  out << "(list";
+  for(std::size_t i = 0; i < n; ++i){
+    out << " (list " << i << " " << std::sin(0.1*i) << ")";
+  }
+  out << ")";
+  return out.str();
+}
+
+Expression parse_string(const std::string & program){
+  std::istringstream iss(program);
+  return parse(tokenize(iss));
+}
+
+Expression eval_string(const std::string & program, Environment & env){
+  Expression ast = parse_string(program);
+  return ast.eval(env);
+}
+
+/***********************************************************************
+Benchmarks
+**********************************************************************/
+
+void bench_front_end(Bench & bench){
+
+  const std::size_t sizes[] = {16, 256, 4096};
+
+  for(auto n : sizes){
+    std::string program = make_program(n);
+    bench.run("tokenize", n, [&program](){
+      std::istringstream iss(program);
+      TokenSequenceType tokens = tokenize(iss);
+      keep(tokens);
+    });
+  }
+
+  for(auto n : sizes){
+    std::string program = make_program(n);
+    bench.run("tokenize_buffer", n, [&program](){
+      TokenSliceSequence tokens = tokenize(program.data(), program.size());
+      keep(tokens);
+    });
+  }
+
+  for(auto n : sizes){
+    std::string program = make_program(n);
+    std::istringstream iss(program);
+    TokenSequenceType tokens = tokenize(iss);
+    bench.run("parse", n, [&tokens](){
+      Expression ast = parse(tokens);
+      keep(ast);
+    });
+  }
+
+  for(auto n : sizes){
+    std::string program = make_program(n);
+    bench.run("parse_buffer", n, [&program](){
+      Expression ast = parse(program.data(), program.size());
+      keep(ast);
+    });
+  }
+
+  for(auto n : sizes){
+    std::string program = make_program(n);
+    bench.run("Interpreter::parseStream", n, [&program](){
+      std::istringstream iss(program);
+      Interpreter interp;
+      keep(interp.parseStream(iss));
+    });
+  }
+
+  const char * literals[][2] = {{"atom_number", "-1.25e-3"},
+                                {"atom_integer", "42"},
+                                {"atom_long_number", "123.45678901234567"},
+                                {"atom_symbol", "make-point"},
+                                {"atom_invalid", "1.2abc"}};
+  for(auto & lit : literals){
+    Token token{std::string(lit[1])};
+    bench.run(lit[0], 1, [&token](){
+      Atom a(token);
+      keep(a);
+    });
+  }
+
+  // printed numbers, sized by their number of significant digits
+  const std::pair<double, std::size_t> numbers[] = {{0.5, 1}, {42.25, 4}, {123.45678901234567, 17}};
+  for(auto & n : numbers){
+    Atom a(n.first);
+    std::ostringstream out;
+    bench.run("atom_print", n.second, [&a, &out](){
+      out.str(std::string());
+      out << a;
+      keep(out);
+    });
+  }
+}
+
+void bench_environment(Bench & bench){
+
+  bench.run("Environment()", 1, [](){
+    Environment env;
+    keep(env);
+  });
+
+  const std::size_t sizes[] = {1, 64, 4096};
+  for(auto n : sizes){
+    Environment env;
+    for(std::size_t i = 0; i < n; ++i){
+      env.add_exp(Atom("user" + std::to_string(i)), Expression(double(i)));
+    }
+    Atom user("user" + std::to_string(n/2));
+    Atom builtin("sqrt");
+    Atom constant("pi");
+
+    bench.run("env_get_exp_user", n, [&env, &user](){
+      Expression e = env.get_exp(user);
+      keep(e);
+    });
+    bench.run("env_get_exp_builtin", n, [&env, &constant](){
+      Expression e = env.get_exp(constant);
+      keep(e);
+    });
+    bench.run("env_get_proc", n, [&env, &builtin](){
+      keep(env.is_proc(builtin) ? env.get_proc(builtin) : nullptr);
+    });
+  }
+}
+
+void bench_builtins(Bench & bench){
+
+  Environment env;
+
+  struct Case { const char * name; const char * proc; std::vector<Expression> args; };
+
+  Expression complex(std::complex<double>(1, 2));
+  std::vector<Case> cases = {
+    {"builtin_add", "+", {Expression(1.0), Expression(2.0), Expression(3.0)}},
+    {"builtin_add_complex", "+", {Expression(1.0), complex}},
+    {"builtin_sub", "-", {Expression(5.0), Expression(2.0)}},
+    {"builtin_neg", "-", {Expression(5.0)}},
+    {"builtin_mul", "*", {Expression(2.0), Expression(3.0), Expression(4.0)}},
+    {"builtin_div", "/", {Expression(1.0), Expression(3.0)}},
+    {"builtin_sqrt", "sqrt", {Expression(2.0)}},
+    {"builtin_sqrt_negative", "sqrt", {Expression(-2.0)}},
+    {"builtin_expo", "^", {Expression(2.0), Expression(10.0)}},
+    {"builtin_ln", "ln", {Expression(2.0)}},
+    {"builtin_sin", "sin", {Expression(1.0)}},
+    {"builtin_cos", "cos", {Expression(1.0)}},
+    {"builtin_tan", "tan", {Expression(1.0)}},
+    {"builtin_real", "real", {complex}},
+    {"builtin_imag", "imag", {complex}},
+    {"builtin_mag", "mag", {complex}},
+    {"builtin_arg", "arg", {complex}},
+    {"builtin_conj", "conj", {complex}},
+  };
+
+  for(auto & c : cases){
+    Procedure proc = env.get_proc(Atom(c.proc));
+    const std::vector<Expression> & args = c.args;
+    bench.run(c.name, args.size(), [proc, &args](){
+      Expression e = proc(args);
+      keep(e);
+    });
+  }
+
+  const std::size_t sizes[] = {8, 128, 2048};
+  for(auto n : sizes){
+    Expression lst = eval_string(make_list(n), env);
+    std::vector<Expression> one = {lst};
+    std::vector<Expression> two = {lst, lst};
+    std::vector<Expression> items(lst.tailConstBegin(), lst.tailConstEnd());
+    std::vector<Expression> bounds = {Expression(0.0), Expression(double(n - 1)), Expression(1.0)};
+
+    struct ListCase { const char * name; const char * proc; const std::vector<Expression> * args; };
+    ListCase list_cases[] = {
+      {"builtin_list", "list", &items},
+      {"builtin_first", "first", &one},
+      {"builtin_rest", "rest", &one},
+      {"builtin_length", "length", &one},
+      {"builtin_append", "append", &two},
+      {"builtin_join", "join", &two},
+      {"builtin_range", "range", &bounds},
+    };
+    for(auto & c : list_cases){
+      Procedure proc = env.get_proc(Atom(c.proc));
+      const std::vector<Expression> * args = c.args;
+      bench.run(c.name, n, [proc, args](){
+        Expression e = proc(*args);
+        keep(e);
+      });
+    }
+  }
+}
+
+void bench_map_apply(Bench & bench){
+
+  Environment env;
+  eval_string("(define f (lambda (x) (+ (* 2 x) 1)))", env);
+  eval_string("(define g (lambda (x y) (* x y)))", env);
+
+  const std::size_t sizes[] = {8, 128, 2048};
+  for(auto n : sizes){
+    std::string lst = make_list(n);
+
+    struct EvalCase { const char * name; std::string program; };
+    EvalCase cases[] = {
+      {"map_builtin", "(map sqrt " + lst + ")"},
+      {"map_lambda", "(map f " + lst + ")"},
+      {"apply_builtin", "(apply + " + lst + ")"},
+    };
+    for(auto & c : cases){
+      Expression ast = parse_string(c.program);
+      bench.run(c.name, n, [&ast, &env](){
+        Expression e = ast.eval(env);
+        keep(e);
+      });
+    }
+  }
+
+  Expression ast = parse_string("(apply g (list 3 4))");
+  bench.run("apply_lambda", 2, [&ast, &env](){
+    Expression e = ast.eval(env);
+    keep(e);
+  });
+}
+
+void bench_plots(Bench & bench){
+
+  // the largest size is decimated
+  const std::size_t sizes[] = {16, 256, 4096, 65536};
+  for(auto n : sizes){
+    Environment env;
+    eval_string("(define data " + make_points(n) + ")", env);
+    Expression ast = parse_string("(discrete-plot data (list (list \"title\" \"bench\")))");
+    bench.run("discrete_plot", n, [&ast, &env](){
+      Expression e = ast.eval(env);
+      keep(e);
+    });
+  }
+
+  // size is the frequency of the sampled function, which drives refinement
+  const std::size_t freqs[] = {1, 4, 16};
+  for(auto n : freqs){
+    Environment env;
+    eval_string("(define f (lambda (x) (sin (* " + std::to_string(n) + " x))))", env);
+    Expression ast = parse_string("(continuous-plot f (list -3 3))");
+    bench.run("continuous_plot", n, [&ast, &env](){
+      Expression e = ast.eval(env);
+      keep(e);
+    });
+  }
+}
+
+// cost of the queue itself, uncontended
+template<typename Queue>
+void bench_queue(Bench & bench, const std::string & name){
+
+  Queue queue;
+  std::string line = "(+ 1 2)";
+  bench.run(name, 1, [&queue, &line](){
+    std::string popped;
+    queue.push(line);
+    queue.try_pop(popped);
+    keep(popped);
+  });
+}
+
+// a line sent to the kernel thread and its result received back, as the
+// REPL and notebook do for each command
+void bench_kernel(Bench & bench){
+
+  bench_queue<message_queue<std::string>>(bench, "message_queue_push_pop");
+  bench_queue<spsc_queue<std::string>>(bench, "spsc_queue_push_pop");
+
+  inputQueue inQ;
+  outputQueue outQ;
+  Interpreter interp;
+  Consumer consumer(&inQ, &outQ, &interp);
+  std::thread kernel(consumer);
+
+  const std::string line = "(+ 1 2)";
+  std::uint64_t id = 0;
+  bench.run("kernel_round_trip", 1, [&inQ, &outQ, &line, &id](){
+    Expression e;
+    inQ.push({++id, line});
+    wait_for_result(outQ, id, e, std::chrono::seconds(10));
+    keep(e);
+  });
+
+  // many lines in flight, the kernel drains its queue without sleeping
+  const std::size_t batch = 64;
+  bench.run("kernel_stream", batch, [&inQ, &outQ, &line, &id, batch](){
+    KernelResult r;
+    for(std::size_t i = 0; i < batch; ++i) inQ.push({++id, line});
+    for(std::size_t i = 0; i < batch; ++i) outQ.wait_and_pop(r);
+    keep(r);
+  });
+
+  // larger requests, whose parsing overlaps evaluating earlier ones
+  const std::string definition = "(begin (define f (lambda (x y) (+ (* x x) (- y 1) (/ x 2) (^ y 2))))"
+    " (f (list 1 2 3 4 5 6 7 8) (list 8 7 6 5 4 3 2 1)))";
+  bench.run("kernel_stream_programs", batch, [&inQ, &outQ, &definition, &id, batch](){
+    KernelResult r;
+    for(std::size_t i = 0; i < batch; ++i) inQ.push({++id, definition});
+    for(std::size_t i = 0; i < batch; ++i) outQ.wait_and_pop(r);
+    keep(r);
+  });
+
+  inQ.push({0, "%stop"});
+  kernel.join();
+
+  // resetting a forked kernel and evaluating the first line after it,
+  // which forks the next spare, against restarting a kernel thread with
+  // the startup environment
+  ForkedKernel forked;
+  if(forked.start()){
+    bench.run("forked_kernel_reset", 1, [&forked, &line](){
+      Expression e;
+      forked.reset();
+      forked.send(line);
+      forked.wait(e, std::chrono::seconds(10));
+      keep(e);
+    });
+    bench.run("forked_kernel_round_trip", 1, [&forked, &line](){
+      Expression e;
+      forked.send(line);
+      forked.wait(e, std::chrono::seconds(10));
+      keep(e);
+    });
+  }
+  bench.run("kernel_thread_reset", 1, [&inQ, &interp, &consumer](){
+    interp.startup();
+    std::thread restarted(consumer);
+    inQ.push({0, "%reset"});
+    restarted.join();
+  });
+}
+
+/***********************************************************************
+Whole-program runs
+**********************************************************************/
+
+// evaluate the program in file with interp, return false on any error
+bool run_program(Interpreter & interp, const ScriptFile & file){
+
+  if(!interp.parseBuffer(file.data(), file.size())){
+    std::cerr << "Error: Invalid Program. Could not parse." << std::endl;
+    return false;
+  }
+  try{
+    Expression exp = interp.evaluate();
+    keep(exp);
+  }
+  catch(const SemanticError & ex){
+    std::cerr << ex.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int run_script(const std::string & filename, int runs){
+
+  typedef std::chrono::steady_clock clock;
+
+  std::vector<double> wall_ms;
+  for(int r = 0; r < runs; ++r){
+    clock::time_point start = clock::now();
+
+    ScriptFile startup;
+    ScriptFile file;
+    if(!startup.open(STARTUP_FILE) || !file.open(filename)){
+      std::cerr << "Error: Could not open file for reading." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    Interpreter interp;
+    if(!run_program(interp, startup) || !run_program(interp, file)){
+      return EXIT_FAILURE;
+    }
+
+    wall_ms.push_back(std::chrono::duration<double, std::milli>(clock::now() - start).count());
+  }
+
+  std::cout << "{\"script\": \"" << filename << "\", \"runs\": " << runs << ", \"wall_ms\": [";
+  std::cout << std::fixed << std::setprecision(3);
+  for(std::size_t i = 0; i < wall_ms.size(); ++i){
+    std::cout << (i ? ", " : "") << wall_ms[i];
+  }
+  std::cout << "]}" << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+#ifdef BENCH_HAVE_MEASURE
+// Fork and exec argv, then report what wait4 says about the child. Doing
+// this from a small process (rather than from the calling script) keeps
+// the caller's own high-water mark out of the child's peak RSS.
+int measure_command(const std::string & outfile, char * argv[]){
+
+  typedef std::chrono::steady_clock clock;
+  clock::time_point start = clock::now();
+
+  pid_t pid = fork();
+  if(pid < 0){
+    std::cerr << "Error: fork failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if(pid == 0){
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+
+  int status = 0;
+  struct rusage usage;
+  if(wait4(pid, &status, 0, &usage) < 0){
+    std::cerr << "Error: wait4 failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+  double wall_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+  long peak_kb = usage.ru_maxrss;
+#ifdef __APPLE__
+  peak_kb /= 1024; // bytes on macOS
+#endif
+  int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+
+  std::ofstream out(outfile);
+  if(!out){
+    std::cerr << "Error: Could not open file for writing." << std::endl;
+    return EXIT_FAILURE;
+  }
+  out << std::fixed << std::setprecision(3)
+      << "{\"status\": " << code << ", \"wall_ms\": " << wall_ms
+      << ", \"peak_rss_kb\": " << peak_kb << "}" << std::endl;
+
+  return code;
+}
+#endif
+
+/***********************************************************************
+Driver
+**********************************************************************/
+
+void usage(){
+  std::cerr << "usage: plotscript_bench [--filter SUBSTR] [--min-time SECONDS] "
+            << "[--repetitions N] [--json FILE]\n"
+            << "       plotscript_bench --script FILE [--runs N]\n"
+            << "       plotscript_bench --measure OUTFILE COMMAND [ARGS...]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+  BenchOptions options;
+  std::string script;
+  int runs = 1;
+
+  for(int i = 1; i < argc; ++i){
+    std::string arg(argv[i]);
+    if(i + 1 < argc && arg == "--filter"){
+      options.filter = argv[++i];
+    }
+    else if(i + 1 < argc && arg == "--min-time"){
+      options.min_time = std::atof(argv[++i]);
+    }
+    else if(i + 1 < argc && arg == "--repetitions"){
+      options.repetitions = std::max(1, std::atoi(argv[++i]));
+    }
+    else if(i + 1 < argc && arg == "--json"){
+      options.json_file = argv[++i];
+    }
+#ifdef BENCH_HAVE_MEASURE
+    else if(i + 2 < argc && arg == "--measure"){
+      return measure_command(argv[i + 1], argv + i + 2);
+    }
+#endif
+    else if(i + 1 < argc && arg == "--script"){
+      script = argv[++i];
+    }
+    else if(i + 1 < argc && arg == "--runs"){
+      runs = std::max(1, std::atoi(argv[++i]));
+    }
+    else{
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  if(!script.empty()){
+    return run_script(script, runs);
+  }
+
+  Bench bench(options);
+  bench.header();
+
+  try{
+    bench_front_end(bench);
+    bench_environment(bench);
+    bench_builtins(bench);
+    bench_map_apply(bench);
+    bench_plots(bench);
+    bench_kernel(bench);
+  }
+  catch(const SemanticError & ex){
+    std::cerr << "Error: " << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if(!options.json_file.empty()){
+    if(options.json_file == "-"){
+      bench.write_json(std::cout);
+    }
+    else{
+      std::ofstream out(options.json_file);
+      if(!out){
+        std::cerr << "Error: Could not open file for writing." << std::endl;
+        return EXIT_FAILURE;
+      }
+      bench.write_json(out);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
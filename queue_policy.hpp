@@ -0,0 +1,41 @@
+/*! \file queue_policy.hpp
+Defines what a bounded message queue does when it is full, and the
+statistics the queues keep.
+ */
+#ifndef QUEUE_POLICY_HPP
+#define QUEUE_POLICY_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/// what push does when a bounded queue is full
+enum OverflowPolicy {
+  BLOCK_PRODUCER, ///< wait for the consumer to make room
+  REJECT_NEWEST,  ///< refuse the message, push returns false
+  DROP_OLDEST     ///< discard the message at the front to make room
+};
+
+/*! \struct QueueStats
+\brief A snapshot of the counters of a queue
+*/
+struct QueueStats {
+  /// messages in the queue
+  std::size_t depth;
+
+  /// the most messages the queue holds, 0 if unbounded
+  std::size_t capacity;
+
+  /// the most messages the queue has held at once
+  std::size_t high_water;
+
+  /// messages accepted by push
+  std::uint64_t pushed;
+
+  /// messages refused under REJECT_NEWEST
+  std::uint64_t rejected;
+
+  /// messages discarded under DROP_OLDEST
+  std::uint64_t dropped;
+};
+
+#endif
@@ -0,0 +1,237 @@
+#include "sampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+const double DEGREES_PER_RADIAN = 180 / (std::atan(1) * 4);
+
+// the turn in degrees at (x1, y1) going from (x0, y0) to (x2, y2)
+double turn(double x0, double y0, double x1, double y1, double x2, double y2){
+
+  double dx1 = x1 - x0, dy1 = y1 - y0;
+  double dx2 = x2 - x1, dy2 = y2 - y1;
+  return std::atan2(std::fabs(dx1 * dy2 - dy1 * dx2), dx1 * dx2 + dy1 * dy2) * DEGREES_PER_RADIAN;
+}
+
+// the distance from (x1, y1) to the line through (x0, y0) and (x2, y2)
+double deviation(double x0, double y0, double x1, double y1, double x2, double y2){
+
+  double dx = x2 - x0, dy = y2 - y0;
+  double length = std::hypot(dx, dy);
+  if(length == 0) return std::hypot(x1 - x0, y1 - y0);
+  return std::fabs(dx * (y1 - y0) - dy * (x1 - x0)) / length;
+}
+
+// the difference in degrees, less 180, between the slopes of the segments
+// either side of (x1, y1), as continuous-plot has always measured it
+double slope_angle(double x0, double y0, double x1, double y1, double x2, double y2){
+
+  double m1 = (y1 - y0) / (x1 - x0);
+  double m2 = (y2 - y1) / (x2 - x1);
+  return std::atan((m2 - m1) / (1 + m2 * m1)) * 180 / (std::atan(1) * 4) + 180;
+}
+
+// merge the midpoints of the split segments between their ends
+void merge(const std::vector<char> & split, std::vector<double> & xs, std::vector<double> & ys,
+	   const std::vector<double> & midxs, const std::vector<double> & midys,
+	   std::vector<double> & newxs, std::vector<double> & newys){
+
+  std::size_t n = xs.size();
+  newxs.clear();
+  newys.clear();
+  newxs.reserve(n + midxs.size());
+  newys.reserve(n + midxs.size());
+  std::size_t m = 0;
+  for(std::size_t s = 0; s + 1 < n; ++s){
+    newxs.push_back(xs[s]);
+    newys.push_back(ys[s]);
+    if(split[s]){
+      newxs.push_back(midxs[m]);
+      newys.push_back(midys[m]);
+      ++m;
+    }
+  }
+  newxs.push_back(xs[n - 1]);
+  newys.push_back(ys[n - 1]);
+
+  xs.swap(newxs);
+  ys.swap(newys);
+}
+
+// evaluate the midpoints of the split segments and merge them, returning
+// false if none were split
+bool refine(const SampleFunction & f, const std::vector<char> & split, std::vector<double> & xs, std::vector<double> & ys,
+	    std::vector<double> & midxs, std::vector<double> & midys, std::vector<double> & newxs, std::vector<double> & newys){
+
+  midxs.clear();
+  for(std::size_t s = 0; s + 1 < xs.size(); ++s){
+    if(split[s]) midxs.push_back((xs[s] + xs[s + 1]) / 2);
+  }
+  if(midxs.empty()){
+    return false;
+  }
+  f(midxs, midys);
+  merge(split, xs, ys, midxs, midys, newxs, newys);
+  return true;
+}
+
+// refine by the slopes of the segments in plot coordinates, from samples
+// stepped out from lower by equal intervals
+void sample_slope(double lower, double upper, const SampleFunction & f, const SamplerOptions & options,
+		  std::vector<double> & xs, std::vector<double> & ys, double & ylow, double & yhigh){
+
+  std::size_t n = std::max<std::size_t>(options.initial_samples, 2);
+
+  double xlength = std::fabs(upper - lower);
+  double step = xlength / (n - 1);
+  xs.resize(n);
+  xs[0] = lower;
+  for(std::size_t i = 1; i + 1 < n; ++i){
+    xs[i] = xs[i - 1] + step;
+  }
+  xs[n - 1] = upper;
+  f(xs, ys);
+
+  auto range = std::minmax_element(ys.begin(), ys.end());
+  ylow = *range.first;
+  yhigh = *range.second;
+
+  // the plot's coordinates, with y down, in which the midpoints are taken;
+  // xs and ys keep the abscissas f was evaluated at and its values
+  double xscale = PLOT_SIZE / xlength;
+  double yscale = PLOT_SIZE / (yhigh - ylow);
+  std::vector<double> sxs(n), sys(n);
+  for(std::size_t i = 0; i < n; ++i){
+    sxs[i] = xs[i] * xscale;
+    sys[i] = -ys[i] * yscale;
+  }
+  std::vector<double> fxs, fys;
+  SampleFunction g = [&f, &fxs, &fys, xscale, yscale](const std::vector<double> & sx, std::vector<double> & sy){
+    fxs.resize(sx.size());
+    for(std::size_t i = 0; i < sx.size(); ++i){
+      fxs[i] = sx[i] / xscale;
+    }
+    f(fxs, fys);
+    sy.resize(fys.size());
+    for(std::size_t i = 0; i < fys.size(); ++i){
+      sy[i] = fys[i] * -yscale;
+    }
+  };
+
+  std::vector<char> split;
+  std::vector<double> midxs, midys;
+  std::vector<double> newxs, newys;
+
+  for(std::size_t depth = 0; depth < options.max_depth; ++depth){
+
+    // split both segments at a sample whose slopes differ too much, and
+    // leave the next two samples for the following round
+    n = sxs.size();
+    split.assign(n - 1, 0);
+    for(std::size_t i = 1; i + 1 < n; ++i){
+      double angle = slope_angle(sxs[i - 1], sys[i - 1], sxs[i], sys[i], sxs[i + 1], sys[i + 1]);
+      if(!(angle > 180 - options.angle_tolerance && angle < 180 + options.angle_tolerance) &&
+	 (options.error_tolerance == 0 ||
+	  !(deviation(sxs[i - 1], sys[i - 1], sxs[i], sys[i], sxs[i + 1], sys[i + 1]) <= options.error_tolerance * PLOT_SIZE))){
+	split[i - 1] = split[i] = 1;
+	i += 2;
+      }
+    }
+
+    if(!refine(g, split, sxs, sys, midxs, midys, newxs, newys)){
+      break;
+    }
+    merge(split, xs, ys, fxs, fys, newxs, newys);
+  }
+}
+
+// refine by the turn of the curve with both axes scaled to unit length,
+// down to the resolution
+void sample_turn(double lower, double upper, const SampleFunction & f, const SamplerOptions & options,
+		 std::vector<double> & xs, std::vector<double> & ys, double & ylow, double & yhigh){
+
+  std::size_t n = std::max<std::size_t>(options.initial_samples, 2);
+
+  xs.resize(n);
+  double step = (upper - lower) / (n - 1);
+  for(std::size_t i = 0; i + 1 < n; ++i){
+    xs[i] = lower + i * step;
+  }
+  xs[n - 1] = upper;
+  f(xs, ys);
+
+  // scale both axes to unit length, a flat function is left unscaled
+  double xscale = (upper != lower) ? 1 / std::fabs(upper - lower) : 1;
+  auto range = std::minmax_element(ys.begin(), ys.end());
+  double yscale = (*range.second > *range.first) ? 1 / (*range.second - *range.first) : 1;
+
+  // segment s is longer than the resolution
+  double resolution = options.resolution;
+  auto longer = [xscale, yscale, resolution](const std::vector<double> & x, const std::vector<double> & y, std::size_t s){
+    return std::hypot((x[s + 1] - x[s]) * xscale, (y[s + 1] - y[s]) * yscale) > resolution;
+  };
+
+  std::vector<char> split;
+  std::vector<double> midxs, midys;
+  std::vector<double> newxs, newys;
+
+  for(std::size_t depth = 0; depth < options.max_depth; ++depth){
+
+    // mark both segments at every sample that turns too far
+    n = xs.size();
+    split.assign(n - 1, 0);
+    for(std::size_t i = 1; i + 1 < n; ++i){
+      double x0 = xs[i - 1] * xscale, y0 = ys[i - 1] * yscale;
+      double x1 = xs[i] * xscale, y1 = ys[i] * yscale;
+      double x2 = xs[i + 1] * xscale, y2 = ys[i + 1] * yscale;
+      if(!(turn(x0, y0, x1, y1, x2, y2) <= options.angle_tolerance) &&
+	 !(deviation(x0, y0, x1, y1, x2, y2) <= options.error_tolerance)){
+	split[i - 1] = split[i - 1] || longer(xs, ys, i - 1);
+	split[i] = longer(xs, ys, i);
+      }
+    }
+
+    if(!refine(f, split, xs, ys, midxs, midys, newxs, newys)){
+      break;
+    }
+  }
+
+  range = std::minmax_element(ys.begin(), ys.end());
+  ylow = *range.first;
+  yhigh = *range.second;
+}
+
+} // namespace
+
+SamplerOptions SamplerOptions::preview(){
+
+  SamplerOptions options;
+  options.method = TURN_SAMPLING;
+  options.initial_samples = 20;
+  options.max_depth = 3;
+  options.angle_tolerance = 15;
+  options.resolution = 0.02;
+  return options;
+}
+
+std::size_t sample_workers(std::size_t samples, std::size_t workers){
+
+  if(workers == 0){
+    workers = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  return std::max<std::size_t>(std::min(workers, samples / MIN_SAMPLES_PER_WORKER), 1);
+}
+
+void sample_adaptive(double lower, double upper, const SampleFunction & f, const SamplerOptions & options,
+		     std::vector<double> & xs, std::vector<double> & ys, double & ylow, double & yhigh){
+
+  if(options.method == TURN_SAMPLING){
+    sample_turn(lower, upper, f, options, xs, ys, ylow, yhigh);
+  }
+  else{
+    sample_slope(lower, upper, f, options, xs, ys, ylow, yhigh);
+  }
+}
@@ -0,0 +1,103 @@
+/*! \file sampler.hpp
+Defines the adaptive sampler used by continuous-plot.
+
+The sampler evaluates a function at evenly spaced abscissas, then refines
+in rounds, splitting segments at their midpoints where the curve bends.
+By default it bends where the slopes of the segments either side of a
+sample, in plot coordinates, differ by the angle tolerance or more, as
+continuous-plot always has; after a sample is refined the next two are
+left for the following round. Optionally it bends where the curve turns
+by more than the angle tolerance and strays from the chord between its
+neighbours by more than the error tolerance, unless the segments are
+already shorter than the resolution. Either way all the midpoints of a
+round are evaluated in one batch and merged into the samples in linear
+time, so a caller may spread the evaluation of each batch over threads.
+ */
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/// the width and height continuous-plot draws a plot at
+const double PLOT_SIZE = 20;
+
+/// where the sampler refines
+enum SamplingMethod {
+  SLOPE_SAMPLING, ///< where the slopes either side of a sample differ
+  TURN_SAMPLING   ///< where the curve turns, down to the resolution
+};
+
+/// evaluate a function at each abscissa in xs, setting ys to the same size
+typedef std::function<void(const std::vector<double> & xs, std::vector<double> & ys)> SampleFunction;
+
+/*! \struct SamplerOptions
+\brief The resolution and tolerance of adaptive sampling
+*/
+struct SamplerOptions {
+  /// where to refine
+  SamplingMethod method;
+
+  /// evenly spaced samples before refinement, including both ends
+  std::size_t initial_samples;
+
+  /// the most refinement rounds
+  std::size_t max_depth;
+
+  /// the largest turn, or difference of slopes, in degrees at a sample
+  /// that is not refined
+  double angle_tolerance;
+
+  /// segments shorter than this fraction of the plot size are not split,
+  /// under TURN_SAMPLING
+  double resolution;
+
+  /// a sample closer than this fraction of the plot size to the chord
+  /// between its neighbours is not refined, 0 to refine on angle alone
+  double error_tolerance;
+
+  /// the most threads evaluating a batch of samples, 0 for one per core
+  std::size_t workers;
+
+  /// the defaults of continuous-plot
+  SamplerOptions(): method(SLOPE_SAMPLING), initial_samples(50), max_depth(10), angle_tolerance(5), resolution(0.005),
+		    error_tolerance(0), workers(0) {}
+
+  /// coarse options for fast previews, by TURN_SAMPLING
+  static SamplerOptions preview();
+};
+
+/*! \fn void sample_adaptive(double lower, double upper, const SampleFunction & f, const SamplerOptions & options, std::vector<double> & xs, std::vector<double> & ys, double & ylow, double & yhigh)
+\brief Sample f over [lower, upper]
+
+Angles are measured with both axes scaled to the same length, the x axis
+over [lower, upper] and the y axis over the range of the initial
+samples, as continuous-plot draws them.
+
+\param lower the first abscissa
+\param upper the last abscissa
+\param f the function to sample, called once per round
+\param options the method, resolution and tolerance
+\param xs set to the abscissas, in increasing order
+\param ys set to the values of f at xs
+\param ylow set to the least value the plot is scaled to: of the initial
+samples under SLOPE_SAMPLING, of all of them under TURN_SAMPLING
+\param yhigh set to the greatest value the plot is scaled to
+*/
+void sample_adaptive(double lower, double upper, const SampleFunction & f, const SamplerOptions & options,
+		     std::vector<double> & xs, std::vector<double> & ys, double & ylow, double & yhigh);
+
+/// the fewest samples worth a thread of their own
+const std::size_t MIN_SAMPLES_PER_WORKER = 32;
+
+/*! \fn std::size_t sample_workers(std::size_t samples, std::size_t workers)
+\brief The threads to evaluate a batch of samples on
+
+\param samples the size of the batch
+\param workers the most threads, 0 for one per core
+\return at least 1, and no more than leaves each thread MIN_SAMPLES_PER_WORKER samples
+*/
+std::size_t sample_workers(std::size_t samples, std::size_t workers);
+
+#endif
@@ -0,0 +1,232 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "sampler.hpp"
+
+// a sample function counting its calls and evaluations
+struct Counted {
+  double (*function)(double);
+  std::size_t calls;
+  std::size_t evaluations;
+
+  SampleFunction bind(){
+    return [this](const std::vector<double> & xs, std::vector<double> & ys){
+      ++calls;
+      evaluations += xs.size();
+      ys.resize(xs.size());
+      for(std::size_t i = 0; i < xs.size(); ++i) ys[i] = function(xs[i]);
+    };
+  }
+};
+
+double linear(double x){ return 2 * x + 1; }
+double kink(double x){ return std::fabs(x - 0.3); }
+double wave(double x){ return std::sin(12 * x); }
+
+bool increasing(const std::vector<double> & xs){
+  for(std::size_t i = 1; i < xs.size(); ++i){
+    if(!(xs[i - 1] < xs[i])) return false;
+  }
+  return true;
+}
+
+TEST_CASE( "Test sampling a straight line", "[sampler]" ) {
+
+  Counted f = {linear, 0, 0};
+  std::vector<double> xs, ys;
+  double ylow, yhigh;
+  sample_adaptive(-2, 2, f.bind(), SamplerOptions(), xs, ys, ylow, yhigh);
+
+  // nothing to refine
+  REQUIRE(xs.size() == 50);
+  REQUIRE(ys.size() == 50);
+  REQUIRE(f.calls == 1);
+  REQUIRE(xs.front() == -2);
+  REQUIRE(xs.back() == 2);
+  REQUIRE(increasing(xs));
+  for(std::size_t i = 0; i < xs.size(); ++i){
+    REQUIRE(ys[i] == linear(xs[i]));
+  }
+  REQUIRE(ylow == -3);
+  REQUIRE(yhigh == 5);
+}
+
+TEST_CASE( "Test refining where the curve turns", "[sampler]" ) {
+
+  {
+    INFO("a kink is refined around it only, one batch per round");
+    Counted f = {kink, 0, 0};
+    std::vector<double> xs, ys;
+    double ylow, yhigh;
+    sample_adaptive(-1, 1, f.bind(), SamplerOptions(), xs, ys, ylow, yhigh);
+
+    REQUIRE(f.calls > 1);
+    REQUIRE(f.calls <= 1 + SamplerOptions().max_depth);
+    REQUIRE(xs.size() == f.evaluations);
+    REQUIRE(increasing(xs));
+    for(std::size_t i = 0; i < xs.size(); ++i){
+      REQUIRE(ys[i] == kink(xs[i]));
+    }
+
+    // the samples closest to the kink are much closer than the initial spacing
+    double closest = 1;
+    for(double x : xs) closest = std::min(closest, std::fabs(x - 0.3));
+    REQUIRE(closest < (2. / 49) / 4);
+    REQUIRE(xs.size() < 50 + 4 * SamplerOptions().max_depth);
+  }
+
+  {
+    INFO("without a resolution refinement by turns continues until the curve is smooth enough");
+    Counted f = {wave, 0, 0};
+    SamplerOptions options;
+    options.method = TURN_SAMPLING;
+    options.resolution = 0;
+    options.max_depth = 20;
+    std::vector<double> xs, ys;
+    double ylow, yhigh;
+    sample_adaptive(-3, 3, f.bind(), options, xs, ys, ylow, yhigh);
+
+    REQUIRE(f.calls < 1 + options.max_depth);
+    REQUIRE(increasing(xs));
+
+    // measured over the initial samples' range, as the sampler does
+    double yrange = 0;
+    for(std::size_t i = 0; i < 50; ++i) yrange = std::max(yrange, 2 * std::fabs(wave(-3 + i * 6. / 49)));
+    for(std::size_t i = 1; i + 1 < xs.size(); ++i){
+      double dx1 = (xs[i] - xs[i - 1]) / 6, dy1 = (ys[i] - ys[i - 1]) / yrange;
+      double dx2 = (xs[i + 1] - xs[i]) / 6, dy2 = (ys[i + 1] - ys[i]) / yrange;
+      double angle = std::atan2(std::fabs(dx1 * dy2 - dy1 * dx2), dx1 * dx2 + dy1 * dy2) * 45 / std::atan(1);
+      REQUIRE(angle <= options.angle_tolerance * 1.01);
+    }
+
+    // all the samples are in the range reported
+    REQUIRE(ylow == *std::min_element(ys.begin(), ys.end()));
+    REQUIRE(yhigh == *std::max_element(ys.begin(), ys.end()));
+
+    // the default resolution keeps far fewer samples
+    Counted coarse = {wave, 0, 0};
+    SamplerOptions turn;
+    turn.method = TURN_SAMPLING;
+    std::vector<double> cxs, cys;
+    sample_adaptive(-3, 3, coarse.bind(), turn, cxs, cys, ylow, yhigh);
+    REQUIRE(cxs.size() > 50);
+    REQUIRE(cxs.size() * 2 < xs.size());
+  }
+
+  {
+    INFO("no refinement rounds leaves the initial samples");
+    Counted f = {wave, 0, 0};
+    SamplerOptions options;
+    options.max_depth = 0;
+    options.initial_samples = 7;
+    std::vector<double> xs, ys;
+    double ylow, yhigh;
+    sample_adaptive(0, 6, f.bind(), options, xs, ys, ylow, yhigh);
+    REQUIRE(f.calls == 1);
+    REQUIRE(xs == std::vector<double>({0, 1, 2, 3, 4, 5, 6}));
+    options.method = TURN_SAMPLING;
+    sample_adaptive(0, 6, f.bind(), options, xs, ys, ylow, yhigh);
+    REQUIRE(f.calls == 2);
+    REQUIRE(xs == std::vector<double>({0, 1, 2, 3, 4, 5, 6}));
+  }
+
+  {
+    INFO("an error tolerance stops refinement where the curve is close to its chords");
+    Counted f = {wave, 0, 0};
+    SamplerOptions options;
+    options.method = TURN_SAMPLING;
+    options.resolution = 0;
+    options.max_depth = 20;
+    std::vector<double> xs, ys;
+    double ylow, yhigh;
+    sample_adaptive(-3, 3, f.bind(), options, xs, ys, ylow, yhigh);
+
+    Counted loose = {wave, 0, 0};
+    options.error_tolerance = 0.001;
+    std::vector<double> lxs, lys;
+    sample_adaptive(-3, 3, loose.bind(), options, lxs, lys, ylow, yhigh);
+    REQUIRE(increasing(lxs));
+    REQUIRE(lxs.size() > 50);
+    REQUIRE(lxs.size() * 2 < xs.size());
+
+    // and by slopes too
+    Counted slope = {wave, 0, 0};
+    sample_adaptive(-3, 3, slope.bind(), SamplerOptions(), xs, ys, ylow, yhigh);
+    Counted loose_slope = {wave, 0, 0};
+    SamplerOptions loose_options;
+    loose_options.error_tolerance = 0.001;
+    sample_adaptive(-3, 3, loose_slope.bind(), loose_options, lxs, lys, ylow, yhigh);
+    REQUIRE(increasing(lxs));
+    REQUIRE(lxs.size() > 50);
+    REQUIRE(lxs.size() < xs.size());
+  }
+}
+
+TEST_CASE( "Test refining by slopes as continuous-plot always has", "[sampler]" ) {
+
+  // a parabola's slopes differ by the same amount at every initial
+  // sample, so every one bends; after each refined sample the next two
+  // are left, splitting the segments either side of samples 1, 4, 7, ...
+  Counted f = {[](double x){ return x * x; }, 0, 0};
+  SamplerOptions options;
+  options.initial_samples = 11;
+  options.max_depth = 1;
+  options.angle_tolerance = 1;
+  std::vector<double> xs, ys;
+  double ylow, yhigh;
+  sample_adaptive(0, 10, f.bind(), options, xs, ys, ylow, yhigh);
+
+  REQUIRE(f.calls == 2);
+  REQUIRE(f.evaluations == 11 + 6);
+  REQUIRE(increasing(xs));
+  std::vector<double> expected = {0, 0.5, 1, 1.5, 2, 3, 3.5, 4, 4.5, 5, 6, 6.5, 7, 7.5, 8, 9, 10};
+  REQUIRE(xs.size() == expected.size());
+  for(std::size_t i = 0; i < xs.size(); ++i){
+    REQUIRE(std::fabs(xs[i] - expected[i]) < 1e-9);
+    REQUIRE(ys[i] == xs[i] * xs[i]);
+  }
+
+  // the range of the initial samples is reported even when refinement
+  // finds values outside it
+  Counted g = {wave, 0, 0};
+  options = SamplerOptions();
+  options.initial_samples = 4;
+  sample_adaptive(0, 3, g.bind(), options, xs, ys, ylow, yhigh);
+  REQUIRE(ylow == std::min({wave(0), wave(1), wave(2), wave(3)}));
+  REQUIRE(yhigh == std::max({wave(0), wave(1), wave(2), wave(3)}));
+  REQUIRE(*std::max_element(ys.begin(), ys.end()) > yhigh);
+}
+
+TEST_CASE( "Test the preview sampler options", "[sampler]" ) {
+
+  SamplerOptions preview = SamplerOptions::preview();
+  REQUIRE(preview.initial_samples < SamplerOptions().initial_samples);
+  REQUIRE(preview.max_depth < SamplerOptions().max_depth);
+
+  REQUIRE(preview.method == TURN_SAMPLING);
+
+  Counted f = {wave, 0, 0};
+  std::vector<double> xs, ys;
+  double ylow, yhigh;
+  sample_adaptive(-3, 3, f.bind(), preview, xs, ys, ylow, yhigh);
+  REQUIRE(f.calls <= 1 + preview.max_depth);
+  REQUIRE(increasing(xs));
+
+  Counted full = {wave, 0, 0};
+  std::vector<double> fxs, fys;
+  sample_adaptive(-3, 3, full.bind(), SamplerOptions(), fxs, fys, ylow, yhigh);
+  REQUIRE(xs.size() * 2 < fxs.size());
+}
+
+TEST_CASE( "Test choosing threads for a batch of samples", "[sampler]" ) {
+
+  REQUIRE(sample_workers(0, 4) == 1);
+  REQUIRE(sample_workers(MIN_SAMPLES_PER_WORKER * 2 - 1, 4) == 1);
+  REQUIRE(sample_workers(MIN_SAMPLES_PER_WORKER * 2, 4) == 2);
+  REQUIRE(sample_workers(MIN_SAMPLES_PER_WORKER * 100, 4) == 4);
+  REQUIRE(sample_workers(MIN_SAMPLES_PER_WORKER * 100, 1) == 1);
+  REQUIRE(sample_workers(MIN_SAMPLES_PER_WORKER * 100, 0) >= 1);
+}
@@ -0,0 +1,625 @@
+#include "script_cache.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "interpreter.hpp"
+#include "plot_buffer.hpp"
+#include "script_file.hpp"
+#include "startup_config.hpp"
+
+#if defined(__APPLE__) || defined(__linux) || defined(__unix) ||             \
+    defined(__posix)
+#define SCRIPT_CACHE_HAVE_POSIX
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+namespace {
+
+const char MAGIC[4] = {'P', 'L', 'S', 'C'};
+
+// kinds of head atoms
+enum NodeKind : unsigned char {NoneNode, NumberNode, SymbolNode, ComplexNode, PlotNode};
+
+const std::uint64_t FNV_OFFSET = 14695981039346656037ull;
+const std::uint64_t FNV_PRIME = 1099511628211ull;
+
+std::uint64_t fnv1a(std::uint64_t hash, const char * data, std::size_t size){
+  for(std::size_t i = 0; i < size; ++i){
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+/***********************************************************************
+SHA-256, as specified in FIPS 180-4
+**********************************************************************/
+
+const std::uint32_t SHA256_K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline std::uint32_t rotr(std::uint32_t x, int n){
+  return (x >> n) | (x << (32 - n));
+}
+
+// fold one 64 byte block into the state h
+void sha256_block(std::uint32_t h[8], const unsigned char * block){
+
+  std::uint32_t w[64];
+  for(int i = 0; i < 16; ++i){
+    w[i] = std::uint32_t(block[4*i]) << 24 | std::uint32_t(block[4*i + 1]) << 16 |
+      std::uint32_t(block[4*i + 2]) << 8 | std::uint32_t(block[4*i + 3]);
+  }
+  for(int i = 16; i < 64; ++i){
+    std::uint32_t s0 = rotr(w[i-15], 7) ^ rotr(w[i-15], 18) ^ (w[i-15] >> 3);
+    std::uint32_t s1 = rotr(w[i-2], 17) ^ rotr(w[i-2], 19) ^ (w[i-2] >> 10);
+    w[i] = w[i-16] + s0 + w[i-7] + s1;
+  }
+
+  std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+  for(int i = 0; i < 64; ++i){
+    std::uint32_t t1 = k + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+    std::uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    k = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+  }
+  h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+  h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+void sha256(const char * data, std::size_t size, unsigned char digest[32]){
+
+  std::uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+  const unsigned char * bytes = reinterpret_cast<const unsigned char *>(data);
+  std::size_t whole = size - size % 64;
+  for(std::size_t i = 0; i < whole; i += 64){
+    sha256_block(h, bytes + i);
+  }
+
+  // the rest, a one bit, zeros and the length in bits fill one or two blocks
+  unsigned char tail[128] = {0};
+  std::size_t rest = size - whole;
+  if(rest > 0) std::memcpy(tail, bytes + whole, rest);
+  tail[rest] = 0x80;
+  std::size_t blocks = (rest < 56) ? 1 : 2;
+  std::uint64_t bits = std::uint64_t(size) * 8;
+  for(int i = 0; i < 8; ++i){
+    tail[64*blocks - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+  }
+  for(std::size_t i = 0; i < blocks; ++i){
+    sha256_block(h, tail + 64*i);
+  }
+
+  for(int i = 0; i < 8; ++i){
+    for(int j = 0; j < 4; ++j){
+      digest[4*i + j] = static_cast<unsigned char>(h[i] >> (24 - 8 * j));
+    }
+  }
+}
+
+/***********************************************************************
+Encoding, all integers little endian:
+
+  "PLSC" u32 format-version string interpreter-version string parser-id
+  u64 source-size, 32 bytes source-sha256, node
+
+where a string is a u32 length followed by its characters, and a node is
+
+  u8 kind, then a f64 (Number), string (Symbol), two f64 (Complex) or plot,
+  u32 tail-count, u32 property-count,
+  property-count times: string key, node
+  tail-count times: node
+
+and a plot is
+
+  u32 primitive-count, primitive-count times: u8 kind,
+  u32 point-count, point-count times: f64 x, f64 y, f64 size,
+  u32 line-count, line-count times: f64 x1, f64 y1, f64 x2, f64 y2, f64 thickness,
+  u32 text-count, text-count times: string, f64 x, f64 y, f64 scale, f64 rotation
+**********************************************************************/
+
+class Writer {
+public:
+  std::string bytes;
+
+  void u8(unsigned char v){
+    bytes += static_cast<char>(v);
+  }
+
+  void u32(std::uint32_t v){
+    for(int i = 0; i < 4; ++i) u8(static_cast<unsigned char>(v >> (8 * i)));
+  }
+
+  void u64(std::uint64_t v){
+    for(int i = 0; i < 8; ++i) u8(static_cast<unsigned char>(v >> (8 * i)));
+  }
+
+  void f64(double v){
+    std::uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    u64(bits);
+  }
+
+  void str(const std::string & s){
+    u32(static_cast<std::uint32_t>(s.size()));
+    bytes += s;
+  }
+
+  void node(const Expression & exp){
+
+    const Atom & head = exp.head();
+    if(head.isNumber()){
+      u8(NumberNode);
+      f64(head.asNumber());
+    }
+    else if(head.isSymbol()){
+      u8(SymbolNode);
+      str(head.asSymbol());
+    }
+    else if(head.isComplex()){
+      u8(ComplexNode);
+      f64(head.asComplex().real());
+      f64(head.asComplex().imag());
+    }
+    else if(head.isPlot()){
+      u8(PlotNode);
+      plot(*head.asPlot());
+    }
+    else{
+      u8(NoneNode);
+    }
+
+    u32(static_cast<std::uint32_t>(exp.tailConstEnd() - exp.tailConstBegin()));
+    u32(static_cast<std::uint32_t>(exp.propertyCount()));
+    for(std::size_t i = 0; i < exp.propertyCount(); ++i){
+      str(exp.propertyKey(i));
+      node(exp.propertyValue(i));
+    }
+    for(auto e = exp.tailConstBegin(); e != exp.tailConstEnd(); ++e){
+      node(*e);
+    }
+  }
+
+  void plot(const PlotBuffer & p){
+
+    u32(static_cast<std::uint32_t>(p.order.size()));
+    for(PlotPrimitive kind : p.order){
+      u8(kind);
+    }
+    u32(static_cast<std::uint32_t>(p.point_x.size()));
+    for(std::size_t i = 0; i < p.point_x.size(); ++i){
+      f64(p.point_x[i]);
+      f64(p.point_y[i]);
+      f64(p.point_size[i]);
+    }
+    u32(static_cast<std::uint32_t>(p.line_x1.size()));
+    for(std::size_t i = 0; i < p.line_x1.size(); ++i){
+      f64(p.line_x1[i]);
+      f64(p.line_y1[i]);
+      f64(p.line_x2[i]);
+      f64(p.line_y2[i]);
+      f64(p.line_thickness[i]);
+    }
+    u32(static_cast<std::uint32_t>(p.text.size()));
+    for(std::size_t i = 0; i < p.text.size(); ++i){
+      str(p.text[i]);
+      f64(p.text_x[i]);
+      f64(p.text_y[i]);
+      f64(p.text_scale[i]);
+      f64(p.text_rotation[i]);
+    }
+  }
+};
+
+class Reader {
+public:
+  Reader(const char * data, std::size_t size): pos(data), end(data + size), ok(true), depth(0) {}
+
+  const char * pos;
+  const char * end;
+  bool ok;
+
+  // the nesting of the node being read
+  std::size_t depth;
+
+  bool need(std::size_t n){
+    if(ok && static_cast<std::size_t>(end - pos) < n) ok = false;
+    return ok;
+  }
+
+  unsigned char u8(){
+    if(!need(1)) return 0;
+    return static_cast<unsigned char>(*pos++);
+  }
+
+  std::uint32_t u32(){
+    std::uint32_t v = 0;
+    if(!need(4)) return 0;
+    for(int i = 0; i < 4; ++i) v |= std::uint32_t(static_cast<unsigned char>(*pos++)) << (8 * i);
+    return v;
+  }
+
+  std::uint64_t u64(){
+    std::uint64_t v = 0;
+    if(!need(8)) return 0;
+    for(int i = 0; i < 8; ++i) v |= std::uint64_t(static_cast<unsigned char>(*pos++)) << (8 * i);
+    return v;
+  }
+
+  double f64(){
+    std::uint64_t bits = u64();
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+
+  std::string str(){
+    std::uint32_t n = u32();
+    if(!need(n)) return std::string();
+    std::string s(pos, n);
+    pos += n;
+    return s;
+  }
+
+  void node(Expression & exp){
+
+    // the file may not be trusted, bound the recursion
+    if(++depth > MAX_COMPILED_DEPTH) ok = false;
+    if(!ok) return;
+
+    switch(u8()){
+    case NoneNode:
+      break;
+    case NumberNode:
+      exp.head() = Atom(f64());
+      break;
+    case SymbolNode:
+      exp.head() = Atom(str());
+      break;
+    case ComplexNode:
+      {
+        double re = f64();
+        exp.head() = Atom(std::complex<double>(re, f64()));
+      }
+      break;
+    case PlotNode:
+      exp.head() = Atom(std::shared_ptr<const PlotBuffer>(plot()));
+      break;
+    default:
+      ok = false;
+    }
+
+    std::uint32_t tail_count = u32();
+    std::uint32_t prop_count = u32();
+
+    // every node takes at least 9 bytes, reject counts that cannot fit
+    if(!need((std::uint64_t(tail_count) + prop_count) * 9)) return;
+
+    for(std::uint32_t i = 0; ok && i < prop_count; ++i){
+      std::string key = str();
+      Expression value;
+      node(value);
+      exp.setProperty(key, std::move(value));
+    }
+    exp.reserveTail(tail_count);
+    for(std::uint32_t i = 0; ok && i < tail_count; ++i){
+      exp.append(Atom());
+      node(*exp.tail());
+    }
+    --depth;
+  }
+
+  std::shared_ptr<PlotBuffer> plot(){
+
+    std::shared_ptr<PlotBuffer> p = std::make_shared<PlotBuffer>();
+
+    // reject counts that cannot fit, and primitives the arrays do not hold
+    std::uint32_t primitives = u32();
+    if(!need(primitives)) return p;
+    std::size_t counts[3] = {0, 0, 0};
+    std::vector<PlotPrimitive> order;
+    order.reserve(primitives);
+    for(std::uint32_t i = 0; i < primitives; ++i){
+      unsigned char kind = u8();
+      if(kind > PLOT_TEXT) ok = false;
+      if(!ok) return p;
+      ++counts[kind];
+      order.push_back(static_cast<PlotPrimitive>(kind));
+    }
+
+    if(u32() != counts[PLOT_POINT] || !need(counts[PLOT_POINT] * 24)) ok = false;
+    for(std::size_t i = 0; ok && i < counts[PLOT_POINT]; ++i){
+      double x = f64(), y = f64();
+      p->add_point(x, y, f64());
+    }
+    if(u32() != counts[PLOT_LINE] || !need(counts[PLOT_LINE] * 40)) ok = false;
+    for(std::size_t i = 0; ok && i < counts[PLOT_LINE]; ++i){
+      double x1 = f64(), y1 = f64(), x2 = f64(), y2 = f64();
+      p->add_line(x1, y1, x2, y2, f64());
+    }
+    if(u32() != counts[PLOT_TEXT] || !need(counts[PLOT_TEXT] * 36)) ok = false;
+    for(std::size_t i = 0; ok && i < counts[PLOT_TEXT]; ++i){
+      std::string value = str();
+      double x = f64(), y = f64(), scale = f64();
+      p->add_text(x, y, value, scale, f64());
+    }
+
+    // the add_ members appended kind by kind, restore the order read
+    p->order.swap(order);
+    return p;
+  }
+};
+
+std::string default_directory(){
+
+  const char * dir = std::getenv("PLOTSCRIPT_CACHE_DIR");
+  if(dir != nullptr){
+    return dir;
+  }
+
+  dir = std::getenv("XDG_CACHE_HOME");
+  if(dir != nullptr && *dir != '\0'){
+    return std::string(dir) + "/plotscript";
+  }
+
+  dir = std::getenv("HOME");
+  if(dir != nullptr && *dir != '\0'){
+    return std::string(dir) + "/.cache/plotscript";
+  }
+
+  return std::string();
+}
+
+#ifdef SCRIPT_CACHE_HAVE_POSIX
+
+// distinguishes temporary files written by threads of one process
+std::atomic<unsigned> temp_counter(0);
+
+// create directory and its parents, return true if it exists afterwards
+bool make_directories(const std::string & dir){
+
+  for(std::size_t i = 1; i <= dir.size(); ++i){
+    if(i == dir.size() || dir[i] == '/'){
+      std::string prefix = dir.substr(0, i);
+      if(mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST){
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+#endif
+
+} // namespace
+
+SourceDigest::SourceDigest(): size(0){
+
+  std::memset(sha256, 0, sizeof(sha256));
+}
+
+bool SourceDigest::operator==(const SourceDigest & other) const noexcept{
+
+  return size == other.size && std::memcmp(sha256, other.sha256, sizeof(sha256)) == 0;
+}
+
+bool SourceDigest::operator!=(const SourceDigest & other) const noexcept{
+
+  return !(*this == other);
+}
+
+SourceDigest source_digest(const char * data, std::size_t size){
+
+  SourceDigest source;
+  source.size = size;
+  ::sha256(data, size, source.sha256);
+  return source;
+}
+
+std::uint64_t source_key(const SourceDigest & source){
+
+  std::uint64_t hash = fnv1a(FNV_OFFSET, PLOTSCRIPT_PARSER_ID.data(), PLOTSCRIPT_PARSER_ID.size());
+  char format = static_cast<char>(COMPILED_FORMAT_VERSION);
+  hash = fnv1a(hash, &format, 1);
+  return fnv1a(hash, reinterpret_cast<const char *>(source.sha256), sizeof(source.sha256));
+}
+
+bool is_compiled(const char * data, std::size_t size) noexcept{
+
+  return size >= sizeof(MAGIC) && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void write_compiled(std::ostream & out, const Expression & ast, const SourceDigest & source){
+
+  Writer w;
+  w.bytes.append(MAGIC, sizeof(MAGIC));
+  w.u32(COMPILED_FORMAT_VERSION);
+  w.str(PLOTSCRIPT_VERSION);
+  w.str(PLOTSCRIPT_PARSER_ID);
+  w.u64(source.size);
+  w.bytes.append(reinterpret_cast<const char *>(source.sha256), sizeof(source.sha256));
+  w.node(ast);
+
+  out.write(w.bytes.data(), w.bytes.size());
+}
+
+bool read_compiled(const char * data, std::size_t size, Expression & ast, SourceDigest & source) noexcept{
+
+  if(!is_compiled(data, size)){
+    return false;
+  }
+
+  try{
+    Reader r(data + sizeof(MAGIC), size - sizeof(MAGIC));
+    if(r.u32() != COMPILED_FORMAT_VERSION || r.str() != PLOTSCRIPT_VERSION ||
+       r.str() != PLOTSCRIPT_PARSER_ID){
+      return false;
+    }
+    source.size = r.u64();
+    if(!r.need(sizeof(source.sha256))){
+      return false;
+    }
+    std::memcpy(source.sha256, r.pos, sizeof(source.sha256));
+    r.pos += sizeof(source.sha256);
+
+    ast = Expression();
+    r.node(ast);
+    if(r.ok && r.pos == r.end){
+      return true;
+    }
+  }
+  catch(const std::exception &){
+  }
+
+  ast = Expression();
+  return false;
+}
+
+ScriptCache::ScriptCache(): m_dir(default_directory()), m_limit(DEFAULT_CACHE_LIMIT) {}
+
+ScriptCache::ScriptCache(const std::string & directory, std::uint64_t limit): m_dir(directory), m_limit(limit) {}
+
+bool ScriptCache::enabled() const noexcept{
+
+  return !m_dir.empty();
+}
+
+std::string ScriptCache::path(std::uint64_t key) const{
+
+  static const char digits[] = "0123456789abcdef";
+  std::string name(16, '0');
+  for(int i = 15; i >= 0; --i, key >>= 4){
+    name[i] = digits[key & 0xf];
+  }
+  return m_dir + "/" + name + ".plsc";
+}
+
+bool ScriptCache::parse(Interpreter & interp, const char * data, std::size_t size){
+
+  if(!enabled()){
+    return interp.parseBuffer(data, size);
+  }
+
+  SourceDigest source = source_digest(data, size);
+  std::uint64_t key = source_key(source);
+
+  // an entry for another text with the same key is a miss, and is replaced
+  ScriptFile compiled;
+  SourceDigest recorded;
+  if(compiled.open(path(key)) &&
+     interp.parseCompiled(compiled.data(), compiled.size(), recorded) && recorded == source){
+#ifdef SCRIPT_CACHE_HAVE_POSIX
+    // mark the entry used, so trimming keeps it longest
+    utime(path(key).c_str(), nullptr);
+#endif
+    return true;
+  }
+
+  if(!interp.parseBuffer(data, size)){
+    return false;
+  }
+
+  store(interp, key, source);
+  return true;
+}
+
+bool ScriptCache::store(const Interpreter & interp, std::uint64_t key, const SourceDigest & source){
+
+#ifdef SCRIPT_CACHE_HAVE_POSIX
+  if(!make_directories(m_dir)){
+    return false;
+  }
+
+  // write then rename, so concurrent runs never see a partial file
+  std::string target = path(key);
+  std::string temp = target + "." + std::to_string(getpid()) + "." +
+    std::to_string(temp_counter++) + ".tmp";
+  {
+    std::ofstream out(temp, std::ios::binary);
+    interp.writeCompiled(out, source);
+    if(!out){
+      std::remove(temp.c_str());
+      return false;
+    }
+  }
+  if(std::rename(temp.c_str(), target.c_str()) != 0){
+    std::remove(temp.c_str());
+    return false;
+  }
+  trim(target);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ScriptCache::trim(const std::string & kept) const{
+
+#ifdef SCRIPT_CACHE_HAVE_POSIX
+  struct Entry {
+    std::string path;
+    std::uint64_t size;
+    time_t used;
+  };
+
+  DIR * dir = opendir(m_dir.c_str());
+  if(dir == nullptr){
+    return;
+  }
+  std::vector<Entry> entries;
+  std::uint64_t total = 0;
+  const std::string suffix = ".plsc";
+  while(dirent * entry = readdir(dir)){
+    std::string name = entry->d_name;
+    if(name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0){
+      continue;
+    }
+    std::string file = m_dir + "/" + name;
+    struct stat info;
+    if(stat(file.c_str(), &info) == 0){
+      total += info.st_size;
+      if(file != kept){
+        entries.push_back(Entry{file, static_cast<std::uint64_t>(info.st_size), info.st_mtime});
+      }
+    }
+  }
+  closedir(dir);
+
+  // the least recently used first
+  std::sort(entries.begin(), entries.end(), [](const Entry & a, const Entry & b){
+    return a.used < b.used;
+  });
+  for(const Entry & entry : entries){
+    if(total <= m_limit){
+      break;
+    }
+    if(std::remove(entry.path.c_str()) == 0){
+      total -= entry.size;
+    }
+  }
+#else
+  (void)kept;
+#endif
+}
@@ -0,0 +1,138 @@
+/*! \file script_cache.hpp
+Defines the compiled script (.plsc) format and the on-disk cache of
+compiled scripts.
+
+A compiled script stores the AST of a program in a binary preorder
+encoding, so it can be loaded without tokenizing or parsing. It records
+the interpreter version, the parser id (see startup_config.hpp) and the
+length and SHA-256 digest of the source it was compiled from.
+ */
+#ifndef SCRIPT_CACHE_HPP
+#define SCRIPT_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "expression.hpp"
+
+// forward declare Interpreter
+class Interpreter;
+
+/// version of the compiled script encoding
+const std::uint32_t COMPILED_FORMAT_VERSION = 3;
+
+/// the deepest expression read from a compiled script, deeper ones are
+/// rejected rather than overflowing the stack
+const std::size_t MAX_COMPILED_DEPTH = 4096;
+
+/// the most bytes of compiled scripts a cache keeps by default
+const std::uint64_t DEFAULT_CACHE_LIMIT = std::uint64_t(64) << 20;
+
+/*! \struct SourceDigest
+\brief Identifies the program text a compiled script was compiled from
+*/
+struct SourceDigest {
+  /// the number of characters in the text
+  std::uint64_t size;
+
+  /// the SHA-256 digest of the text
+  unsigned char sha256[32];
+
+  /// the digest of no text in particular, all zero
+  SourceDigest();
+
+  /// the same size and digest
+  bool operator==(const SourceDigest & other) const noexcept;
+
+  /// a different size or digest
+  bool operator!=(const SourceDigest & other) const noexcept;
+};
+
+/*! \fn SourceDigest source_digest(const char * data, std::size_t size)
+\brief Compute the size and SHA-256 digest of a program text
+*/
+SourceDigest source_digest(const char * data, std::size_t size);
+
+/*! \fn std::uint64_t source_key(const SourceDigest & source)
+\brief Key naming the cache entry of a program text for this parser
+
+A 64 bit FNV-1a hash of the parser id, the format version and the source
+digest. Texts with the same key are told apart by the digest recorded in
+the entry.
+*/
+std::uint64_t source_key(const SourceDigest & source);
+
+/*! \fn bool is_compiled(const char * data, std::size_t size)
+\brief Determine if a buffer holds a compiled script (by its magic number)
+*/
+bool is_compiled(const char * data, std::size_t size) noexcept;
+
+/*! \fn void write_compiled(std::ostream & out, const Expression & ast, const SourceDigest & source)
+\brief Write ast as a compiled script
+
+\param out the stream to write to, should be opened in binary mode
+\param ast the expression to write
+\param source the digest of the text ast was parsed from
+*/
+void write_compiled(std::ostream & out, const Expression & ast, const SourceDigest & source);
+
+/*! \fn bool read_compiled(const char * data, std::size_t size, Expression & ast, SourceDigest & source)
+\brief Read a compiled script
+
+\param data the first character of the compiled script
+\param size the number of characters
+\param ast set to the expression read
+\param source set to the source digest recorded in the compiled script
+\return false if the buffer is not a valid compiled script for this
+interpreter version and parser, or nests deeper than MAX_COMPILED_DEPTH
+*/
+bool read_compiled(const char * data, std::size_t size, Expression & ast, SourceDigest & source) noexcept;
+
+/*! \class ScriptCache
+\brief A directory of compiled scripts, keyed by source_key
+
+Parsing through the cache loads the compiled AST of a program seen
+before, and stores the AST of a new one. An entry is used only if the
+source digest it records is that of the program text. The default directory is
+$PLOTSCRIPT_CACHE_DIR if set, else plotscript under $XDG_CACHE_HOME or
+~/.cache. Setting PLOTSCRIPT_CACHE_DIR to the empty string disables the
+cache. Storing an entry removes the least recently used others until the
+entries total at most the cache's limit. Failing to read or write the
+cache is never an error, it only means the program is parsed from
+source. A cache may be shared by several threads.
+*/
+class ScriptCache {
+public:
+
+  /// Construct a cache using the default directory
+  ScriptCache();
+
+  /// Construct a cache in directory, disabled if directory is empty,
+  /// keeping at most limit bytes of entries
+  explicit ScriptCache(const std::string & directory, std::uint64_t limit = DEFAULT_CACHE_LIMIT);
+
+  /// return true if the cache has a directory
+  bool enabled() const noexcept;
+
+  /// return the path of the compiled script for key
+  std::string path(std::uint64_t key) const;
+
+  /*! Parse a program into interp, from the cache if possible
+    \param interp the interpreter to parse into
+    \param data the first character of the program text
+    \param size the number of characters
+    \return true on successful parsing
+   */
+  bool parse(Interpreter & interp, const char * data, std::size_t size);
+
+private:
+  std::string m_dir;
+  std::uint64_t m_limit;
+
+  bool store(const Interpreter & interp, std::uint64_t key, const SourceDigest & source);
+  void trim(const std::string & kept) const;
+};
+
+#endif
@@ -0,0 +1,275 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "interpreter.hpp"
+#include "parse.hpp"
+#include "plot_buffer.hpp"
+#include "script_cache.hpp"
+#include "script_file.hpp"
+
+Expression parse_text(const std::string & program){
+
+  return parse(program.data(), program.size());
+}
+
+std::string compile_text(const Expression & ast){
+
+  std::ostringstream out;
+  write_compiled(out, ast, source_digest("42", 2));
+  return out.str();
+}
+
+std::string hex(const SourceDigest & source){
+
+  static const char digits[] = "0123456789abcdef";
+  std::string result;
+  for(unsigned char c : source.sha256){
+    result += digits[c >> 4];
+    result += digits[c & 0xf];
+  }
+  return result;
+}
+
+TEST_CASE( "Test source digests", "[script_cache]" ) {
+
+  // the FIPS 180-4 examples, of one and two blocks
+  REQUIRE(hex(source_digest("", 0)) == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  REQUIRE(hex(source_digest("abc", 3)) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  std::string two = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+  REQUIRE(hex(source_digest(two.data(), two.size())) == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  std::string million(1000000, 'a');
+  REQUIRE(hex(source_digest(million.data(), million.size())) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+  REQUIRE(source_digest("abc", 3).size == 3);
+  REQUIRE(source_digest("abc", 3) == source_digest("abc", 3));
+  REQUIRE(source_digest("abc", 3) != source_digest("abd", 3));
+  REQUIRE(source_key(source_digest("abc", 3)) != source_key(source_digest("abd", 3)));
+}
+
+TEST_CASE( "Test compiled script round trip", "[script_cache]" ) {
+
+  std::string program = "(begin (define s \"a string\") (list 1 -2.5e-300 0.1 (f)) (+ a b))";
+  Expression ast = parse_text(program);
+
+  std::string bytes = compile_text(ast);
+  REQUIRE(is_compiled(bytes.data(), bytes.size()));
+  REQUIRE(!is_compiled(program.data(), program.size()));
+
+  Expression loaded;
+  SourceDigest key;
+  REQUIRE(read_compiled(bytes.data(), bytes.size(), loaded, key));
+  REQUIRE(key == source_digest("42", 2));
+  REQUIRE(loaded == ast);
+
+  // numbers are stored exactly
+  Expression number = parse_text("(list 0.1)");
+  bytes = compile_text(number);
+  REQUIRE(read_compiled(bytes.data(), bytes.size(), loaded, key));
+  REQUIRE(loaded.tailConstBegin()->head().asNumber() == 0.1);
+
+  // properties are kept
+  Expression point(Atom("list"));
+  point.setProperty("\"object-name\"", Expression(Atom("\"point\"")));
+  point.setProperty("\"note\"", Expression(Atom(2.)));
+  bytes = compile_text(point);
+  REQUIRE(read_compiled(bytes.data(), bytes.size(), loaded, key));
+  REQUIRE(loaded.objName() == "\"point\"");
+  REQUIRE(loaded.graphicsKind() == POINT_GRAPHICS);
+  REQUIRE(*loaded.property("\"note\"") == Expression(Atom(2.)));
+
+  // and plots, in drawing order
+  std::shared_ptr<PlotBuffer> buffer = std::make_shared<PlotBuffer>();
+  buffer->add_line(0, 0.1, 1, 2, 0);
+  buffer->add_point(1, 2, 0.5);
+  buffer->add_text(0, -3, "\"title\"", 2, -1.5);
+  buffer->add_point(3, 4, 0.5);
+  Expression plot = Expression(Atom(std::shared_ptr<const PlotBuffer>(buffer)));
+  bytes = compile_text(plot);
+  REQUIRE(read_compiled(bytes.data(), bytes.size(), loaded, key));
+  REQUIRE(loaded.isHeadPlot());
+  REQUIRE(*loaded.head().asPlot() == *buffer);
+
+  // a truncated plot is rejected
+  REQUIRE(!read_compiled(bytes.data(), bytes.size() - 12, loaded, key));
+}
+
+TEST_CASE( "Test invalid compiled scripts are rejected", "[script_cache]" ) {
+
+  std::string bytes = compile_text(parse_text("(+ 1 2)"));
+
+  Expression loaded;
+  SourceDigest key;
+
+  // every truncation is invalid
+  for(std::size_t n = 0; n < bytes.size(); ++n){
+    REQUIRE(!read_compiled(bytes.data(), n, loaded, key));
+    REQUIRE(loaded == Expression());
+  }
+
+  // as are trailing bytes
+  std::string longer = bytes + "x";
+  REQUIRE(!read_compiled(longer.data(), longer.size(), loaded, key));
+
+  // and a different format version
+  std::string other = bytes;
+  other[4] = 99;
+  REQUIRE(!read_compiled(other.data(), other.size(), loaded, key));
+
+  // huge counts fail without allocating
+  std::string counts = bytes;
+  for(std::size_t i = counts.size() - 8; i < counts.size(); ++i) counts[i] = '\xff';
+  REQUIRE(!read_compiled(counts.data(), counts.size(), loaded, key));
+
+  {
+    INFO("nesting is bounded");
+    Expression deep(Atom("list"));
+    for(std::size_t depth = 1; depth < MAX_COMPILED_DEPTH; ++depth){
+      Expression outer(Atom("list"));
+      outer.append(Atom());
+      *outer.tail() = std::move(deep);
+      deep = std::move(outer);
+    }
+    bytes = compile_text(deep);
+    REQUIRE(read_compiled(bytes.data(), bytes.size(), loaded, key));
+    Expression deeper(Atom("list"));
+    deeper.append(Atom());
+    *deeper.tail() = std::move(deep);
+    bytes = compile_text(deeper);
+    REQUIRE(!read_compiled(bytes.data(), bytes.size(), loaded, key));
+    REQUIRE(loaded == Expression());
+  }
+}
+
+TEST_CASE( "Test the compiled script cache", "[script_cache]" ) {
+
+  const std::string dir = "script_cache_test_dir";
+  std::string program = "(begin (define a 3) (* a 2))";
+  SourceDigest source = source_digest(program.data(), program.size());
+  std::uint64_t key = source_key(source);
+
+  ScriptCache cache(dir);
+  REQUIRE(cache.enabled());
+  std::remove(cache.path(key).c_str());
+
+  {
+    INFO("a miss parses and stores the program");
+    Interpreter interp;
+    REQUIRE(cache.parse(interp, program.data(), program.size()));
+    REQUIRE(interp.evaluate() == Expression(6.));
+
+    ScriptFile stored;
+    REQUIRE(stored.open(cache.path(key)));
+    REQUIRE(is_compiled(stored.data(), stored.size()));
+  }
+
+  {
+    INFO("a hit loads the stored program");
+    Interpreter interp;
+    REQUIRE(cache.parse(interp, program.data(), program.size()));
+    REQUIRE(interp.evaluate() == Expression(6.));
+  }
+
+  {
+    INFO("a damaged entry is ignored and replaced");
+    std::ofstream(cache.path(key), std::ios::binary) << "PLSC garbage";
+
+    Interpreter interp;
+    REQUIRE(cache.parse(interp, program.data(), program.size()));
+    REQUIRE(interp.evaluate() == Expression(6.));
+
+    ScriptFile stored;
+    REQUIRE(stored.open(cache.path(key)));
+    Expression loaded;
+    SourceDigest recorded;
+    REQUIRE(read_compiled(stored.data(), stored.size(), loaded, recorded));
+    REQUIRE(recorded == source);
+  }
+
+  {
+    INFO("an entry for another text under the same key is ignored and replaced");
+    std::string other = "(begin (define a 3) (* a 5))";
+    {
+      std::ofstream out(cache.path(key), std::ios::binary);
+      write_compiled(out, parse_text(other), source_digest(other.data(), other.size()));
+    }
+
+    Interpreter interp;
+    REQUIRE(cache.parse(interp, program.data(), program.size()));
+    REQUIRE(interp.evaluate() == Expression(6.));
+
+    ScriptFile stored;
+    REQUIRE(stored.open(cache.path(key)));
+    Expression loaded;
+    SourceDigest recorded;
+    REQUIRE(read_compiled(stored.data(), stored.size(), loaded, recorded));
+    REQUIRE(recorded == source);
+  }
+
+  {
+    INFO("invalid programs are not stored");
+    std::string invalid = "(+ 1 2";
+    Interpreter interp;
+    REQUIRE(!cache.parse(interp, invalid.data(), invalid.size()));
+    ScriptFile stored;
+    REQUIRE(!stored.open(cache.path(source_key(source_digest(invalid.data(), invalid.size())))));
+  }
+
+  std::remove(cache.path(key).c_str());
+  std::remove(dir.c_str());
+
+  {
+    INFO("a disabled cache only parses");
+    ScriptCache disabled("");
+    REQUIRE(!disabled.enabled());
+    Interpreter interp;
+    REQUIRE(disabled.parse(interp, program.data(), program.size()));
+    REQUIRE(interp.evaluate() == Expression(6.));
+  }
+}
+
+TEST_CASE( "Test trimming the compiled script cache", "[script_cache]" ) {
+
+  const std::string dir = "script_cache_trim_dir";
+  std::string first = "(+ 1 2)";
+  std::string second = "(+ 3 4)";
+  std::string firstPath = ScriptCache(dir).path(source_key(source_digest(first.data(), first.size())));
+  std::string secondPath = ScriptCache(dir).path(source_key(source_digest(second.data(), second.size())));
+  std::remove(firstPath.c_str());
+  std::remove(secondPath.c_str());
+
+  {
+    INFO("entries within the limit are kept");
+    ScriptCache cache(dir);
+    Interpreter interp;
+    REQUIRE(cache.parse(interp, first.data(), first.size()));
+    REQUIRE(cache.parse(interp, second.data(), second.size()));
+    ScriptFile stored;
+    REQUIRE(stored.open(firstPath));
+    REQUIRE(stored.open(secondPath));
+  }
+
+  {
+    INFO("storing past the limit removes the others, never the new entry");
+    std::remove(secondPath.c_str());
+    ScriptCache small(dir, 1);
+    Interpreter interp;
+    REQUIRE(small.parse(interp, second.data(), second.size()));
+    REQUIRE(interp.evaluate() == Expression(7.));
+    ScriptFile stored;
+    REQUIRE(!stored.open(firstPath));
+    REQUIRE(stored.open(secondPath));
+
+    // and a hit stores nothing, so removes nothing
+    REQUIRE(small.parse(interp, second.data(), second.size()));
+    REQUIRE(stored.open(secondPath));
+  }
+
+  std::remove(firstPath.c_str());
+  std::remove(secondPath.c_str());
+  std::remove(dir.c_str());
+}
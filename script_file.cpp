@@ -0,0 +1,121 @@
+#include "script_file.hpp"
+
+#include <fstream>
+
+#include "token.hpp"
+
+#if defined(__APPLE__) || defined(__linux) || defined(__unix) ||             \
+    defined(__posix)
+#define SCRIPT_FILE_HAVE_MMAP
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ScriptFile::ScriptFile(): m_data(nullptr), m_size(0), m_map(nullptr) {}
+
+ScriptFile::~ScriptFile(){
+
+  close();
+}
+
+void ScriptFile::close(){
+
+#ifdef SCRIPT_FILE_HAVE_MMAP
+  if(m_map != nullptr){
+    munmap(m_map, m_size);
+  }
+#endif
+  m_map = nullptr;
+  m_data = nullptr;
+  m_size = 0;
+  m_copy.clear();
+}
+
+#ifdef SCRIPT_FILE_HAVE_MMAP
+
+bool ScriptFile::open(const std::string & filename){
+
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if(fd < 0){
+    return false;
+  }
+
+  struct stat info;
+  if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0){
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    void * map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map != MAP_FAILED){
+      // the reader makes a single forward pass
+      madvise(map, size, MADV_SEQUENTIAL);
+      ::close(fd);
+      m_map = map;
+      m_data = static_cast<const char *>(map);
+      m_size = size;
+      return true;
+    }
+  }
+
+  // not mappable, e.g. a pipe: read it until end of file
+  char buffer[1 << 16];
+  ssize_t count;
+  while((count = ::read(fd, buffer, sizeof(buffer))) != 0){
+    if(count < 0){
+      if(errno == EINTR) continue;
+      ::close(fd);
+      close();
+      return false;
+    }
+    m_copy.append(buffer, static_cast<std::size_t>(count));
+  }
+  ::close(fd);
+
+  m_data = m_copy.data();
+  m_size = m_copy.size();
+  return true;
+}
+
+#else
+
+bool ScriptFile::open(const std::string & filename){
+
+  close();
+
+  std::ifstream ifs(filename, std::ios::binary);
+  if(!ifs){
+    return false;
+  }
+
+  read(ifs);
+  return true;
+}
+
+#endif
+
+void ScriptFile::read(std::istream & stream){
+
+  close();
+
+  m_copy = read_stream(stream);
+  m_data = m_copy.data();
+  m_size = m_copy.size();
+}
+
+const char * ScriptFile::data() const noexcept{
+
+  return m_data;
+}
+
+std::size_t ScriptFile::size() const noexcept{
+
+  return m_size;
+}
+
+bool ScriptFile::mapped() const noexcept{
+
+  return m_map != nullptr;
+}
@@ -0,0 +1,64 @@
+/*! \file script_file.hpp
+Defines the ScriptFile type, used to load program text.
+ */
+#ifndef SCRIPT_FILE_HPP
+#define SCRIPT_FILE_HPP
+
+#include <cstddef>
+#include <istream>
+#include <string>
+
+/*! \class ScriptFile
+\brief The contents of a script file, memory-mapped when possible.
+
+Regular files are mapped read-only, so their contents can be handed to the
+reader without copying them or reading them a buffer at a time. Anything
+that cannot be mapped (pipes, terminals, empty files, or platforms without
+mmap) is read into memory instead.
+
+The contents are not null terminated.
+*/
+class ScriptFile {
+public:
+
+  /// Construct an empty ScriptFile
+  ScriptFile();
+
+  /// unmap or release the contents
+  ~ScriptFile();
+
+  ScriptFile(const ScriptFile &) = delete;
+  ScriptFile & operator=(const ScriptFile &) = delete;
+
+  /*! Load the named file, replacing any current contents
+    \param filename the file to load
+    \return false if the file cannot be opened or read
+   */
+  bool open(const std::string & filename);
+
+  /*! Load the remainder of a stream (e.g. std::cin), replacing any current contents
+    \param stream the stream to read
+   */
+  void read(std::istream & stream);
+
+  /// return the first character of the contents
+  const char * data() const noexcept;
+
+  /// return the number of characters
+  std::size_t size() const noexcept;
+
+  /// return true if the contents are mapped from the file
+  bool mapped() const noexcept;
+
+private:
+  const char * m_data;
+  std::size_t m_size;
+
+  // the mapping, or nullptr if the contents were copied into m_copy
+  void * m_map;
+  std::string m_copy;
+
+  void close();
+};
+
+#endif
@@ -0,0 +1,47 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "script_file.hpp"
+#include "startup_config.hpp"
+
+TEST_CASE( "Test loading a script file", "[script_file]" ) {
+
+  std::ifstream ifs(STARTUP_FILE);
+  std::stringstream expected;
+  expected << ifs.rdbuf();
+
+  ScriptFile file;
+  REQUIRE(file.open(STARTUP_FILE));
+  REQUIRE(std::string(file.data(), file.size()) == expected.str());
+
+#if defined(__APPLE__) || defined(__linux) || defined(__unix) ||             \
+    defined(__posix)
+  REQUIRE(file.mapped());
+#endif
+
+  // reopening replaces the contents
+  std::istringstream iss("(+ 1 2)");
+  file.read(iss);
+  REQUIRE(!file.mapped());
+  REQUIRE(std::string(file.data(), file.size()) == "(+ 1 2)");
+}
+
+TEST_CASE( "Test loading missing and empty script files", "[script_file]" ) {
+
+  ScriptFile file;
+  REQUIRE(!file.open("this-file-does-not-exist.pls"));
+  REQUIRE(file.size() == 0);
+
+  const char * empty = "script_file_test_empty.pls";
+  std::ofstream(empty).close();
+
+  REQUIRE(file.open(empty));
+  REQUIRE(file.size() == 0);
+  REQUIRE(!file.mapped());
+
+  std::remove(empty);
+}
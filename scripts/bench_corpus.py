@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+"""Macro benchmark runner and regression gate.
+
+Runs every case of the benchmark corpus (tests/bench/corpus.json) through
+the plotscript executable and through the Interpreter API (plotscript_bench
+--script), records wall time and peak RSS, and compares them against a
+stored baseline. Exits with a non-zero status if any case fails to run or
+regresses by more than the configured tolerance.
+
+Run from the build directory, e.g.
+
+    python3 ../scripts/bench_corpus.py --tolerance 0.2
+    python3 ../scripts/bench_corpus.py --update-baseline
+"""
+
+import argparse
+import json
+import math
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+CORPUS = os.path.join(ROOT, 'tests', 'bench')
+
+# ----------------------------------------------------------------------------
+# generated corpus programs, too large to keep in the repository
+
+def gen_literal_data(n):
+    # a large numeric data literal, dominated by tokenizing and parsing
+    values = ' '.join('%.6g' % (math.sin(i * 0.01) * 1000) for i in range(n))
+    return '(begin (define data (list %s)) (length data))\n' % values
+
+def gen_deep_nesting(n):
+    # deeply nested expression, dominated by the recursive evaluator
+    return '(begin (define x ' + '(+ 1 ' * n + '0' + ')' * n + ') x)\n'
+
+def gen_startup_session(n):
+    # a long session of small definitions using the startup procedures
+    lines = ['(begin']
+    for i in range(n):
+        lines.append('  (define p%d (make-point %d %d))' % (i, i, -i))
+        lines.append('  (define f%d (lambda (x) (+ x %d)))' % (i, i))
+        lines.append('  (define v%d (f%d %d))' % (i, i, i))
+    lines.append('  (make-text "done"))')
+    return '\n'.join(lines) + '\n'
+
+def gen_tiny(n):
+    return '(+ 1 2)\n'
+
+GENERATORS = {
+    'literal_data': gen_literal_data,
+    'deep_nesting': gen_deep_nesting,
+    'startup_session': gen_startup_session,
+    'tiny': gen_tiny,
+}
+
+def case_file(case, workdir):
+    if 'file' in case:
+        return os.path.join(CORPUS, case['file'])
+    path = os.path.join(workdir, '%s.pls' % case['name'])
+    text = GENERATORS[case['generate']](case.get('size', 1))
+    if not os.path.exists(path) or open(path).read() != text:
+        with open(path, 'w') as f:
+            f.write(text)
+    return path
+
+# ----------------------------------------------------------------------------
+# measurement
+
+# the script cache is disabled, so every run measures parsing and none
+# writes to the user's cache
+ENVIRONMENT = dict(os.environ, PLOTSCRIPT_CACHE_DIR='')
+
+def run_process(args, argv):
+    """Run argv under plotscript_bench --measure.
+
+    Returns (returncode, wall ms, peak RSS in KiB, stdout). Measuring from
+    Python directly would fold this script's own memory into the peak RSS.
+    """
+    with tempfile.TemporaryFile() as out, tempfile.TemporaryFile() as err, \
+         tempfile.NamedTemporaryFile(suffix='.json') as report:
+        code = subprocess.call([args.bench, '--measure', report.name] + argv, stdout=out, stderr=err,
+                               env=ENVIRONMENT)
+        err.seek(0)
+        stderr = err.read().decode(errors='replace')
+        if code != 0:
+            sys.stderr.write(stderr)
+            return code, 0, 0, ''
+        measured = json.load(open(report.name))
+        out.seek(0)
+        return measured['status'], measured['wall_ms'], measured['peak_rss_kb'], out.read().decode(errors='replace')
+
+def measure_binary(args, path, repeat):
+    wall, rss = 0.0, 0
+    for _ in range(repeat):
+        code, ms, peak, _ = run_process(args, [args.plotscript, path])
+        if code != 0:
+            return None
+        wall += ms
+        rss = max(rss, peak)
+    return wall, rss
+
+def measure_api(args, path, repeat):
+    code, _, peak, out = run_process(args, [args.bench, '--script', path, '--runs', str(repeat)])
+    if code != 0:
+        return None
+    return sum(json.loads(out)['wall_ms']), peak
+
+MODES = {'binary': measure_binary, 'api': measure_api}
+
+def measure(args, case, mode, path):
+    walls, rss = [], 0
+    for _ in range(args.samples):
+        result = MODES[mode](args, path, case.get('repeat', 1))
+        if result is None:
+            return None
+        walls.append(result[0])
+        rss = max(rss, result[1])
+    return {'wall_ms': round(statistics.median(walls), 3), 'peak_rss_kb': rss}
+
+# ----------------------------------------------------------------------------
+# comparison
+
+def compare(args, current, baseline):
+    """Return a list of regression messages."""
+    problems = []
+    wall, base_wall = current['wall_ms'], baseline['wall_ms']
+    if wall > base_wall * (1 + args.tolerance) and wall - base_wall > args.min_delta_ms:
+        problems.append('wall %.1f ms > baseline %.1f ms' % (wall, base_wall))
+    rss, base_rss = current['peak_rss_kb'], baseline['peak_rss_kb']
+    if rss > base_rss * (1 + args.rss_tolerance):
+        problems.append('peak RSS %d KiB > baseline %d KiB' % (rss, base_rss))
+    return problems
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--plotscript', default='./plotscript', help='plotscript executable')
+    parser.add_argument('--bench', default='./plotscript_bench', help='plotscript_bench executable')
+    parser.add_argument('--corpus', default=os.path.join(CORPUS, 'corpus.json'))
+    parser.add_argument('--baseline', default=os.path.join(CORPUS, 'baseline.json'))
+    parser.add_argument('--workdir', default='bench_corpus', help='directory for generated programs')
+    parser.add_argument('--mode', choices=['binary', 'api', 'both'], default='both')
+    parser.add_argument('--filter', default='', help='only run cases containing this string')
+    parser.add_argument('--samples', type=int, default=3, help='runs per case, median wall time is kept')
+    parser.add_argument('--tolerance', type=float, default=0.15, help='allowed relative wall time increase')
+    parser.add_argument('--rss-tolerance', type=float, default=0.10, help='allowed relative peak RSS increase')
+    parser.add_argument('--min-delta-ms', type=float, default=5.0, help='ignore wall time increases below this')
+    parser.add_argument('--update-baseline', action='store_true', help='store the results as the new baseline')
+    parser.add_argument('--json', help='also write the results to this file')
+    args = parser.parse_args()
+
+    os.makedirs(args.workdir, exist_ok=True)
+    cases = [c for c in json.load(open(args.corpus))['cases'] if args.filter in c['name']]
+    modes = ['binary', 'api'] if args.mode == 'both' else [args.mode]
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        baseline = json.load(open(args.baseline)).get('cases', {})
+
+    results, failures, regressions = {}, [], []
+    print('%-20s %-7s %12s %12s %12s  %s' % ('case', 'mode', 'wall ms', 'base ms', 'peak KiB', 'status'))
+    for case in cases:
+        path = case_file(case, args.workdir)
+        for mode in modes:
+            current = measure(args, case, mode, path)
+            base = baseline.get(case['name'], {}).get(mode)
+            if current is None:
+                failures.append('%s/%s' % (case['name'], mode))
+                print('%-20s %-7s %12s %12s %12s  FAILED' % (case['name'], mode, '-', '-', '-'))
+                continue
+            results.setdefault(case['name'], {})[mode] = current
+            status = 'new'
+            if base:
+                problems = compare(args, current, base)
+                status = 'REGRESSION: ' + '; '.join(problems) if problems else 'ok'
+                if problems:
+                    regressions.append('%s/%s' % (case['name'], mode))
+            print('%-20s %-7s %12.1f %12s %12d  %s' % (
+                case['name'], mode, current['wall_ms'],
+                '%.1f' % base['wall_ms'] if base else '-', current['peak_rss_kb'], status))
+
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump({'cases': results}, f, indent=2)
+
+    if args.update_baseline:
+        if failures:
+            print('not updating baseline, cases failed: ' + ', '.join(failures))
+            return 1
+        merged = dict(baseline)
+        merged.update(results)
+        with open(args.baseline, 'w') as f:
+            json.dump({'cases': merged}, f, indent=2, sort_keys=True)
+            f.write('\n')
+        print('baseline written to ' + args.baseline)
+        return 0
+
+    if failures:
+        print('failed: ' + ', '.join(failures))
+    if regressions:
+        print('regressed: ' + ', '.join(regressions))
+    return 1 if (failures or regressions) else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -2,6 +2,7 @@ import pexpect
 import pexpect.replwrap as replwrap
 import unittest
 import os
+import subprocess
         
 # the plotscript executable
 cmd = './plotscript'
@@ -40,6 +41,17 @@ class TestREPL(unittest.TestCase):
                 output = self.wrapper.run_command(u'(define begin True)')
                 self.assertTrue(output.strip().startswith('Error'))
                                 
+class TestPipedREPL(unittest.TestCase):
+
+        def test_order(self):
+                # piped lines are sent without waiting, results still print in order
+                lines = ''.join('(+ %d 1)\n' % i for i in range(500)) + '(+ 1\n'
+                output = subprocess.run([cmd], input=lines.encode(), stdout=subprocess.PIPE).stdout
+                results = [r.strip() for r in output.decode().split(prompt)[1:]]
+                expected = ['(%d)' % (i + 1) for i in range(500)]
+                expected += ['Error: Invalid Expression. Could not parse.', '']
+                self.assertEqual(results, expected)
+
 class TestExecuteCommandline(unittest.TestCase):
                 
         def test_sub(self):
@@ -0,0 +1,315 @@
+#include "server.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "semantic_error.hpp"
+
+#if defined(__APPLE__) || defined(__linux) || defined(__unix) ||             \
+    defined(__posix)
+#define SERVER_HAVE_POSIX
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// a fresh session environment, restored from the startup snapshot
+void reset_session(Interpreter & interp){
+
+  interp = Interpreter();
+  try{
+    interp.startup();
+  }
+  catch(const SemanticError &){
+  }
+}
+
+#ifdef SERVER_HAVE_POSIX
+
+bool write_all(int fd, const char * data, std::size_t size){
+
+#ifdef MSG_NOSIGNAL
+  // a client that went away must not kill the server with SIGPIPE
+  const int flags = MSG_NOSIGNAL;
+#else
+  const int flags = 0;
+#endif
+
+  while(size > 0){
+    ssize_t n = ::send(fd, data, size, flags);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) return false;
+    data += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+bool read_all(int fd, char * data, std::size_t size){
+
+  while(size > 0){
+    ssize_t n = ::read(fd, data, size);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) return false;
+    data += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+bool make_address(const std::string & path, sockaddr_un & address){
+
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if(path.empty() || path.size() >= sizeof(address.sun_path)){
+    return false;
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  return true;
+}
+
+#endif
+
+} // namespace
+
+#ifdef SERVER_HAVE_POSIX
+
+bool write_frame(int fd, const std::string & payload){
+
+  std::uint32_t size = static_cast<std::uint32_t>(payload.size());
+  char header[4];
+  for(int i = 0; i < 4; ++i) header[i] = static_cast<char>(size >> (8 * i));
+
+  return write_all(fd, header, sizeof(header)) && write_all(fd, payload.data(), payload.size());
+}
+
+bool read_frame(int fd, std::string & payload){
+
+  unsigned char header[4];
+  if(!read_all(fd, reinterpret_cast<char *>(header), sizeof(header))){
+    return false;
+  }
+
+  std::uint32_t size = 0;
+  for(int i = 0; i < 4; ++i) size |= std::uint32_t(header[i]) << (8 * i);
+  if(size > MAX_FRAME_SIZE){
+    return false;
+  }
+
+  payload.resize(size);
+  return (size == 0) || read_all(fd, &payload[0], size);
+}
+
+int connect_server(const std::string & path){
+
+  sockaddr_un address;
+  if(!make_address(path, address)){
+    return -1;
+  }
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0){
+    return -1;
+  }
+  if(::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0){
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+#else
+
+bool write_frame(int, const std::string &){
+  return false;
+}
+
+bool read_frame(int, std::string &){
+  return false;
+}
+
+int connect_server(const std::string &){
+  return -1;
+}
+
+#endif
+
+std::string evaluate_request(Interpreter & interp, const std::string & program){
+
+  std::string response(1, RESPONSE_RESULT);
+
+  if(!interp.parseBuffer(program.data(), program.size())){
+    response[0] = RESPONSE_ERROR;
+    response += "Error: Invalid Expression. Could not parse.";
+    return response;
+  }
+
+  try{
+    std::ostringstream out;
+    out << interp.evaluate();
+    response += out.str();
+  }
+  catch(const SemanticError & ex){
+    response[0] = RESPONSE_ERROR;
+    response += ex.what();
+  }
+  return response;
+}
+
+Server::Server(const std::string & path, std::size_t workers):
+  m_path(path), m_workers(workers > 0 ? workers : 1), m_listen_fd(-1), m_stopping(false) {}
+
+Server::~Server(){
+
+#ifdef SERVER_HAVE_POSIX
+  if(m_listen_fd >= 0){
+    ::close(m_listen_fd);
+    // run removes the socket when it returns
+    if(!m_stopping.load()){
+      ::unlink(m_path.c_str());
+    }
+  }
+#endif
+}
+
+bool Server::listen(std::string & error){
+
+#ifdef SERVER_HAVE_POSIX
+  sockaddr_un address;
+  if(!make_address(m_path, address)){
+    error = "Invalid socket path.";
+    return false;
+  }
+
+  // replace a stale socket, but never another kind of file
+  struct stat info;
+  if(::lstat(m_path.c_str(), &info) == 0){
+    if(!S_ISSOCK(info.st_mode)){
+      error = "Socket path exists and is not a socket.";
+      return false;
+    }
+    ::unlink(m_path.c_str());
+  }
+
+  m_listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if(m_listen_fd < 0){
+    error = std::strerror(errno);
+    return false;
+  }
+
+  if(::bind(m_listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+     ::listen(m_listen_fd, 64) != 0){
+    error = std::strerror(errno);
+    ::close(m_listen_fd);
+    m_listen_fd = -1;
+    return false;
+  }
+  return true;
+#else
+  error = "Server mode is not supported on this platform.";
+  return false;
+#endif
+}
+
+void Server::run(){
+
+#ifdef SERVER_HAVE_POSIX
+  std::vector<std::thread> workers;
+  for(std::size_t i = 0; i < m_workers; ++i){
+    workers.emplace_back(&Server::work, this);
+  }
+
+  while(!m_stopping.load()){
+    int fd = ::accept(m_listen_fd, nullptr, nullptr);
+    if(fd < 0){
+      if(errno == EINTR || errno == ECONNABORTED) continue;
+      m_stopping.store(true);
+      break;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_open_mutex);
+      m_open.insert(fd);
+    }
+    m_connections.push(fd);
+  }
+
+  // end every session after its current request, including those still
+  // waiting for a worker
+  {
+    std::lock_guard<std::mutex> lock(m_open_mutex);
+    for(int fd : m_open){
+      ::shutdown(fd, SHUT_RD);
+    }
+  }
+  for(std::size_t i = 0; i < workers.size(); ++i){
+    m_connections.push(-1);
+  }
+  for(auto & worker : workers){
+    worker.join();
+  }
+
+  // the socket itself is closed by the destructor, as stop may still use it
+  ::unlink(m_path.c_str());
+#endif
+}
+
+void Server::stop() noexcept{
+
+  m_stopping.store(true);
+#ifdef SERVER_HAVE_POSIX
+  // wakes the accept in run (only async-signal-safe calls here)
+  if(m_listen_fd >= 0){
+    ::shutdown(m_listen_fd, SHUT_RDWR);
+  }
+#endif
+}
+
+void Server::work(){
+
+  Interpreter interp;
+  int fd;
+  while(true){
+    m_connections.wait_and_pop(fd);
+    if(fd < 0){
+      return;
+    }
+    serve_session(interp, fd);
+    close_connection(fd);
+  }
+}
+
+void Server::serve_session(Interpreter & interp, int fd){
+
+  reset_session(interp);
+
+  std::string request;
+  while(!m_stopping.load() && read_frame(fd, request)){
+    std::string response;
+    if(request == "%reset"){
+      reset_session(interp);
+      response = std::string(1, RESPONSE_RESULT);
+    }
+    else{
+      response = evaluate_request(interp, request);
+    }
+    if(!write_frame(fd, response)){
+      return;
+    }
+  }
+}
+
+void Server::close_connection(int fd){
+
+#ifdef SERVER_HAVE_POSIX
+  std::lock_guard<std::mutex> lock(m_open_mutex);
+  m_open.erase(fd);
+  ::close(fd);
+#endif
+}
@@ -0,0 +1,113 @@
+/*! \file server.hpp
+Defines the plotscript server, which evaluates programs sent over a Unix
+domain socket on a pool of interpreter workers, and the framing used on
+its connections.
+
+Requests and responses are frames: a u32 little endian payload length
+followed by the payload. A request payload is the text of a program. A
+response payload is a status byte, RESPONSE_RESULT or RESPONSE_ERROR,
+followed by the printed result or the error message.
+
+Each connection is a session with its own environment, which starts as
+the startup environment; the request "%reset" restores it. Sessions are
+served concurrently, one per worker, and further connections wait for a
+free worker.
+ */
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "interpreter.hpp"
+#include "message_queue.hpp"
+
+/// status byte of a response holding a result
+const char RESPONSE_RESULT = 0;
+
+/// status byte of a response holding an error message
+const char RESPONSE_ERROR = 1;
+
+/// the largest request accepted, larger ones close the connection
+const std::size_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+/*! \fn bool write_frame(int fd, const std::string & payload)
+\brief Write payload as one frame to a socket
+\return false if the connection failed
+*/
+bool write_frame(int fd, const std::string & payload);
+
+/*! \fn bool read_frame(int fd, std::string & payload)
+\brief Read one frame from a socket
+\return false at the end of the connection, or if it failed or the frame
+is larger than MAX_FRAME_SIZE
+*/
+bool read_frame(int fd, std::string & payload);
+
+/*! \fn int connect_server(const std::string & path)
+\brief Connect to a server listening on the socket at path
+\return the connected socket, or -1
+*/
+int connect_server(const std::string & path);
+
+/*! \fn std::string evaluate_request(Interpreter & interp, const std::string & program)
+\brief Parse and evaluate a program, returning the response payload
+*/
+std::string evaluate_request(Interpreter & interp, const std::string & program);
+
+/*! \class Server
+\brief Serves sessions on a Unix domain socket with a pool of workers
+
+Only available on POSIX platforms, elsewhere listen always fails.
+*/
+class Server {
+public:
+
+  /*! Construct a server
+    \param path the filesystem path of the socket
+    \param workers the number of sessions served at once (at least 1)
+   */
+  Server(const std::string & path, std::size_t workers);
+
+  /// close the socket, and remove it if run was not called
+  ~Server();
+
+  Server(const Server &) = delete;
+  Server & operator=(const Server &) = delete;
+
+  /*! Create the socket and start listening; an existing socket at path
+    (e.g. left by a crashed server) is replaced.
+    \param error set to the reason on failure
+    \return false if the socket could not be created
+   */
+  bool listen(std::string & error);
+
+  /// accept and serve sessions until stop is called, then remove the socket
+  void run();
+
+  /// make run return once the current requests are answered, may be
+  /// called from another thread or a signal handler
+  void stop() noexcept;
+
+private:
+  std::string m_path;
+  std::size_t m_workers;
+  int m_listen_fd;
+  std::atomic<bool> m_stopping;
+
+  // accepted connections waiting for a worker, -1 stops a worker
+  message_queue<int> m_connections;
+
+  // connections accepted and not yet closed
+  std::mutex m_open_mutex;
+  std::set<int> m_open;
+
+  void work();
+  void serve_session(Interpreter & interp, int fd);
+  void close_connection(int fd);
+};
+
+#endif
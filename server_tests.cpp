@@ -0,0 +1,118 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "server.hpp"
+
+// send a request and return the response payload
+std::string request(int fd, const std::string & program){
+
+  REQUIRE(write_frame(fd, program));
+  std::string response;
+  REQUIRE(read_frame(fd, response));
+  return response;
+}
+
+std::string result(const std::string & text){
+  return std::string(1, RESPONSE_RESULT) + text;
+}
+
+TEST_CASE( "Test evaluating server requests", "[server]" ) {
+
+  Interpreter interp;
+
+  REQUIRE(evaluate_request(interp, "(define a 3)") == result("(3)"));
+  REQUIRE(evaluate_request(interp, "(+ a 1)") == result("(4)"));
+
+  std::string response = evaluate_request(interp, "(+ 1 2");
+  REQUIRE(response[0] == RESPONSE_ERROR);
+  REQUIRE(response.substr(1) == "Error: Invalid Expression. Could not parse.");
+
+  response = evaluate_request(interp, "(undefined-procedure 1)");
+  REQUIRE(response[0] == RESPONSE_ERROR);
+  REQUIRE(response.substr(1).find("Error") == 0);
+}
+
+TEST_CASE( "Test serving sessions on a socket", "[server]" ) {
+
+  const std::string path = "server_test.sock";
+
+  Server server(path, 2);
+  std::string error;
+  REQUIRE(server.listen(error));
+  std::thread running(&Server::run, &server);
+
+  int first = connect_server(path);
+  int second = connect_server(path);
+  REQUIRE(first >= 0);
+  REQUIRE(second >= 0);
+
+  {
+    INFO("the state of a session persists between requests");
+    REQUIRE(request(first, "(define a 3)") == result("(3)"));
+    REQUIRE(request(first, "(+ a 1)") == result("(4)"));
+  }
+
+  {
+    INFO("sessions are served concurrently and do not share state");
+    REQUIRE(request(second, "(+ a 1)")[0] == RESPONSE_ERROR);
+    REQUIRE(request(second, "(define a 10)") == result("(10)"));
+    REQUIRE(request(first, "(+ a 0)") == result("(3)"));
+  }
+
+  {
+    INFO("errors are reported and the session continues");
+    REQUIRE(request(first, "(+ 1 2")[0] == RESPONSE_ERROR);
+    REQUIRE(request(first, "(* a 2)") == result("(6)"));
+  }
+
+  {
+    INFO("%reset restores the startup environment");
+    REQUIRE(request(first, "%reset") == result(""));
+    REQUIRE(request(first, "(+ a 0)")[0] == RESPONSE_ERROR);
+  }
+
+  ::close(first);
+  ::close(second);
+
+  {
+    INFO("a closed session frees its worker");
+    int third = connect_server(path);
+    REQUIRE(third >= 0);
+    REQUIRE(request(third, "(+ 2 2)") == result("(4)"));
+    ::close(third);
+  }
+
+  server.stop();
+  running.join();
+
+  REQUIRE(connect_server(path) == -1);
+  REQUIRE(::access(path.c_str(), F_OK) != 0);
+}
+
+TEST_CASE( "Test server socket errors", "[server]" ) {
+
+  std::string error;
+
+  Server invalid(std::string(200, 'x'), 1);
+  REQUIRE(!invalid.listen(error));
+  REQUIRE(error == "Invalid socket path.");
+
+  // a file that is not a socket is left alone
+  Server file("server_test_file", 1);
+  {
+    std::FILE * f = std::fopen("server_test_file", "w");
+    REQUIRE(f != nullptr);
+    std::fclose(f);
+  }
+  REQUIRE(!file.listen(error));
+  REQUIRE(error == "Socket path exists and is not a socket.");
+  REQUIRE(::access("server_test_file", F_OK) == 0);
+  std::remove("server_test_file");
+
+  REQUIRE(connect_server("no_server_here.sock") == -1);
+}
@@ -0,0 +1,277 @@
+#ifndef _SPSC_QUEUE_H_
+#define _SPSC_QUEUE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <utility>
+#include <vector>
+
+#include "queue_policy.hpp"
+
+/*! \class spsc_queue
+\brief Bounded lock-free queue for one producer thread and one consumer thread
+
+Has the interface of message_queue. Messages are passed through a ring
+buffer using only atomic loads and stores; the mutex and condition
+variable are used only to sleep when the queue is empty (consumer) or
+full (producer), after a short spin.
+
+Under DROP_OLDEST the producer also removes messages, so it and the
+consumer take a second mutex to do so; pops take it only under that
+policy.
+*/
+template<typename MessageType>
+class spsc_queue
+{
+public:
+
+  /// construct with room for at least capacity messages, policy says
+  /// what push does when it is full
+  explicit spsc_queue(std::size_t capacity = 1024, OverflowPolicy policy = BLOCK_PRODUCER)
+    : the_policy(policy), the_head(0), the_tail(0), the_pushed(0), the_rejected(0), the_dropped(0),
+      the_high_water(0), consumer_waiting(false), producer_waiting(false)
+  {
+    std::size_t n = 2;
+    while(n < capacity) n *= 2;
+    the_slots.resize(n);
+    the_mask = n - 1;
+  }
+
+  spsc_queue(const spsc_queue &) = delete;
+  spsc_queue & operator=(const spsc_queue &) = delete;
+
+  /// push message into queue, blocks while the queue is full, return
+  /// false if the queue is full and rejects it
+  bool push(MessageType const& message)
+  {
+    std::size_t slot;
+    if(!reserve(slot)) return false;
+    the_slots[slot] = message;
+    publish();
+    return true;
+  }
+
+  /// move message into queue, blocks while the queue is full, return
+  /// false if the queue is full and rejects it
+  bool push(MessageType&& message)
+  {
+    std::size_t slot;
+    if(!reserve(slot)) return false;
+    the_slots[slot] = std::move(message);
+    publish();
+    return true;
+  }
+
+  /// move message into queue unless the queue is full and would block,
+  /// return false (counted as rejected) instead of waiting for room
+  bool try_push(MessageType&& message)
+  {
+    std::size_t slot;
+    if(!reserve(slot, false)) return false;
+    the_slots[slot] = std::move(message);
+    publish();
+    return true;
+  }
+
+  /// check if queue is empty
+  bool empty() const
+  {
+    return the_head.load(std::memory_order_acquire) == the_tail.load(std::memory_order_acquire);
+  }
+
+  /// pop (move) message from queue, return false if queue is empty
+  bool try_pop(MessageType& popped_value)
+  {
+    if(the_policy == DROP_OLDEST){
+      // the producer may be dropping the same message
+      std::lock_guard<std::mutex> lock(the_drop_mutex);
+      return pop_head(popped_value);
+    }
+    return pop_head(popped_value);
+  }
+
+  /// pop (move) message from queue, blocks until the queue is nonempty
+  void wait_and_pop(MessageType& popped_value)
+  {
+    if(try_pop(popped_value)) return;
+
+    std::size_t head = the_head.load(std::memory_order_relaxed);
+    wait_until([this, head](){
+	return head != the_tail.load(std::memory_order_seq_cst);
+      }, consumer_waiting);
+
+    try_pop(popped_value);
+  }
+
+  /// pop message from queue, waits up to timeout for the queue to be
+  /// nonempty, return false if it is still empty
+  template<typename Rep, typename Period>
+  bool wait_for_and_pop(MessageType& popped_value, const std::chrono::duration<Rep, Period> & timeout)
+  {
+    if(try_pop(popped_value)) return true;
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+    std::size_t head = the_head.load(std::memory_order_relaxed);
+    if(!wait_until([this, head](){
+	  return head != the_tail.load(std::memory_order_seq_cst);
+	}, consumer_waiting, &deadline)){
+      return false;
+    }
+
+    return try_pop(popped_value);
+  }
+
+  /// return size of queue
+  std::size_t size(){
+	  return the_tail.load(std::memory_order_acquire) - the_head.load(std::memory_order_acquire);
+  }
+
+  /// return the current depth and counters, may be called from any thread
+  QueueStats stats() const
+  {
+    QueueStats current;
+    std::size_t head = the_head.load(std::memory_order_acquire);
+    current.depth = the_tail.load(std::memory_order_acquire) - head;
+    current.capacity = the_mask + 1;
+    current.high_water = the_high_water.load(std::memory_order_relaxed);
+    current.pushed = the_pushed.load(std::memory_order_relaxed);
+    current.rejected = the_rejected.load(std::memory_order_relaxed);
+    current.dropped = the_dropped.load(std::memory_order_relaxed);
+    return current;
+  }
+
+private:
+  std::vector<MessageType> the_slots;
+  std::size_t the_mask;
+  OverflowPolicy the_policy;
+
+  // next slot to pop (written by the consumer, and by the producer
+  // dropping a message) and to push (by the producer), on separate cache
+  // lines
+  alignas(64) std::atomic<std::size_t> the_head;
+  alignas(64) std::atomic<std::size_t> the_tail;
+
+  // statistics, written only by the producer
+  std::atomic<std::uint64_t> the_pushed;
+  std::atomic<std::uint64_t> the_rejected;
+  std::atomic<std::uint64_t> the_dropped;
+  std::atomic<std::size_t> the_high_water;
+
+  // set by a thread about to sleep in wait_until
+  alignas(64) std::atomic<bool> consumer_waiting;
+  std::atomic<bool> producer_waiting;
+
+  std::mutex the_mutex;
+  std::condition_variable the_condition_variable;
+
+  // held to remove a message under DROP_OLDEST
+  std::mutex the_drop_mutex;
+
+  bool pop_head(MessageType& popped_value)
+  {
+    std::size_t head = the_head.load(std::memory_order_relaxed);
+    if(head == the_tail.load(std::memory_order_acquire))
+      {
+	return false;
+      }
+
+    popped_value = std::move(the_slots[head & the_mask]);
+    the_head.store(head + 1, std::memory_order_seq_cst);
+    wake(producer_waiting);
+    return true;
+  }
+
+  // make room to push and set the slot index, return false if the queue
+  // is full and rejects the message, as a blocking one does when may_wait
+  // is false
+  bool reserve(std::size_t & slot, bool may_wait = true)
+  {
+    std::size_t tail = the_tail.load(std::memory_order_relaxed);
+    if(tail - the_head.load(std::memory_order_acquire) > the_mask){
+      if(the_policy == DROP_OLDEST){
+	std::lock_guard<std::mutex> lock(the_drop_mutex);
+	// unless the consumer made room first
+	std::size_t head = the_head.load(std::memory_order_relaxed);
+	if(tail - head > the_mask){
+	  the_slots[head & the_mask] = MessageType();
+	  the_head.store(head + 1, std::memory_order_seq_cst);
+	  the_dropped.store(the_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+	slot = tail & the_mask;
+	return true;
+      }
+      if(the_policy == REJECT_NEWEST || !may_wait){
+	the_rejected.store(the_rejected.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	return false;
+      }
+      wait_until([this, tail](){
+	  return tail - the_head.load(std::memory_order_seq_cst) <= the_mask;
+	}, producer_waiting);
+    }
+    slot = tail & the_mask;
+    return true;
+  }
+
+  // make the message written to the reserved slot visible to the consumer
+  void publish()
+  {
+    std::size_t tail = the_tail.load(std::memory_order_relaxed) + 1;
+    the_tail.store(tail, std::memory_order_seq_cst);
+    wake(consumer_waiting);
+
+    the_pushed.store(the_pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::size_t depth = tail - the_head.load(std::memory_order_relaxed);
+    if(depth > the_high_water.load(std::memory_order_relaxed)){
+      the_high_water.store(depth, std::memory_order_relaxed);
+    }
+  }
+
+  // spin, then sleep until ready() holds or the deadline (if any) passes,
+  // return ready(). The waiting flag is stored before
+  // ready() is checked again and the other side stores its index before
+  // loading the flag (all seq_cst), so one of them sees the other.
+  template<typename Predicate>
+  bool wait_until(Predicate ready, std::atomic<bool> & waiting,
+		  const std::chrono::steady_clock::time_point * deadline = nullptr)
+  {
+    // spinning only helps when the other thread can run at the same time
+    static const int spins = (std::thread::hardware_concurrency() > 1) ? 128 : 0;
+    for(int i = 0; i < spins; ++i){
+      if(ready()) return true;
+    }
+
+    std::unique_lock<std::mutex> lock(the_mutex);
+    waiting.store(true, std::memory_order_seq_cst);
+    bool result = true;
+    while(!ready()){
+      if(deadline == nullptr){
+	the_condition_variable.wait(lock);
+      }
+      else if(the_condition_variable.wait_until(lock, *deadline) == std::cv_status::timeout){
+	result = ready();
+	break;
+      }
+    }
+    waiting.store(false, std::memory_order_relaxed);
+    return result;
+  }
+
+  void wake(std::atomic<bool> & waiting)
+  {
+    if(waiting.load(std::memory_order_seq_cst)){
+      // the waiter holds the mutex until it sleeps, so taking it here
+      // orders the notify after the wait; notify unlocked so the waiter
+      // does not wake into a held mutex
+      { std::lock_guard<std::mutex> lock(the_mutex); }
+      the_condition_variable.notify_all();
+    }
+  }
+};
+
+#endif
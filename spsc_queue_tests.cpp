@@ -0,0 +1,398 @@
+#include "catch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "message_queue.hpp"
+#include "spsc_queue.hpp"
+#include "consumer.hpp"
+#include "interpreter.hpp"
+
+TEST_CASE( "Test single producer single consumer queue", "[spsc_queue]" ) {
+
+  spsc_queue<int> queue(4);
+
+  int value = -1;
+  REQUIRE(queue.empty());
+  REQUIRE(!queue.try_pop(value));
+
+  queue.push(1);
+  queue.push(2);
+  REQUIRE(queue.size() == 2);
+  REQUIRE(queue.try_pop(value));
+  REQUIRE(value == 1);
+  queue.wait_and_pop(value);
+  REQUIRE(value == 2);
+  REQUIRE(queue.empty());
+}
+
+TEST_CASE( "Test single producer single consumer queue across threads", "[spsc_queue]" ) {
+
+  // a small capacity makes the producer wait for room
+  const int count = 100000;
+  spsc_queue<std::string> queue(8);
+
+  std::thread producer([&queue, count](){
+      for(int i = 0; i < count; ++i){
+	queue.push(std::to_string(i));
+      }
+    });
+
+  bool ordered = true;
+  std::string value;
+  for(int i = 0; i < count; ++i){
+    queue.wait_and_pop(value);
+    ordered = ordered && (value == std::to_string(i));
+  }
+  producer.join();
+
+  REQUIRE(ordered);
+  REQUIRE(queue.empty());
+}
+
+TEST_CASE( "Test consumer round trip through the kernel queues", "[spsc_queue]" ) {
+
+  inputQueue inQ;
+  outputQueue outQ;
+  Interpreter interp;
+  Consumer consumer(&inQ, &outQ, &interp);
+  std::thread kernel(consumer);
+
+  Expression result;
+  std::uint64_t id = 0;
+  for(int i = 0; i < 1000; ++i){
+    inQ.push({++id, "(+ 1 " + std::to_string(i) + ")"});
+    REQUIRE(wait_for_result(outQ, id, result, std::chrono::seconds(10)));
+    REQUIRE(result == Expression(1. + i));
+  }
+
+  inQ.push({++id, "(+ 1"});
+  REQUIRE(wait_for_result(outQ, id, result, std::chrono::seconds(10)));
+  REQUIRE(result == Expression(Atom("Error: Invalid Expression. Could not parse.")));
+
+  // results of requests nobody waited for are skipped
+  inQ.push({++id, "(+ 1 1)"});
+  inQ.push({++id, "(+ 1 2)"});
+  REQUIRE(wait_for_result(outQ, id, result, std::chrono::seconds(10)));
+  REQUIRE(result == Expression(3.));
+
+  // and waiting for a request that was never sent times out
+  REQUIRE(!wait_for_result(outQ, id + 1, result, std::chrono::milliseconds(10)));
+
+  inQ.push({0, "%stop"});
+  kernel.join();
+}
+
+TEST_CASE( "Test the kernel pipeline keeps requests in order", "[spsc_queue]" ) {
+
+  inputQueue inQ;
+  outputQueue outQ;
+  Interpreter interp;
+  Consumer consumer(&inQ, &outQ, &interp);
+  std::thread kernel(consumer);
+
+  // more requests than the parser stage may run ahead, with parse and
+  // semantic errors mixed in
+  const std::uint64_t count = 5 * PARSE_AHEAD;
+  for(std::uint64_t id = 1; id <= count; ++id){
+    std::string line = "(+ " + std::to_string(id) + " 0)";
+    if(id % 50 == 0) line = "(+ 1";
+    if(id % 70 == 0) line = "(undefined-procedure)";
+    inQ.push({id, line});
+  }
+
+  // a request after %stop is left for the next kernel
+  inQ.push({0, "%stop"});
+  inQ.push({count + 1, "(+ 1 1)"});
+
+  bool ordered = true;
+  KernelResult result;
+  for(std::uint64_t id = 1; id <= count; ++id){
+    outQ.wait_and_pop(result);
+    ordered = ordered && (result.id == id);
+    if(id % 70 == 0){
+      ordered = ordered && result.exp.head().asSymbol().find("Error") == 0;
+    }
+    else if(id % 50 == 0){
+      ordered = ordered && (result.exp == Expression(Atom("Error: Invalid Expression. Could not parse.")));
+    }
+    else{
+      ordered = ordered && (result.exp == Expression(double(id)));
+    }
+  }
+  REQUIRE(ordered);
+
+  kernel.join();
+  REQUIRE(outQ.empty());
+
+  std::thread next(consumer);
+  Expression exp;
+  REQUIRE(wait_for_result(outQ, count + 1, exp, std::chrono::seconds(10)));
+  REQUIRE(exp == Expression(2.));
+  inQ.push({0, "%stop"});
+  next.join();
+}
+
+TEST_CASE( "Test interrupting the kernel", "[spsc_queue]" ) {
+
+  inputQueue inQ;
+  outputQueue outQ;
+  Interpreter interp;
+  std::atomic<std::uint64_t> interrupted(0);
+  Consumer consumer(&inQ, &outQ, &interp, std::function<void()>(), &interrupted);
+  std::thread kernel(consumer);
+
+  const Expression stopped(Atom("Error: interpreter kernel interrupted"));
+  Expression result;
+
+  inQ.push({1, "(define a 1)"});
+  REQUIRE(wait_for_result(outQ, 1, result, std::chrono::seconds(10)));
+
+  // a request is stopped while it is evaluated, far sooner than it would end
+  inQ.push({2, "(begin (define g (lambda (y) (* y y))) (define f (lambda (x) (length (map g (range 0 1000 1)))))"
+	    " (map f (range 0 100000 1)))"});
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  interrupted = 2;
+  REQUIRE(wait_for_result(outQ, 2, result, std::chrono::seconds(10)));
+  REQUIRE(result == stopped);
+
+  // requests up to the interrupted id are not started, later ones are
+  // evaluated as usual
+  interrupted = 3;
+  inQ.push({3, "(define a 2)"});
+  inQ.push({4, "(+ a 0)"});
+  REQUIRE(wait_for_result(outQ, 3, result, std::chrono::seconds(10)));
+  REQUIRE(result == stopped);
+  REQUIRE(wait_for_result(outQ, 4, result, std::chrono::seconds(10)));
+  REQUIRE(result == Expression(1.));
+
+  inQ.push({0, "%stop"});
+  kernel.join();
+}
+
+TEST_CASE( "Test timed waits on the message queues", "[spsc_queue]" ) {
+
+  spsc_queue<int> spsc;
+  message_queue<int> locking;
+  int value = 0;
+
+  REQUIRE(!spsc.wait_for_and_pop(value, std::chrono::milliseconds(5)));
+  REQUIRE(!locking.wait_for_and_pop(value, std::chrono::milliseconds(5)));
+
+  std::thread producer([&spsc, &locking](){
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      spsc.push(1);
+      locking.push(2);
+    });
+
+  REQUIRE(spsc.wait_for_and_pop(value, std::chrono::seconds(10)));
+  REQUIRE(value == 1);
+  REQUIRE(locking.wait_for_and_pop(value, std::chrono::seconds(10)));
+  REQUIRE(value == 2);
+  producer.join();
+}
+
+TEST_CASE( "Test moving messages through the queues", "[spsc_queue]" ) {
+
+  // a move-only message type shows no copy is made
+  spsc_queue<std::unique_ptr<int>> spsc;
+  message_queue<std::unique_ptr<int>> locking;
+
+  spsc.push(std::unique_ptr<int>(new int(1)));
+  locking.push(std::unique_ptr<int>(new int(2)));
+
+  std::unique_ptr<int> value;
+  REQUIRE(spsc.try_pop(value));
+  REQUIRE(*value == 1);
+  locking.wait_and_pop(value);
+  REQUIRE(*value == 2);
+}
+
+TEST_CASE( "Test full queue policies", "[spsc_queue]" ) {
+
+  int value = 0;
+
+  {
+    INFO("rejecting keeps the oldest messages");
+    message_queue<int> locking(2, REJECT_NEWEST);
+    spsc_queue<int> spsc(2, REJECT_NEWEST);
+    for(int i = 1; i <= 3; ++i){
+      REQUIRE(locking.push(i) == (i <= 2));
+      REQUIRE(spsc.push(i) == (i <= 2));
+    }
+    REQUIRE(locking.try_pop(value));
+    REQUIRE(value == 1);
+    REQUIRE(spsc.try_pop(value));
+    REQUIRE(value == 1);
+
+    QueueStats stats = locking.stats();
+    REQUIRE(stats.depth == 1);
+    REQUIRE(stats.capacity == 2);
+    REQUIRE(stats.high_water == 2);
+    REQUIRE(stats.pushed == 2);
+    REQUIRE(stats.rejected == 1);
+    REQUIRE(stats.dropped == 0);
+
+    stats = spsc.stats();
+    REQUIRE(stats.depth == 1);
+    REQUIRE(stats.capacity == 2);
+    REQUIRE(stats.high_water == 2);
+    REQUIRE(stats.pushed == 2);
+    REQUIRE(stats.rejected == 1);
+  }
+
+  {
+    INFO("dropping keeps the newest messages");
+    message_queue<int> locking(2, DROP_OLDEST);
+    spsc_queue<int> spsc(2, DROP_OLDEST);
+    for(int i = 1; i <= 5; ++i){
+      REQUIRE(locking.push(i));
+      REQUIRE(spsc.push(i));
+    }
+    REQUIRE(locking.try_pop(value));
+    REQUIRE(value == 4);
+    REQUIRE(spsc.try_pop(value));
+    REQUIRE(value == 4);
+
+    QueueStats stats = locking.stats();
+    REQUIRE(stats.depth == 1);
+    REQUIRE(stats.pushed == 5);
+    REQUIRE(stats.dropped == 3);
+
+    stats = spsc.stats();
+    REQUIRE(stats.depth == 1);
+    REQUIRE(stats.pushed == 5);
+    REQUIRE(stats.dropped == 3);
+
+    // dropping makes room, so try_push does not refuse either
+    REQUIRE(spsc.try_push(6));
+    REQUIRE(spsc.try_push(7));
+    REQUIRE(spsc.try_pop(value));
+    REQUIRE(value == 6);
+  }
+
+  {
+    INFO("try_push rejects rather than block the producer");
+    message_queue<int> locking(2, BLOCK_PRODUCER);
+    spsc_queue<int> spsc(2, BLOCK_PRODUCER);
+    for(int i = 1; i <= 3; ++i){
+      REQUIRE(locking.try_push(int(i)) == (i <= 2));
+      REQUIRE(spsc.try_push(int(i)) == (i <= 2));
+    }
+    REQUIRE(locking.stats().rejected == 1);
+    REQUIRE(spsc.stats().rejected == 1);
+    REQUIRE(spsc.try_pop(value));
+    REQUIRE(spsc.try_push(4));
+  }
+
+  {
+    INFO("an unbounded queue never refuses");
+    message_queue<int> unbounded;
+    for(int i = 0; i < 1000; ++i){
+      REQUIRE(unbounded.push(i));
+    }
+    REQUIRE(unbounded.stats().capacity == 0);
+    REQUIRE(unbounded.stats().high_water == 1000);
+  }
+}
+
+TEST_CASE( "Test blocking a producer on a full queue", "[spsc_queue]" ) {
+
+  const int count = 10000;
+  message_queue<int> queue(4, BLOCK_PRODUCER);
+
+  std::thread producer([&queue, count](){
+      for(int i = 0; i < count; ++i){
+	queue.push(i);
+      }
+    });
+
+  bool ordered = true;
+  int value;
+  for(int i = 0; i < count; ++i){
+    queue.wait_and_pop(value);
+    ordered = ordered && (value == i);
+  }
+  producer.join();
+
+  REQUIRE(ordered);
+  QueueStats stats = queue.stats();
+  REQUIRE(stats.pushed == count);
+  REQUIRE(stats.high_water <= 4);
+  REQUIRE(stats.rejected == 0);
+  REQUIRE(stats.dropped == 0);
+}
+
+TEST_CASE( "Test dropping messages while the consumer pops them", "[spsc_queue]" ) {
+
+  const int count = 100000;
+  spsc_queue<int> queue(4, DROP_OLDEST);
+
+  std::thread producer([&queue, count](){
+      for(int i = 1; i <= count; ++i){
+	queue.push(i);
+      }
+      queue.push(-1);
+    });
+
+  // whatever is dropped, the rest arrive once each and in order
+  bool ordered = true;
+  int last = 0, value = 0;
+  std::uint64_t popped = 0;
+  while(true){
+    queue.wait_and_pop(value);
+    if(value == -1) break;
+    ordered = ordered && (value > last);
+    last = value;
+    ++popped;
+  }
+  producer.join();
+
+  REQUIRE(ordered);
+  QueueStats stats = queue.stats();
+  REQUIRE(stats.pushed == count + 1);
+  REQUIRE(popped + stats.dropped == count);
+}
+
+TEST_CASE( "Test formatting kernel queue statistics", "[spsc_queue]" ) {
+
+  message_queue<int> queue(8, REJECT_NEWEST);
+  queue.push(1);
+  REQUIRE(format_stats("input", queue.stats()) ==
+	  "input queue: depth 1/8, high water 1, pushed 1, rejected 0, dropped 0");
+
+  message_queue<int> unbounded;
+  REQUIRE(format_stats("output", unbounded.stats()) ==
+	  "output queue: depth 0, high water 0, pushed 0, rejected 0, dropped 0");
+}
+
+TEST_CASE( "Test parsing kernel queue options", "[spsc_queue]" ) {
+
+  OverflowPolicy policy = BLOCK_PRODUCER;
+  REQUIRE(parse_overflow_policy("reject", policy));
+  REQUIRE(policy == REJECT_NEWEST);
+  REQUIRE(parse_overflow_policy("drop-oldest", policy));
+  REQUIRE(policy == DROP_OLDEST);
+  REQUIRE(parse_overflow_policy("block", policy));
+  REQUIRE(policy == BLOCK_PRODUCER);
+  REQUIRE(!parse_overflow_policy("drop", policy));
+  REQUIRE(policy == BLOCK_PRODUCER);
+
+  std::size_t capacity = 0;
+  REQUIRE(parse_queue_capacity("16", capacity));
+  REQUIRE(capacity == 16);
+  REQUIRE(!parse_queue_capacity("0", capacity));
+  REQUIRE(!parse_queue_capacity("-1", capacity));
+  REQUIRE(!parse_queue_capacity("8x", capacity));
+  REQUIRE(!parse_queue_capacity("", capacity));
+  REQUIRE(!parse_queue_capacity("99999999999999999999", capacity));
+  REQUIRE(capacity == 16);
+
+  KernelQueueOptions defaults;
+  REQUIRE(defaults.capacity == KERNEL_INPUT_CAPACITY);
+  REQUIRE(defaults.policy == BLOCK_PRODUCER);
+}
@@ -0,0 +1,39 @@
+#include "symbol_table.hpp"
+
+#include <stdexcept>
+
+namespace {
+
+// in the order of PropertyKey
+const char * const KEY_NAMES[PROPERTY_KEY_COUNT] = {
+  "\"object-name\"", "\"size\"", "\"thickness\"", "\"position\"", "\"scale\"", "\"rotation\""
+};
+
+// the names as strings, made once on first use and only read after
+const std::string * key_strings(){
+  static const std::string strings[PROPERTY_KEY_COUNT] = {
+    KEY_NAMES[0], KEY_NAMES[1], KEY_NAMES[2], KEY_NAMES[3], KEY_NAMES[4], KEY_NAMES[5]
+  };
+  return strings;
+}
+
+} // namespace
+
+bool find_symbol(const std::string & name, SymbolId & id){
+
+  for(SymbolId key = 0; key < PROPERTY_KEY_COUNT; ++key){
+    if(name == KEY_NAMES[key]){
+      id = key;
+      return true;
+    }
+  }
+  return false;
+}
+
+const std::string & symbol_name(SymbolId id){
+
+  if(id >= PROPERTY_KEY_COUNT){
+    throw std::out_of_range("symbol_name: not a fixed property name");
+  }
+  return key_strings()[id];
+}
@@ -0,0 +1,43 @@
+/*! \file symbol_table.hpp
+Defines the ids of the property names the interpreter itself uses.
+
+Expression stores these properties, and compares them, by a small integer
+id rather than by string. The names are fixed at compile time, so looking
+them up takes no lock and the table never grows; any other property name
+is kept as a string by the expression it is set on.
+ */
+#ifndef SYMBOL_TABLE_HPP
+#define SYMBOL_TABLE_HPP
+
+#include <cstdint>
+#include <string>
+
+/// the id of a fixed property name
+typedef std::uint32_t SymbolId;
+
+/// the ids of the property names of the graphic primitives
+enum PropertyKey : SymbolId {
+  OBJECT_NAME_KEY,   ///< "object-name"
+  SIZE_KEY,          ///< "size"
+  THICKNESS_KEY,     ///< "thickness"
+  POSITION_KEY,      ///< "position"
+  SCALE_KEY,         ///< "scale"
+  ROTATION_KEY,      ///< "rotation"
+  PROPERTY_KEY_COUNT ///< the number of fixed names, not a name itself
+};
+
+/*! \fn bool find_symbol(const std::string & name, SymbolId & id)
+\brief Look up the id of a fixed property name
+
+\return false if name is not one of the fixed names
+*/
+bool find_symbol(const std::string & name, SymbolId & id);
+
+/*! \fn const std::string & symbol_name(SymbolId id)
+\brief Return the fixed property name with id, which stays valid for the life of the program
+
+\throws std::out_of_range if id is not less than PROPERTY_KEY_COUNT
+*/
+const std::string & symbol_name(SymbolId id);
+
+#endif
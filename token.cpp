@@ -33,61 +33,220 @@ std::string Token::asString() const{
 }
 
 
-// add token to sequence unless it is empty, clears token
-void store_ifnot_empty(std::string & token, TokenSequenceType & seq){
-  if(!token.empty()){
-    seq.emplace_back(token);
-    token.clear();
+std::string TokenSlice::asString() const{
+  if(type == Token::STRING){
+    return std::string(data, size);
   }
+  return Token(type).asString();
 }
 
-TokenSequenceType tokenize(std::istream & seq){
-  TokenSequenceType tokens;
-  std::string token;
-
-  bool inDelim = false;
-  
-  while(true){
-    char c = seq.get();
-    if(seq.eof()) break;
-    
-    if(c == COMMENTCHAR){
-      // chomp until the end of the line
-      while((!seq.eof()) && (c != '\n')){
-	c = seq.get();
+TokenScanner::TokenScanner(const char * begin, const char * end, bool last):
+  m_pos(begin), m_end(end), m_last(last), m_inComment(false), m_inDelim(false),
+  m_start(nullptr), m_size(0), m_spilled(false),
+  m_queued(false), m_queuedType(Token::OPEN) {}
+
+// add the character at c to the pending STRING token
+void TokenScanner::extend(const char * c){
+  if(m_spilled){
+    m_spill.push_back(*c);
+  }
+  else{
+    if(m_size == 0) m_start = c;
+    ++m_size;
+  }
+}
+
+// copy the pending STRING token out of the input, to continue it with
+// characters that are not contiguous with it
+void TokenScanner::spill(){
+  if(!m_spilled && m_size > 0){
+    m_spill.assign(m_start, m_size);
+    m_spilled = true;
+    m_size = 0;
+  }
+}
+
+// hand out the pending STRING token unless it is empty, clears it
+bool TokenScanner::take_pending(TokenSlice & token){
+  if(m_spilled){
+    m_spilled = false;
+    if(m_spill.empty()) return false;
+    token = {Token::STRING, m_spill.data(), m_spill.size()};
+    return true;
+  }
+  if(m_size == 0) return false;
+  token = {Token::STRING, m_start, m_size};
+  m_size = 0;
+  return true;
+}
+
+bool TokenScanner::next(TokenSlice & token){
+
+  if(m_queued){
+    m_queued = false;
+    token = {m_queuedType, nullptr, 0};
+    return true;
+  }
+
+  while(m_pos != m_end){
+    // chomp until the end of the line
+    if(m_inComment){
+      while((m_pos != m_end) && (*m_pos != '\n')) ++m_pos;
+      if(m_pos == m_end) break;
+      ++m_pos;
+      m_inComment = false;
+      continue;
+    }
+
+    const char * c = m_pos++;
+
+    if(*c == COMMENTCHAR){
+      // a token interrupted by a comment continues after it, so its
+      // characters are no longer contiguous
+      spill();
+      m_inComment = true;
+    }
+    else if(*c == OPENCHAR || *c == CLOSECHAR){
+      Token::TokenType type = (*c == OPENCHAR) ? Token::OPEN : Token::CLOSE;
+      if(take_pending(token)){
+        m_queued = true;
+        m_queuedType = type;
+      }
+      else{
+        token = {type, nullptr, 0};
       }
-      if(seq.eof()) break;
+      return true;
     }
-    else if(c == OPENCHAR){
-      store_ifnot_empty(token, tokens);
-      tokens.push_back(Token::TokenType::OPEN);
+    else if(*c == STRDELIMCHAR){
+      if(!m_inDelim){
+        m_inDelim = true;
+        bool pending = take_pending(token);
+        // the literal keeps its delimiters, starting with this one
+        extend(c);
+        if(pending){
+          m_queued = true;
+          m_queuedType = Token::STRING_DELIM;
+        }
+        else{
+          token = {Token::STRING_DELIM, nullptr, 0};
+        }
+        return true;
+      }
+      else{
+        m_inDelim = false;
+        extend(c);
+        take_pending(token);
+        m_queued = true;
+        m_queuedType = Token::STRING_DELIM;
+        return true;
+      }
     }
-    else if(c == CLOSECHAR){
-      store_ifnot_empty(token, tokens);
-      tokens.push_back(Token::TokenType::CLOSE);
+    else if(std::isspace(static_cast<unsigned char>(*c)) && (!m_inDelim)){
+      if(take_pending(token)) return true;
+    }
+    else{
+      extend(c);
     }
-	else if(c == STRDELIMCHAR){
-	  if (!inDelim){
-		  store_ifnot_empty(token, tokens);
-		  tokens.push_back(Token::TokenType::STRING_DELIM);
-		  token.push_back('"');
-		  inDelim = true;
-	  }
-	  else {
-		  token.push_back('"');
-		  store_ifnot_empty(token, tokens);
-		  tokens.push_back(Token::TokenType::STRING_DELIM);
-		  inDelim = false;
-	  }
-	}
-    else if((isspace(c)) && (!inDelim)){
-      store_ifnot_empty(token, tokens);
+  }
+
+  if(!m_last){
+    // the pending token may continue in the next input
+    spill();
+    return false;
+  }
+  return take_pending(token);
+}
+
+void TokenScanner::resume(const char * begin, const char * end, bool last){
+  m_pos = begin;
+  m_end = end;
+  m_last = last;
+}
+
+TokenSliceSequence::TokenSliceSequence() {}
+
+TokenSliceSequence::TokenSliceSequence(TokenSliceSequence && other):
+  m_tokens(std::move(other.m_tokens)), m_storage(std::move(other.m_storage)) {}
+
+TokenSliceSequence & TokenSliceSequence::operator=(TokenSliceSequence && other){
+  m_tokens = std::move(other.m_tokens);
+  m_storage = std::move(other.m_storage);
+  return *this;
+}
+
+void TokenSliceSequence::push_back(const TokenSlice & token, bool stable){
+  if(stable || token.type != Token::STRING){
+    m_tokens.push_back(token);
+    return;
+  }
+  // deque elements do not move as it grows, and the deque itself is
+  // heap allocated so moving the sequence keeps the slices valid
+  if(!m_storage) m_storage.reset(new std::deque<std::string>());
+  m_storage->emplace_back(token.data, token.size);
+  m_tokens.push_back({Token::STRING, m_storage->back().data(), token.size});
+}
+
+std::size_t TokenSliceSequence::size() const noexcept{
+  return m_tokens.size();
+}
+
+bool TokenSliceSequence::empty() const noexcept{
+  return m_tokens.empty();
+}
+
+const TokenSlice & TokenSliceSequence::operator[](std::size_t i) const{
+  return m_tokens[i];
+}
+
+TokenSliceSequence::ConstIteratorType TokenSliceSequence::begin() const noexcept{
+  return m_tokens.cbegin();
+}
+
+TokenSliceSequence::ConstIteratorType TokenSliceSequence::end() const noexcept{
+  return m_tokens.cend();
+}
+
+TokenSliceSequence tokenize(const char * data, std::size_t size){
+
+  TokenSliceSequence tokens;
+  const char * end = data + size;
+
+  TokenScanner scanner(data, end);
+  TokenSlice token;
+  while(scanner.next(token)){
+    bool stable = (token.data >= data) && (token.data < end);
+    tokens.push_back(token, stable);
+  }
+
+  return tokens;
+}
+
+std::string read_stream(std::istream & seq){
+
+  std::string buffer;
+  char chunk[1 << 16];
+  while(seq.read(chunk, sizeof(chunk)) || seq.gcount() > 0){
+    buffer.append(chunk, seq.gcount());
+  }
+  return buffer;
+}
+
+TokenSequenceType tokenize(std::istream & seq){
+
+  std::string buffer = read_stream(seq);
+
+  TokenSequenceType tokens;
+
+  TokenScanner scanner(buffer.data(), buffer.data() + buffer.size());
+  TokenSlice token;
+  while(scanner.next(token)){
+    if(token.type == Token::STRING){
+      tokens.emplace_back(std::string(token.data, token.size));
     }
     else{
-      token.push_back(c);
+      tokens.emplace_back(token.type);
     }
   }
-  store_ifnot_empty(token, tokens);
 
   return tokens;
 }
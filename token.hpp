@@ -4,8 +4,12 @@ Defines the Token and TokenSequence types, and associated functions.
 #ifndef TOKEN_HPP
 #define TOKEN_HPP
 
+#include <cstddef>
 #include <deque>
 #include <istream>
+#include <memory>
+#include <string>
+#include <vector>
 
 /*! \class Token
   \brief Value class representing a token.
@@ -47,6 +51,124 @@ sequential access should do.
  */
 typedef std::deque<Token> TokenSequenceType;
 
+/*! \class TokenSlice
+  \brief Lightweight token referring to characters owned elsewhere.
+
+  For STRING tokens data and size give the token text, which normally lies
+  inside the scanned input buffer. For the other types data is nullptr.
+*/
+struct TokenSlice {
+
+  /// the token type
+  Token::TokenType type;
+
+  /// first character of a STRING token
+  const char * data;
+
+  /// number of characters in a STRING token
+  std::size_t size;
+
+  /// return the token rendered as a string (copies)
+  std::string asString() const;
+};
+
+/*! \class TokenScanner
+  \brief Splits a contiguous character buffer into TokenSlices.
+
+  The scanner never copies the input. The only exception is a STRING token
+  whose characters are not contiguous, because a comment interrupted it,
+  e.g. "ab;note" followed by "cd" on the next line, or because it continues
+  into the next chunk of the input; it is assembled in a buffer owned by
+  the scanner and remains valid until the next call to next.
+
+  The buffer must outlive the scanner and any slices it produced.
+*/
+class TokenScanner {
+public:
+
+  /*! Scan the characters in [begin, end)
+    \param last false if more characters follow, to be given to resume
+   */
+  TokenScanner(const char * begin, const char * end, bool last = true);
+
+  /*! Produce the next token
+    \param token set to the next token on success
+    \return false once the input is exhausted, or until resume is called
+    if it is not the last
+   */
+  bool next(TokenSlice & token);
+
+  /*! Continue with the characters that follow the input scanned so far,
+    once next has returned false. The previous input may then be reused.
+    \param last false if still more characters follow
+   */
+  void resume(const char * begin, const char * end, bool last);
+
+private:
+  const char * m_pos;
+  const char * m_end;
+  bool m_last;
+
+  // a comment runs to the end of the line, which may be in the next input
+  bool m_inComment;
+
+  // inside a string literal whitespace does not split tokens
+  bool m_inDelim;
+
+  // the STRING token being accumulated, either a range of the input or
+  // (after a comment interrupted it) the contents of m_spill
+  const char * m_start;
+  std::size_t m_size;
+  bool m_spilled;
+  std::string m_spill;
+
+  // a token found together with the end of the pending STRING token
+  bool m_queued;
+  Token::TokenType m_queuedType;
+
+  void extend(const char * c);
+  void spill();
+  bool take_pending(TokenSlice & token);
+};
+
+/*! \class TokenSliceSequence
+  \brief The sequence of tokens produced by tokenizing a buffer.
+
+  Slices refer into the tokenized buffer, which must outlive the sequence.
+  The sequence is movable but not copyable, since it may own the storage
+  of slices that could not refer to the buffer directly.
+*/
+class TokenSliceSequence {
+public:
+  typedef std::vector<TokenSlice>::const_iterator ConstIteratorType;
+
+  TokenSliceSequence();
+  TokenSliceSequence(TokenSliceSequence && other);
+  TokenSliceSequence & operator=(TokenSliceSequence && other);
+  TokenSliceSequence(const TokenSliceSequence &) = delete;
+  TokenSliceSequence & operator=(const TokenSliceSequence &) = delete;
+
+  /// append a token, copying its characters if they are not stable
+  void push_back(const TokenSlice & token, bool stable);
+
+  /// number of tokens
+  std::size_t size() const noexcept;
+
+  /// true if there are no tokens
+  bool empty() const noexcept;
+
+  /// return the token at index i
+  const TokenSlice & operator[](std::size_t i) const;
+
+  /// iterators over the tokens
+  ConstIteratorType begin() const noexcept;
+  ConstIteratorType end() const noexcept;
+
+private:
+  std::vector<TokenSlice> m_tokens;
+  std::unique_ptr<std::deque<std::string> > m_storage;
+};
+
 /*! \fn TokenSequenceType tokenize(std::istream & seq)
 \brief Split a stream into a sequnce of tokens
 
@@ -60,4 +182,20 @@ Ignores any whitespace and comments (from any ";" to end-of-line).
 */
 TokenSequenceType tokenize(std::istream & seq);
 
+/*! \fn TokenSliceSequence tokenize(const char * data, std::size_t size)
+\brief Split a character buffer into a sequence of token slices
+
+\param data the first character of the input
+\param size the number of characters in the input
+\return The sequence of tokens, referring into the input buffer
+
+Same rules as tokenize(std::istream &), without copying token text.
+*/
+TokenSliceSequence tokenize(const char * data, std::size_t size);
+
+/*! \fn std::string read_stream(std::istream & seq)
+\brief Read the remainder of a stream into a string, in bulk
+*/
+std::string read_stream(std::istream & seq);
+
 #endif
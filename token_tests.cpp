@@ -73,3 +73,73 @@ TEST_CASE( "Test tokenize", "[token]" ) {
   REQUIRE(tokens.empty());
 }
 
+
+TEST_CASE( "Test tokenize buffer", "[token]" ) {
+  std::string input = R"pls(
+( A a aa )aal ; a comment
+
+(aalii)) 3 "a string (x)"
+)pls";
+
+  TokenSliceSequence tokens = tokenize(input.data(), input.size());
+
+  REQUIRE(tokens.size() == 18);
+
+  // token text refers into the input buffer
+  for(auto & t : tokens){
+    if(t.type == Token::STRING){
+      REQUIRE(t.data >= input.data());
+      REQUIRE(t.data + t.size <= input.data() + input.size());
+    }
+    else{
+      REQUIRE(t.data == nullptr);
+    }
+  }
+
+  REQUIRE(tokens[0].type == Token::OPEN);
+  REQUIRE(tokens[1].asString() == "A");
+  REQUIRE(tokens[3].asString() == "aa");
+  REQUIRE(tokens[4].type == Token::CLOSE);
+  REQUIRE(tokens[5].asString() == "aal");
+  REQUIRE(tokens[7].asString() == "aalii");
+  REQUIRE(tokens[10].asString() == "3");
+  REQUIRE(tokens[11].type == Token::STRING_DELIM);
+  REQUIRE(tokens[12].asString() == "\"a string ");
+  REQUIRE(tokens[13].type == Token::OPEN);
+  REQUIRE(tokens[14].asString() == "x");
+  REQUIRE(tokens[16].asString() == "\"");
+  REQUIRE(tokens[17].type == Token::STRING_DELIM);
+}
+
+TEST_CASE( "Test tokenize buffer agrees with stream", "[token]" ) {
+  std::vector<std::string> inputs = {
+    "",
+    "; only a comment",
+    "(+ 1 2)",
+    "(define s \"two words\")",
+    "ab;comment\ncd",
+    "\"open;comment\nrest\" x",
+  };
+
+  for(auto & input : inputs){
+    std::istringstream iss(input);
+    TokenSequenceType expected = tokenize(iss);
+    TokenSliceSequence tokens = tokenize(input.data(), input.size());
+
+    REQUIRE(tokens.size() == expected.size());
+    for(std::size_t i = 0; i < tokens.size(); ++i){
+      REQUIRE(tokens[i].type == expected[i].type());
+      REQUIRE(tokens[i].asString() == expected[i].asString());
+    }
+  }
+}
+
+TEST_CASE( "Test tokenize buffer with token split by a comment", "[token]" ) {
+  std::string input = "(ab;comment\ncd)";
+
+  TokenSliceSequence tokens = tokenize(input.data(), input.size());
+  TokenSliceSequence moved(std::move(tokens));
+
+  REQUIRE(moved.size() == 3);
+  REQUIRE(moved[1].asString() == "abcd");
+}